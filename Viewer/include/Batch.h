@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "SceneDescription.h"
+
+// What a worker did, by stage. Sent back from the worker processes as is, so it must stay plain data.
+struct BatchStatistics
+{
+	size_t jobs;
+	size_t failedJobs;
+	size_t sharedMeshLoads;     // Models whose mesh was already resident
+	double loadSeconds;         // Setting up the scene and loading its models
+	double renderSeconds;       // Renderer::Render and glFinish
+	double readbackSeconds;
+	double encodeSeconds;
+	double writeSeconds;
+	double workerSeconds;       // Everything, context creation included
+};
+
+/*
+ * Batch class.
+ * Renders a list of views, run with "MeshViewer --batch <jobs file> [--workers <count>] [scene options]".
+ * Every line of the jobs file is one image: SceneDescription options with the dashes, --output included.
+ * The scene options on the command line are the defaults of every job.
+ *
+ * The jobs are split between worker processes, each with its own HeadlessContext, scene and renderer.
+ * Jobs that use the same models go to the same worker one after the other, so their meshes, textures and
+ * compiled shader variants stay loaded from one job to the next.
+ */
+class Batch
+{
+public:
+	static int Run(int argc, char** argv);
+
+private:
+	struct Job
+	{
+		SceneDescription description;
+		int line;
+	};
+
+	static void printUsage();
+	static bool readJobs(const std::string& filePath, const SceneDescription& defaults, std::vector<Job>& jobs);
+	static std::vector<std::vector<size_t>> shardJobs(const std::vector<Job>& jobs, int workers);
+	static bool runWorkerProcesses(const std::vector<Job>& jobs, const std::vector<std::vector<size_t>>& shards, std::vector<BatchStatistics>& statistics);
+	static BatchStatistics runWorker(const std::vector<Job>& jobs, const std::vector<size_t>& shard);
+	static void printStatistics(const std::string& name, const BatchStatistics& statistics, double seconds);
+};
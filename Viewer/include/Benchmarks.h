@@ -0,0 +1,22 @@
+#pragma once
+
+/*
+ * Benchmarks class.
+ * Command line benchmarks, run with "MeshViewer --benchmark <name> [arguments]".
+ * They run before any window/OpenGL context is created and print their results to stdout.
+ */
+class Benchmarks
+{
+public:
+	static int Run(int argc, char** argv);
+
+private:
+	static void printUsage();
+	static int objParserScaling(int argc, char** argv);
+	static int meshMemory(int argc, char** argv);
+	static int normalGeneration(int argc, char** argv);
+	static int meshOptimizer(int argc, char** argv);
+	static int vertexFormats(int argc, char** argv);
+	static int levelsOfDetail(int argc, char** argv);
+	static int frustumCulling(int argc, char** argv);
+};
@@ -0,0 +1,31 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <algorithm>
+
+// Axis aligned bounding box
+struct BoundingBox
+{
+	glm::vec3 minimums = glm::vec3(0.0f);
+	glm::vec3 maximums = glm::vec3(0.0f);
+
+	glm::vec3 GetCenter() const { return (minimums + maximums) * 0.5f; }
+	float GetDiagonal() const   { return glm::length(maximums - minimums); }
+};
+
+struct BoundingSphere
+{
+	glm::vec3 center = glm::vec3(0.0f);
+	float radius = 0.0f;
+
+	// The sphere after transform. Non-uniform scales grow the radius by the largest axis scale, so the result
+	// is still conservative (never smaller than the transformed mesh).
+	BoundingSphere Transformed(const glm::mat4& transform) const
+	{
+		float scale = std::max(glm::length(glm::vec3(transform[0])), std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+
+		BoundingSphere sphere;
+		sphere.center = glm::vec3(transform * glm::vec4(center, 1.0f));
+		sphere.radius = radius * scale;
+		return sphere;
+	}
+};
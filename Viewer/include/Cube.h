@@ -22,8 +22,12 @@ public:
 	Cube(glm::vec4 location, float length, float width, float height);
 	~Cube();
 
-	virtual const GLuint & GetVao() const override { return vao; }
-	virtual const unsigned int GetNumberOfVertices() const override { return modelVertices.size(); }
+	virtual const GLuint & GetVao() const override { return gpuMesh->GetVao(); }
+	virtual const unsigned int GetNumberOfVertices() const override { return gpuMesh->GetVertexCount(); }
+	virtual const unsigned int GetNumberOfIndices()  const override { return gpuMesh->GetIndexCount(); }
+	virtual const unsigned int GetFirstIndex()       const override { return 0; }
+	virtual const GLenum       GetIndexType()        const override { return gpuMesh->GetIndexType(); }
+	virtual const VertexDecoding& GetVertexDecoding() const override { return gpuMesh->GetVertexDecoding(); }
 	virtual const glm::mat4 GetWorldTransformation() const override { return Utils::TranslationMatrix(location); }
 	virtual const glm::mat4 GetModelTransformation() const override { return glm::mat4(1.0f);}
 
@@ -1,21 +1,34 @@
 #pragma once
-#include <memory>
+#include <istream>
+#include <type_traits>
 #include <vector>
-#include <string>
-#include <glm/glm.hpp>
 
+/*
+ * Face class.
+ * One triangle of an .obj file: the 1-based vertex, normal and texture coordinate index of each corner
+ * (0 when the file didn't specify one). The indices are stored inline, so a std::vector<Face> is a single
+ * flat allocation that can be copied with memcpy.
+ */
 class Face
 {
 private:
-	std::vector<int> vertexIndices;
-	std::vector<int> normalIndices;
-	std::vector<int> textureIndices;
+	int vertexIndices[3];
+	int normalIndices[3];
+	int textureIndices[3];
 
 public:
+	Face();
 	Face(std::istream& issLine);
-	Face(std::vector<int>& vertices, std::vector<int>& normals, std::vector<int>& textures);
-	virtual ~Face();
-	const int Face::GetVertexIndex(int index);
-	const int Face::GetNormalIndex(int index);
-	const int Face::GetTextureIndex(int index);
-};
\ No newline at end of file
+	Face(const std::vector<int>& vertices, const std::vector<int>& normals, const std::vector<int>& textures);
+	Face(const int vertices[3], const int normals[3], const int textures[3]);
+
+	int GetVertexIndex(int index)  const { return vertexIndices[index]; }
+	int GetNormalIndex(int index)  const { return normalIndices[index]; }
+	int GetTextureIndex(int index) const { return textureIndices[index]; }
+	void SetVertexIndex(int index, int value)  { vertexIndices[index] = value; }
+	void SetNormalIndex(int index, int value)  { normalIndices[index] = value; }
+	void SetTextureIndex(int index, int value) { textureIndices[index] = value; }
+};
+
+static_assert(std::is_trivially_copyable<Face>::value, "Face is copied around in bulk and must stay trivially copyable");
+static_assert(sizeof(Face) == 9 * sizeof(int), "Face must not contain anything but its indices");
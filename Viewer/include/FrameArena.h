@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Size of the first block of a FrameArena
+static constexpr size_t FRAME_ARENA_INITIAL_SIZE = 64 * 1024;
+
+/*
+ * FrameArena class.
+ * Bump allocator for data that only lives for one frame. Allocate just moves a pointer and Reset frees
+ * everything at once. When a frame needed more than one block, Reset replaces them with a single block
+ * big enough for the whole frame, so after the first frames the arena doesn't allocate any more.
+ *
+ * Only for trivially destructible types: nothing allocated from the arena is ever destroyed.
+ */
+class FrameArena
+{
+public:
+	FrameArena();
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	void* Allocate(size_t size, size_t alignment);
+
+	template <typename T>
+	T* AllocateArray(size_t count) { return static_cast<T*>(Allocate(count * sizeof(T), alignof(T))); }
+
+	// Frees everything allocated since the last Reset
+	void Reset();
+
+	// Blocks allocated from the heap since the arena was created
+	size_t GetBlockAllocations() const { return blockAllocations; }
+
+private:
+	struct Block
+	{
+		std::unique_ptr<uint8_t[]> memory;
+		size_t size;
+	};
+
+	std::vector<Block> blocks;
+	size_t used;            // In the last block
+	size_t frameSize;       // Bytes allocated since the last Reset, over all the blocks
+	size_t blockAllocations;
+
+	void addBlock(size_t size);
+};
@@ -0,0 +1,112 @@
+#pragma once
+#include <glad/glad.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+
+// Pixel buffers the frames are read into, in turn. More of them absorb slower encoding before frames drop.
+static constexpr int FRAME_CAPTURE_BUFFERS = 4;
+
+// Frames a capture waits before it is mapped, so the copy is done by then and mapping doesn't stall
+static constexpr int FRAME_CAPTURE_LATENCY = 2;
+
+// Encodes running on the shared thread pool at once. Their copies of the frame are the memory in flight.
+static constexpr int FRAME_CAPTURE_MAX_ENCODES = 8;
+
+struct FrameCaptureStatistics
+{
+	size_t capturedFrames;
+	size_t droppedFrames;       // No free buffer, or too many encodes in flight
+	size_t writtenFiles;
+	size_t failedFiles;
+	size_t pendingFrames;       // Read back, mapped or encoding
+	double lastLatency;         // Seconds from the capture to the written file
+	double maxLatency;
+};
+
+/*
+ * FrameCapture class.
+ * Saves rendered frames without stalling the render loop. Capture starts an asynchronous glReadPixels of the
+ * current framebuffer into a pixel buffer and puts a fence after it. Update (called once per frame) maps the
+ * buffers whose fence has signaled, FRAME_CAPTURE_LATENCY frames or more later, and hands the pixels to the
+ * shared thread pool, which encodes them (ImageWriter) and writes the files.
+ *
+ * Recording captures every frame into a numbered sequence. By default a frame that finds every buffer busy is
+ * dropped rather than waited for, so rendering keeps its rate, and the drops are counted.
+ */
+class FrameCapture
+{
+public:
+	static FrameCapture& Get();
+
+	// colorFile is a .png or .ppm file, depthFile (optional) an .exr file of the window depth values.
+	// False if the frame was dropped.
+	bool Capture(int width, int height, const std::string& colorFile, const std::string& depthFile = "");
+
+	// Sequences: "%d" in the file names becomes the frame number, counted from 0
+	bool StartRecording(const std::string& colorPattern, const std::string& depthPattern = "");
+	void StopRecording()                        { recording = false; }
+	bool IsRecording() const                    { return recording; }
+
+	// Captures the frame if recording
+	void RecordFrame(int width, int height);
+
+	// Hands the frames that are ready to the encoders, once per frame
+	void Update();
+
+	// Waits for every capture to be written
+	void Flush();
+
+	// false makes a capture wait for a free buffer, for sequences that must not miss a frame
+	void SetDropWhenBusy(bool drop)             { dropWhenBusy = drop; }
+
+	FrameCaptureStatistics GetStatistics();
+	void ResetStatistics();
+
+	static std::string GetFrameFilePath(const std::string& pattern, int frame);
+
+private:
+	struct Slot
+	{
+		GLuint colorBuffer;
+		GLuint depthBuffer;
+		GLsync fence;
+		int width;
+		int height;
+		size_t colorBytes;          // Allocated sizes, the buffers grow with the frames
+		size_t depthBytes;
+		std::string colorFile;
+		std::string depthFile;
+		size_t frame;               // Update count at the capture
+		std::chrono::high_resolution_clock::time_point captureTime;
+		bool busy;
+	};
+
+	Slot slots[FRAME_CAPTURE_BUFFERS];
+	int nextSlot;       // Where the next capture goes
+	int oldestSlot;     // The capture Update maps next
+	int busySlots;
+	size_t frame;
+
+	bool dropWhenBusy;
+	bool recording;
+	int recordedFrames;
+	std::string recordColorPattern;
+	std::string recordDepthPattern;
+
+	// Shared with the encoders
+	std::mutex encodeMutex;
+	std::condition_variable encodeDone;
+	int encodesInFlight;
+	FrameCaptureStatistics statistics;
+
+	void createBuffers();
+	void readBack(Slot& slot, bool wait);
+	void encode(Slot& slot);
+
+	FrameCapture();
+	FrameCapture(const FrameCapture&) = delete;
+	FrameCapture& operator=(const FrameCapture&) = delete;
+};
@@ -0,0 +1,99 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Frames kept for the percentiles, the histogram and the CSV export
+static constexpr size_t FRAME_STATISTICS_HISTORY = 1024;
+
+// Buckets of the frame time histogram, from 0 to the slowest frame kept
+static constexpr int FRAME_STATISTICS_HISTOGRAM_BUCKETS = 40;
+
+// OpenGL work of the renderer in a frame (ImGui draws itself and isn't counted)
+struct FrameCounters
+{
+	size_t drawCalls = 0;
+	size_t triangles = 0;           // Submitted, instances included
+	size_t shaderBinds = 0;         // glUseProgram calls the GLStateCache didn't filter out
+	size_t textureBinds = 0;        // glBindTexture calls the GLStateCache didn't filter out
+	size_t uniformUploads = 0;      // glUniform calls of ShaderProgram, uniform buffers not included
+};
+
+// The frame times kept, in seconds
+struct FrameTimeSummary
+{
+	size_t frames = 0;
+	double mean = 0.0;
+	double p50 = 0.0;
+	double p95 = 0.0;
+	double p99 = 0.0;
+	double max = 0.0;
+};
+
+/*
+ * FrameStatistics class.
+ * Keeps the time and the counters of the last FRAME_STATISTICS_HISTORY frames, so the menus can show how
+ * uneven the frames are (percentiles and a histogram rather than an average) and export them as CSV.
+ * TriangleDrawer counts the draws, ShaderProgram the uniforms and GLStateCache the binds.
+ */
+class FrameStatistics
+{
+public:
+	static FrameStatistics& Get();
+
+	void CountDraw(size_t triangles)    { current.drawCalls++; current.triangles += triangles; }
+	void CountShaderBind()              { current.shaderBinds++; }
+	void CountTextureBind()             { current.textureBinds++; }
+	void CountUniformUpload()           { current.uniformUploads++; }
+
+	// Ends a frame: keeps the time since the previous EndFrame (or Reset) and the counters, and starts counting anew
+	void EndFrame();
+
+	// Forgets the frames kept, the next frame is timed from now
+	void Reset();
+
+	// The counters of the last frame
+	const FrameCounters& GetLastCounters() const    { return last; }
+
+	FrameTimeSummary GetSummary() const;
+
+	// The frame times kept in milliseconds, the oldest first
+	void GetFrameTimes(std::vector<float>& times) const;
+
+	// Frames per bucket of FRAME_STATISTICS_HISTOGRAM_BUCKETS, from 0 to maxSeconds
+	void GetHistogram(std::vector<float>& buckets, double& maxSeconds) const;
+
+	// One line per frame kept, false if the file can't be written
+	bool ExportCsv(const std::string& filePath) const;
+
+private:
+	struct Frame
+	{
+		double seconds;
+		FrameCounters counters;
+	};
+
+	std::vector<Frame> frames;          // A ring once it holds FRAME_STATISTICS_HISTORY frames
+	size_t nextFrame;                   // Where the next frame goes
+	size_t framesEnded;                 // Since the last Reset, numbers the frames in the CSV
+	FrameCounters current;
+	FrameCounters last;
+	std::chrono::steady_clock::time_point frameStart;
+
+	// Calls f with every frame kept, the oldest first
+	template <typename F>
+	void forEachFrame(F f) const
+	{
+		size_t count = frames.size();
+		size_t oldest = count < FRAME_STATISTICS_HISTORY ? 0 : nextFrame;
+		for (size_t i = 0; i < count; i++)
+		{
+			f(frames[(oldest + i) % count]);
+		}
+	}
+
+	FrameStatistics();
+	FrameStatistics(const FrameStatistics&) = delete;
+	FrameStatistics& operator=(const FrameStatistics&) = delete;
+};
@@ -0,0 +1,50 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "BoundingVolumes.h"
+
+// Bounding spheres in structure-of-arrays layout, so Frustum::Cull can test four of them at a time
+struct SphereBatch
+{
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> z;
+	std::vector<float> radius;
+
+	size_t Size() const { return radius.size(); }
+	void Clear() { x.clear(); y.clear(); z.clear(); radius.clear(); }
+	void Add(const BoundingSphere& sphere)
+	{
+		x.push_back(sphere.center.x);
+		y.push_back(sphere.center.y);
+		z.push_back(sphere.center.z);
+		radius.push_back(sphere.radius);
+	}
+};
+
+/*
+ * Frustum class.
+ * The six planes of a camera's view volume, extracted from its projection * view matrix (Gribb & Hartmann),
+ * with normals pointing inwards. Used to skip the models that can't be seen before they are drawn.
+ */
+class Frustum
+{
+public:
+	Frustum();
+	explicit Frustum(const glm::mat4& viewProjection);
+
+	// False only when the sphere is completely outside one of the planes
+	bool Intersects(const BoundingSphere& sphere) const;
+
+	// Writes 1 (visible) or 0 (culled) for every sphere in the batch and returns how many are visible.
+	// Cull uses SSE where it is available, CullScalar tests one sphere at a time.
+	size_t Cull(const SphereBatch& spheres, std::vector<uint8_t>& visible) const;
+	size_t CullScalar(const SphereBatch& spheres, std::vector<uint8_t>& visible) const;
+
+private:
+	// xyz is the plane normal, w the distance, so points inside have dot(normal, point) + w >= 0
+	glm::vec4 planes[6];
+
+	size_t cullRange(const SphereBatch& spheres, size_t first, std::vector<uint8_t>& visible) const;
+};
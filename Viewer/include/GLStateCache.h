@@ -0,0 +1,90 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+
+// Texture units tracked by the cache (Texture2D supports the same range)
+static constexpr GLuint STATE_CACHE_TEXTURE_UNITS = 32;
+
+// OpenGL calls the cache made and the ones it filtered out because they wouldn't change anything
+struct GLStateStatistics
+{
+	size_t issued = 0;
+	size_t skipped = 0;
+};
+
+/*
+ * GLStateCache class.
+ * Remembers the program, vertex array, 2D textures, polygon mode and depth state it last set, and only calls
+ * OpenGL when a request actually changes one of them. All the code that changes this state (Renderer,
+ * TriangleDrawer, Texture2D, ShaderProgram, MeshModel) goes through GLStateCache::Get().
+ *
+ * Objects must be deleted through the cache too: OpenGL unbinds deleted objects and may reuse their names.
+ */
+class GLStateCache
+{
+public:
+	static GLStateCache& Get();
+
+	void UseProgram(GLuint program);
+	void BindVertexArray(GLuint vao);
+	void ActiveTexture(GLuint unit);
+	void BindTexture(GLuint texture);               // On the active unit
+	void BindTexture(GLuint unit, GLuint texture);
+	void PolygonMode(GLenum mode);                  // For GL_FRONT_AND_BACK
+	void SetDepthTest(bool enabled);
+	void SetDepthMask(bool enabled);
+	void SetDepthFunc(GLenum function);
+
+	void DeleteProgram(GLuint program);
+	void DeleteVertexArray(GLuint vao);
+	void DeleteTexture(GLuint texture);
+
+	// Forgets the whole state, so the next request of each kind is issued. Needed after code that calls
+	// OpenGL directly (ImGui restores what it changes, but the cache doesn't rely on it).
+	void Invalidate();
+
+	// Starts a new frame: resets the counters and invalidates the state
+	void BeginFrame();
+	const GLStateStatistics& GetFrameStatistics() const { return frame; }
+
+private:
+	GLStateCache();
+	GLStateCache(const GLStateCache&) = delete;
+	GLStateCache& operator=(const GLStateCache&) = delete;
+
+	// Returns true (and counts an issued call) when current differs from value, which then becomes current
+	template <typename T>
+	bool change(T& current, T value, bool& known)
+	{
+		if (known && current == value)
+		{
+			frame.skipped++;
+			return false;
+		}
+		current = value;
+		known = true;
+		frame.issued++;
+		return true;
+	}
+
+	GLuint program;
+	GLuint vao;
+	GLuint activeUnit;
+	GLuint textures[STATE_CACHE_TEXTURE_UNITS];
+	GLenum polygonMode;
+	bool depthTest;
+	bool depthMask;
+	GLenum depthFunc;
+
+	// Whether the values above are known, or have to be set the next time
+	bool programKnown;
+	bool vaoKnown;
+	bool activeUnitKnown;
+	bool texturesKnown[STATE_CACHE_TEXTURE_UNITS];
+	bool polygonModeKnown;
+	bool depthTestKnown;
+	bool depthMaskKnown;
+	bool depthFuncKnown;
+
+	GLStateStatistics frame;
+};
@@ -0,0 +1,62 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "MeshData.h"
+#include "VertexFormat.h"
+
+/*
+ * GpuMesh class.
+ * A mesh uploaded to the GPU: its vao/vbo/ebo and what is needed to draw them. MeshModels share them through
+ * std::shared_ptr handles made by MeshAssetCache, which deletes the buffers after the last handle is gone.
+ */
+class GpuMesh
+{
+public:
+	// Creates the vao/vbo/ebo and uploads the vertices and indices (the data isn't kept on the CPU side)
+	explicit GpuMesh(const MeshView& mesh);
+	~GpuMesh();
+
+	// Attaches the vbo (with its vertex attributes) and the ebo to the bound vao
+	void AttachBuffers() const;
+
+	// Getters
+	const GLuint& GetVao() const                        { return vao; }
+	GLsizei GetVertexCount() const                      { return vertexCount; }
+	GLsizei GetIndexCount() const                       { return indexCount; }
+	GLenum GetIndexType() const                         { return indexType; }
+	VertexFormat GetVertexFormat() const                { return vertexFormat; }
+	const VertexDecoding& GetVertexDecoding() const     { return vertexDecoding; }
+	const glm::vec3& GetMinimums() const                { return minimums; }
+	const glm::vec3& GetMaximums() const                { return maximums; }
+	const std::vector<MeshLod>& GetLods() const         { return lods; }
+	size_t GetBufferBytes() const                       { return bufferBytes; }
+
+private:
+	friend class MeshAssetCache;
+
+	GLuint vao;
+	GLuint vbo;
+	GLuint ebo;
+	GLsizei vertexCount;
+	GLsizei indexCount;
+	GLenum indexType;
+	VertexFormat vertexFormat;
+	VertexDecoding vertexDecoding;
+	glm::vec3 minimums;
+	glm::vec3 maximums;
+
+	// Levels of detail, ranges of the ebo (level 0 is the full mesh)
+	std::vector<MeshLod> lods;
+
+	// Size of the vbo and the ebo
+	size_t bufferBytes;
+
+	// Key of the mesh in MeshAssetCache, empty when it isn't shared
+	std::string cacheKey;
+
+	GpuMesh(const GpuMesh&) = delete;
+	GpuMesh& operator=(const GpuMesh&) = delete;
+};
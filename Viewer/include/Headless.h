@@ -0,0 +1,20 @@
+#pragma once
+#include <string>
+#include "SceneDescription.h"
+
+/*
+ * Headless class.
+ * Renders without a window or the menus, run with "MeshViewer --headless [options]": makes a HeadlessContext,
+ * draws the scene given on the command line (see SceneDescription) into an OffscreenTarget and writes the
+ * frames to PNG/PPM through FrameCapture. Every frame is timed, so it also measures the throughput of
+ * Renderer::Render.
+ */
+class Headless
+{
+public:
+	static int Run(int argc, char** argv);
+
+private:
+	static void printUsage();
+	static int render(const SceneDescription& description, int frames, int warmupFrames, const std::string& traceFile, const std::string& csvFile);
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+/*
+ * HeadlessContext class.
+ * An OpenGL context without a window or a display, made with EGL on a surfaceless display (Mesa's llvmpipe
+ * is enough, no GPU needed). It has no default framebuffer, so everything is drawn into an OffscreenTarget.
+ * Only available where the build found EGL (MESHVIEWER_EGL), Create() fails elsewhere.
+ *
+ * Whatever frees OpenGL objects in its destructor (the scene, the renderer, offscreen targets) has to be gone
+ * before Destroy(). The shared caches (TextureManager, MeshAssetCache, ...) keep theirs until exit, and those
+ * are freed with the context. Textures are loaded synchronously when rendering this way, so every image shows
+ * the final textures rather than the placeholders of textures still streaming in.
+ */
+class HeadlessContext
+{
+private:
+	// Platform handles
+	void* display;
+	void* context;
+
+public:
+	HeadlessContext();
+	HeadlessContext(const HeadlessContext&) = delete;
+	HeadlessContext& operator=(const HeadlessContext&) = delete;
+	~HeadlessContext();
+
+	// Creates the context, makes it current on the calling thread and loads the OpenGL functions
+	bool Create();
+	void Destroy();
+};
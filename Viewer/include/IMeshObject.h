@@ -5,6 +5,7 @@
 #include "ShadingModels.h"
 #include "Face.h"
 #include "Vertex.h"
+#include "VertexFormat.h"
 
 /*
 * Interface for all the objects that are presentable
@@ -18,6 +19,10 @@ public:
 	// Mesh data
 	virtual const GLuint&      GetVao() const = 0;
 	virtual const unsigned int GetNumberOfVertices() const = 0;
+	virtual const unsigned int GetNumberOfIndices()  const = 0; // Drawn as an indexed triangle list
+	virtual const unsigned int GetFirstIndex()       const = 0; // Where the drawn indices start in the element buffer
+	virtual const GLenum       GetIndexType()        const = 0; // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+	virtual const VertexDecoding& GetVertexDecoding() const = 0; // Set as uniforms for the vertex shaders
 	virtual const glm::mat4    GetWorldTransformation() const = 0;
 	virtual const glm::mat4    GetModelTransformation() const = 0;
 };
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+#include <string>
+#include <vector>
+
+/*
+ * ImageWriter class.
+ * Encodes RGBA8 frames (top row first, see OffscreenTarget::ReadPixels) as PNG or binary PPM. The alpha
+ * channel is dropped, rendered frames are opaque. Depth buffers are written as OpenEXR.
+ */
+class ImageWriter
+{
+public:
+	enum class Format
+	{
+		Png,
+		Ppm
+	};
+
+	// The format of a file name's extension, false if it is neither .png nor .ppm
+	static bool GetFormat(const std::string& filePath, Format& format);
+
+	static void Encode(Format format, const unsigned char* rgba, int width, int height, std::vector<unsigned char>& output);
+
+	// A single channel ("Z") 32 bit float OpenEXR image, uncompressed, of depth values top row first
+	static void EncodeExrDepth(const float* depth, int width, int height, std::vector<unsigned char>& output);
+	static bool IsExrFile(const std::string& filePath);
+
+	// Encodes and writes a file, in the format of its extension
+	static bool Write(const std::string& filePath, const unsigned char* rgba, int width, int height);
+	static bool WriteFile(const std::string& filePath, const std::vector<unsigned char>& bytes);
+
+private:
+	static void encodePng(const unsigned char* rgba, int width, int height, std::vector<unsigned char>& output);
+	static void encodePpm(const unsigned char* rgba, int width, int height, std::vector<unsigned char>& output);
+};
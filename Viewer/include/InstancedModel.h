@@ -0,0 +1,92 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+#include "MeshModel.h"
+#include "Material.h"
+#include "Frustum.h"
+#include "IMeshObject.h"
+
+// Vertex attribute locations of the instance data (0 to 2 are the mesh's, see VertexQuantizer::SetupAttributes)
+static constexpr GLuint INSTANCE_TRANSFORM_LOCATION = 3; // A mat4 takes 4 locations
+static constexpr GLuint INSTANCE_AMBIANT_COLOR_LOCATION = 7;
+static constexpr GLuint INSTANCE_DIFFUSE_COLOR_LOCATION = 8;
+static constexpr GLuint INSTANCE_SPECULAR_COLOR_LOCATION = 9;
+static constexpr GLuint INSTANCE_SHININESS_LOCATION = 10;
+
+// One element of the instance buffer, what the vertex shaders read instead of the model and material uniforms
+struct InstanceData
+{
+	glm::mat4 transform;
+	glm::vec4 ambiantColor;
+	glm::vec4 diffuseColor;
+	glm::vec4 specularColor;
+	float shininess;
+	float padding[3];
+};
+static_assert(sizeof(InstanceData) == 128, "InstanceData must match the instance attribute layout");
+
+/*
+ * InstancedModel class.
+ * Many copies of one mesh, each with its own transform and material. The mesh is uploaded once and all
+ * the copies are drawn with one instanced draw call per level of detail; the per-instance data goes
+ * through an instance buffer (attribute divisor 1) instead of uniforms.
+ *
+ * The Renderer culls the instances and uploads the visible ones every frame, so the instance buffer only
+ * holds what is drawn.
+ */
+class InstancedModel : public IMeshObject
+{
+public:
+	// Takes ownership of mesh
+	explicit InstancedModel(MeshModel* mesh);
+	virtual ~InstancedModel();
+
+	// Instances, by index in the order they were added
+	size_t AddInstance(const glm::mat4& transform, const Material& material);
+	void SetInstanceTransform(size_t index, const glm::mat4& transform);
+	void SetInstanceMaterial(size_t index, const Material& material);
+	size_t GetInstanceCount() const                           { return instances.size(); }
+	const InstanceData& GetInstance(size_t index) const       { return instances[index]; }
+
+	// World space bounding spheres of the instances (in the same order), kept up to date for culling
+	const SphereBatch& GetWorldSpheres() const                { return worldSpheres; }
+
+	// Level of detail of every instance, kept between frames for the hysteresis of MeshModel::ChooseLod
+	std::vector<uint8_t>& GetInstanceLods()                   { return instanceLods; }
+
+	MeshModel& GetMesh()                                      { return *mesh; }
+	const MeshModel& GetMesh() const                          { return *mesh; }
+
+	// Replaces the contents of the instance buffer
+	void UploadInstances(const InstanceData* data, size_t count);
+
+	// Points the instance attributes at the element first of the instance buffer, so a draw can start there
+	void SetFirstInstance(size_t first);
+
+	// Inherited via IMeshObject, everything but the vao is the mesh's (at its current level of detail)
+	virtual const GLuint&      GetVao() const override                 { return vao; }
+	virtual const unsigned int GetNumberOfVertices() const override    { return mesh->GetNumberOfVertices(); }
+	virtual const unsigned int GetNumberOfIndices()  const override    { return mesh->GetNumberOfIndices(); }
+	virtual const unsigned int GetFirstIndex()       const override    { return mesh->GetFirstIndex(); }
+	virtual const GLenum       GetIndexType()        const override    { return mesh->GetIndexType(); }
+	virtual const VertexDecoding& GetVertexDecoding() const override   { return mesh->GetVertexDecoding(); }
+	virtual const glm::mat4    GetWorldTransformation() const override { return glm::mat4(1.0f); }
+	virtual const glm::mat4    GetModelTransformation() const override { return glm::mat4(1.0f); }
+
+private:
+	std::unique_ptr<MeshModel> mesh;
+	std::vector<InstanceData> instances;
+	SphereBatch worldSpheres;
+	std::vector<uint8_t> instanceLods;
+
+	// The vao shares the mesh's vbo/ebo and adds the instance buffer
+	GLuint vao;
+	GLuint instanceBuffer;
+
+	void setInstanceAttributes(size_t offset);
+
+	InstancedModel(const InstancedModel&) = delete;
+	InstancedModel& operator=(const InstancedModel&) = delete;
+};
@@ -36,6 +36,10 @@ public:
 	// Inherited via IMeshObject
 	virtual const GLuint & GetVao() const override =0;
 	virtual const unsigned int GetNumberOfVertices() const override =0;
+	virtual const unsigned int GetNumberOfIndices()  const override =0;
+	virtual const unsigned int GetFirstIndex()       const override =0;
+	virtual const GLenum       GetIndexType()        const override =0;
+	virtual const VertexDecoding& GetVertexDecoding() const override =0;
 	virtual const glm::mat4 GetWorldTransformation() const override =0;
 	virtual const glm::mat4 GetModelTransformation() const override =0;
 };
\ No newline at end of file
@@ -0,0 +1,39 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+/*
+ * MappedFile class.
+ * A read-only memory mapping of a whole file. The mapped bytes stay valid until Close() is called
+ * or the object is destroyed, so parsers can scan them in place without copying the file.
+ */
+class MappedFile
+{
+private:
+	const char* data;
+	size_t size;
+
+	// Platform handles
+#ifdef _WIN32
+	void* fileHandle;
+	void* mappingHandle;
+#else
+	int fileDescriptor;
+#endif
+
+public:
+	MappedFile();
+	MappedFile(const std::string& filePath);
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile();
+
+	bool Open(const std::string& filePath);
+	void Close();
+
+	// Getters
+	bool IsOpen() const;
+	const char* GetData() const { return data; }
+	const char* GetEnd()  const { return data + size; }
+	size_t GetSize()      const { return size; }
+};
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "GpuMesh.h"
+#include "MeshData.h"
+
+/*
+ * MeshAssetCache class.
+ * The GPU meshes of the loaded model files, so loading a file again shares the buffers that are already
+ * resident instead of parsing and uploading it once more. Meshes are keyed by the canonical path of the
+ * file, a hash of its contents and the MeshLoadOptions build key, so an edited file is loaded anew.
+ *
+ * Handles are reference counted std::shared_ptrs. When the last one goes away the mesh isn't deleted
+ * right away: it waits for CollectGarbage (called once per frame, outside of any draw), and a load of the
+ * same file before then takes it back. Whatever is resident when the program exits goes with the context.
+ */
+class MeshAssetCache
+{
+public:
+	static MeshAssetCache& Get();
+
+	// The key of a model file, empty when the file can't be read
+	static std::string GetKey(const std::string& filePath, uint64_t buildKey);
+
+	// The resident mesh with this key, nullptr if there is none
+	std::shared_ptr<const GpuMesh> Find(const std::string& key);
+
+	// Uploads a mesh and shares it under key (if key is empty the mesh isn't shared)
+	std::shared_ptr<const GpuMesh> Add(const std::string& key, const MeshView& mesh);
+	std::shared_ptr<const GpuMesh> Upload(const MeshView& mesh) { return Add(std::string(), mesh); }
+
+	// Deletes the meshes that lost their last handle since the previous call
+	void CollectGarbage();
+
+	// Statistics, over every GpuMesh (shared or not)
+	size_t GetResidentMeshes() const     { return residentMeshes; }
+	size_t GetResidentBytes() const      { return residentBytes; }
+	size_t GetSharedLoads() const        { return sharedLoads; }
+
+private:
+	struct Entry
+	{
+		GpuMesh* mesh;
+		std::weak_ptr<const GpuMesh> handle;
+	};
+
+	std::unordered_map<std::string, Entry> entries;
+	std::vector<GpuMesh*> releasedMeshes;
+	size_t residentMeshes;
+	size_t residentBytes;
+	size_t sharedLoads;
+
+	MeshAssetCache();
+	MeshAssetCache(const MeshAssetCache&) = delete;
+	MeshAssetCache& operator=(const MeshAssetCache&) = delete;
+
+	std::shared_ptr<const GpuMesh> makeHandle(GpuMesh* mesh);
+	void release(GpuMesh* mesh);
+	static std::string getCanonicalPath(const std::string& filePath);
+};
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "MappedFile.h"
+#include "MeshData.h"
+
+// Bump whenever the layout of the file or of Vertex changes
+static constexpr uint32_t MESH_CACHE_VERSION = 6;
+
+/*
+ * Header of a .mvbin file. The level of detail table (MeshLod) follows it directly, then the vertex array
+ * and the index array.
+ */
+struct MeshCacheHeader
+{
+	char magic[4];                // "MVBN"
+	uint32_t version;             // MESH_CACHE_VERSION
+	uint32_t vertexStride;        // GetVertexStride(vertexFormat) when the file was written
+	uint32_t vertexFormat;        // VertexFormat of the vertex array
+	uint32_t lodCount;            // 0 when the mesh has no levels of detail
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t indexSize;           // 2 or 4 bytes
+	float minimums[3];
+	float maximums[3];
+	uint64_t sourceSize;          // Size of the .obj file the cache was built from
+	int64_t sourceModifiedTime;   // Its modification time in nanoseconds, 0 to always compare sourceHash
+	uint64_t sourceHash;          // Utils::HashBytes of its contents
+	uint64_t payloadHash;         // Utils::HashBytes of the lod table, vertex and index arrays, catches truncated/corrupt files
+	uint64_t buildKey;            // MeshLoadOptions::GetBuildKey() of the options the mesh was built with
+};
+
+/*
+ * MeshCache class.
+ * A binary sidecar (model.obj.mvbin) that holds the final vertex and index arrays of a model, so launching the viewer
+ * again doesn't have to re-parse the .obj file and recalculate its normals.
+ *
+ * Load() maps the file and validates it against the source .obj. The returned MeshView points straight into
+ * the mapping, so it is only valid while the MeshCache object is alive.
+ */
+class MeshCache
+{
+private:
+	MappedFile file;
+	MeshView mesh;
+
+	static bool getSourceFileStatus(const std::string& sourceFilePath, uint64_t& size, int64_t& modifiedTime);
+	static bool hashFile(const std::string& filePath, uint64_t& hash);
+
+public:
+	static std::string GetCacheFilePath(const std::string& sourceFilePath);
+
+	// Returns false if there is no cache, or if it is stale, corrupt or was built with other options
+	bool Load(const std::string& sourceFilePath, uint64_t buildKey);
+	const MeshView& GetMesh() const { return mesh; }
+
+	static bool Save(const std::string& sourceFilePath, const MeshView& mesh, uint64_t buildKey);
+};
@@ -0,0 +1,111 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "Vertex.h"
+#include "VertexFormat.h"
+
+// Meshes with at most this many vertices are drawn with 16 bit indices
+static constexpr size_t MAX_SHORT_INDEXED_VERTICES = 65536;
+
+/*
+ * A level of detail of a mesh: a range of its index array, drawn with the same vertices as the full mesh.
+ * The error is the largest distance the simplification moved the surface, relative to the bounding box diagonal.
+ */
+struct MeshLod
+{
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	float error;
+};
+
+/*
+ * MeshView struct.
+ * A non-owning view of the final GPU-ready geometry of a mesh: a deduplicated vertex array and the triangle
+ * list indexing it, with 16 or 32 bit indices (indexSize). The arrays may live in a MeshData or directly
+ * inside a memory mapped cache file (MeshCache).
+ * The vertices are Vertex structs in the Float format, or packed by VertexQuantizer in the other formats.
+ * Meshes with levels of detail (MeshSimplifier) keep the indices of every level in the one array.
+ */
+struct MeshView
+{
+	const void* vertices = nullptr;
+	size_t vertexCount = 0;
+	VertexFormat vertexFormat = VertexFormat::Float;
+	const void* indices = nullptr;
+	size_t indexCount = 0;
+	size_t indexSize = sizeof(uint32_t);
+	const MeshLod* lods = nullptr;
+	size_t lodCount = 0;
+	glm::vec3 minimums = glm::vec3(0.0f);
+	glm::vec3 maximums = glm::vec3(0.0f);
+
+	// Level 0 is the full mesh. Without levels of detail it is the whole index array.
+	size_t GetLodCount() const { return lodCount > 0 ? lodCount : 1; }
+	MeshLod GetLod(size_t level) const
+	{
+		MeshLod fullMesh = { 0, (uint32_t)indexCount, 0.0f };
+		return lodCount > 0 ? lods[level] : fullMesh;
+	}
+
+	size_t GetVertexBytes() const { return vertexCount * GetVertexStride(vertexFormat); }
+	size_t GetIndexBytes()  const { return indexCount * indexSize; }
+
+	// Returns the same mesh with 16 bit indices when every vertex fits, they are converted into storage.
+	// Meshes are built with 32 bit indices and only narrowed on their way to the GPU or to the cache.
+	MeshView WithShortIndices(std::vector<uint16_t>& storage) const
+	{
+		if (indexSize != sizeof(uint32_t) || vertexCount > MAX_SHORT_INDEXED_VERTICES)
+		{
+			return *this;
+		}
+
+		const uint32_t* longIndices = (const uint32_t*)indices;
+		storage.assign(longIndices, longIndices + indexCount);
+
+		MeshView view = *this;
+		view.indices = storage.data();
+		view.indexSize = sizeof(uint16_t);
+		return view;
+	}
+};
+
+/*
+ * MeshData struct.
+ * Owns the final vertex and index arrays of a mesh. Build them with a VertexWelder.
+ */
+struct MeshData
+{
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<MeshLod> lods;       // Empty, or the full mesh followed by its coarser levels
+	glm::vec3 minimums = glm::vec3(0.0f);
+	glm::vec3 maximums = glm::vec3(0.0f);
+
+	void CalculateBounds()
+	{
+		if (vertices.empty()) return;
+
+		minimums = maximums = vertices[0].position;
+		for (const Vertex& vertex : vertices)
+		{
+			minimums = glm::min(minimums, vertex.position);
+			maximums = glm::max(maximums, vertex.position);
+		}
+	}
+
+	MeshView GetView() const
+	{
+		MeshView view;
+		view.vertices = vertices.data();
+		view.vertexCount = vertices.size();
+		view.indices = indices.data();
+		view.indexCount = indices.size();
+		view.indexSize = sizeof(uint32_t);
+		view.lods = lods.empty() ? nullptr : lods.data();
+		view.lodCount = lods.size();
+		view.minimums = minimums;
+		view.maximums = maximums;
+		return view;
+	}
+};
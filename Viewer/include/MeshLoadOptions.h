@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include "NormalGenerator.h"
+#include "VertexFormat.h"
+
+/*
+ * MeshLoadOptions struct.
+ * Knobs for Utils::LoadMeshModel. The defaults are what the viewer uses.
+ */
+struct MeshLoadOptions
+{
+	// Threads used to parse the .obj file. 0 uses every core, 1 parses on the calling thread only.
+	unsigned int parserThreads = 0;
+
+	// Read/write the binary model.obj.mvbin next to the model, see MeshCache
+	bool useMeshCache = true;
+
+	// Share the GPU buffers of files that are already loaded, see MeshAssetCache
+	bool shareGpuMeshes = true;
+
+	// How the vertex normals are generated
+	NormalWeighting normalWeighting = NormalWeighting::Average;
+
+	// Faces meeting at a sharper angle (in degrees) than this get separate normals. 180 smooths everything.
+	float creaseAngle = 180.0f;
+
+	// Reorder triangles and vertices for the GPU's vertex cache and less overdraw, see MeshOptimizer
+	bool optimizeMesh = true;
+
+	// Coarser levels of detail built for dense meshes, see MeshSimplifier. 0 disables them.
+	unsigned int lodLevels = 4;
+
+	// How the vertices are stored on the GPU, see VertexQuantizer. Auto picks the smallest format per mesh
+	// that stays within the quantization tolerances, and falls back to Float.
+	VertexFormat vertexFormat = VertexFormat::Auto;
+
+	// Identifies the options that change the built mesh, a cache built with other options is rebuilt
+	uint64_t GetBuildKey() const
+	{
+		uint64_t key = (uint64_t)normalWeighting | (optimizeMesh ? 0x80 : 0) | ((uint64_t)vertexFormat << 32) | ((uint64_t)lodLevels << 40);
+		if (creaseAngle < 180.0f)
+		{
+			key |= (uint64_t)(creaseAngle * 1000.0f) << 8;
+		}
+		return key;
+	}
+};
@@ -7,12 +7,22 @@
 #include "Face.h"
 #include "Material.h"
 #include "Vertex.h"
+#include "MeshData.h"
 #include "IMovable.h"
 #include "IRotatable.h"
 #include "IMeshObject.h"
 #include "IScalable.h"
 #include "IUniformMaterial.h"
 #include "Texture2D.h"
+#include "GLStateCache.h"
+#include "BoundingVolumes.h"
+#include "GpuMesh.h"
+#include <vector>
+#include <algorithm>
+
+// A coarser level of detail is only picked once its error is this fraction of the allowed screen error,
+// so models sitting at a threshold don't flicker between two levels
+static constexpr float LOD_HYSTERESIS = 0.75f;
 
 /*
  * MeshModel class.
@@ -48,35 +58,44 @@ protected:
 	glm::mat4x4 GetYRotationMatrix()   const;
 	glm::mat4x4 GetZRotationMatrix()   const;
 	
-	// Necessary for rotations
+	// Necessary for rotations (the center of the bounding box)
 	glm::vec3 centerPoint;
 
-	// Stuff that I haven't figured out what to do with yet
+	// Bounds of the mesh in model space, set when it is uploaded
 	glm::vec3 minimums;
 	glm::vec3 maximums;
+	BoundingSphere boundingSphere;
 	glm::vec3& GetCenterPoint()						        { return centerPoint; }
 	glm::vec3& GetMinimumsVector()					        { return minimums; }
 	glm::vec3& GetMaximumVectors()					        { return maximums; }
 
-	// Texture
-	Texture2D texture;
-	bool textureLoaded;
+	// Texture, shared with the other models that use the same image (see TextureManager)
+	std::shared_ptr<const Texture2D> texture;
 
-	// OpenGL stuff
+	// OpenGL stuff. The buffers may be shared with other models (see MeshAssetCache).
 	glm::mat4x4 modelTransform;
-	std::vector<Vertex> modelVertices;
-	GLuint vao;
-	GLuint vbo;
+	std::shared_ptr<const GpuMesh> gpuMesh;
+
+	// Level of detail drawn (level 0 is the full mesh), every model sharing the mesh picks its own
+	size_t currentLod;
+
+	// Uploads the vertices and indices into a mesh of this model only
+	void uploadMesh(const MeshView& mesh);
+	void setGpuMesh(const std::shared_ptr<const GpuMesh>& mesh);
 	
 	// Bump mapping
-	Texture2D* bumpMap;
+	std::shared_ptr<const Texture2D> bumpMap;
 
 public:
 	// ctors
-	MeshModel() {}
-	MeshModel(std::vector<Face> faces, std::vector<glm::vec3> vertices, const std::string& modelName);
-	MeshModel(std::vector<Face> faces, std::vector<glm::vec3> vertices, std::vector<glm::vec2> textureCoords, const std::string& modelName, const std::string& textureFileName);
-	MeshModel(std::vector<Face> faces, std::vector<glm::vec3> vertices, std::vector<glm::vec3> normals, std::vector<glm::vec2> textureCoords, const std::string & modelName); 
+	MeshModel() : currentLod(0) {}
+	MeshModel(const std::shared_ptr<const GpuMesh>& mesh, const std::string& modelName);
+	MeshModel(const std::shared_ptr<const GpuMesh>& mesh, const std::string& modelName, const std::string& textureFileName);
+	MeshModel(const MeshView& mesh, const std::string& modelName);
+	MeshModel(const MeshView& mesh, const std::string& modelName, const std::string& textureFileName);
+	MeshModel(const std::vector<Face>& faces, const std::vector<glm::vec3>& vertices, const std::string& modelName);
+	MeshModel(const std::vector<Face>& faces, const std::vector<glm::vec3>& vertices, const std::vector<glm::vec2>& textureCoords, const std::string& modelName, const std::string& textureFileName);
+	MeshModel(const std::vector<Face>& faces, const std::vector<glm::vec3>& vertices, const std::vector<glm::vec3>& normals, const std::vector<glm::vec2>& textureCoords, const std::string & modelName);
 	virtual ~MeshModel();
 
 	// Setters
@@ -88,12 +107,30 @@ public:
 	const glm::vec3& GetTranslationVector()	         const  { return translationVector; }
 	Material& GetUniformMaterial()                          { return uniformMaterial; }
 
-	// Textures
-	void BindTextures()  const                                    { texture.bind(0); }
-	void UnbindTextures() const                                   { texture.unbind(0); }
-	const bool TextureLoaded() const                              { return textureLoaded; }
+	// Textures, the texture is on unit 0 and the bump map on unit 1
+	void BindTextures() const;
+	void UnbindTextures() const                                   { GLStateCache::Get().BindTexture(0, 0); }
+	const bool TextureLoaded() const                              { return texture != nullptr && !texture->hasFailed(); }
+	GLuint GetTextureId() const                                   { return texture ? texture->getTexture() : 0; }
+
+	const Texture2D* GetBumpMap() const { return bumpMap && !bumpMap->hasFailed() ? bumpMap.get() : nullptr; }
+
+	// Bounds, in model space and in world space (after GetWorldTransformation)
+	BoundingBox GetBoundingBox() const;
+	const BoundingSphere& GetBoundingSphere() const               { return boundingSphere; }
+	BoundingSphere GetWorldBoundingSphere() const                 { return boundingSphere.Transformed(GetWorldTransformation()); }
+
+	// Level of detail
+	size_t GetLodCount() const                                    { return gpuMesh->GetLods().size(); }
+	size_t GetCurrentLod() const                                  { return currentLod; }
+	const MeshLod& GetLod(size_t level) const                     { return gpuMesh->GetLods()[level]; }
+	void SetLod(size_t level)                                     { currentLod = std::min(level, GetLodCount() - 1); }
+	void SelectLod(float projectedSize, float maxPixelError);
+	size_t ChooseLod(float projectedSize, float maxPixelError, size_t currentLevel) const;
 
-	Texture2D* GetBumpMap() const { return bumpMap; }
+	// The GPU buffers, AttachBuffers adds them to the bound vao so other vaos can share the mesh
+	const std::shared_ptr<const GpuMesh>& GetGpuMesh() const      { return gpuMesh; }
+	void AttachBuffers() const                                    { gpuMesh->AttachBuffers(); }
 
 	#pragma region Interfaces Implementations
 	// Inherited via IMovable
@@ -105,8 +142,12 @@ public:
 	virtual void RotateZ(const float angle) override;
 
 	// Inherited via IMeshObject
-	virtual const GLuint&      GetVao() const override { return vao; }
-	virtual const unsigned int GetNumberOfVertices() const override { return modelVertices.size(); }
+	virtual const GLuint&      GetVao() const override { return gpuMesh->GetVao(); }
+	virtual const unsigned int GetNumberOfVertices() const override { return gpuMesh->GetVertexCount(); }
+	virtual const unsigned int GetNumberOfIndices()  const override { return gpuMesh->GetLods().empty() ? 0 : GetLod(currentLod).indexCount; }
+	virtual const unsigned int GetFirstIndex()       const override { return gpuMesh->GetLods().empty() ? 0 : GetLod(currentLod).firstIndex; }
+	virtual const GLenum       GetIndexType()        const override { return gpuMesh->GetIndexType(); }
+	virtual const VertexDecoding& GetVertexDecoding() const override { return gpuMesh->GetVertexDecoding(); }
 	virtual const glm::mat4 GetWorldTransformation() const;
 	virtual const glm::mat4 GetModelTransformation() const { return glm::mat4(1.0f); }
 	
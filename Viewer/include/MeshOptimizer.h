@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "MeshData.h"
+
+// Size of the FIFO post-transform cache that the statistics are simulated with (typical for real GPUs)
+static constexpr unsigned int VERTEX_CACHE_SIMULATION_SIZE = 16;
+
+/*
+ * How well an index buffer uses the post-transform vertex cache.
+ * ACMR: vertex shader invocations per triangle (0.5 is the best possible on big meshes, 3 the worst).
+ * ATVR: vertex shader invocations per vertex (1 is the best possible).
+ */
+struct VertexCacheStatistics
+{
+	double acmr = 0.0;
+	double atvr = 0.0;
+};
+
+struct MeshOptimizationStatistics
+{
+	VertexCacheStatistics before;
+	VertexCacheStatistics after;
+	size_t overdrawClusters = 0;
+	double seconds = 0.0;
+};
+
+/*
+ * MeshOptimizer class.
+ * Reorders an indexed mesh for faster rendering, without changing what it looks like:
+ *   1. Triangles are reordered for the post-transform vertex cache (Forsyth's linear-speed algorithm).
+ *   2. That order is cut into clusters that keep the cache efficiency, and the clusters are sorted so the ones
+ *      most likely to occlude the rest are drawn first, which reduces overdraw (as in Sander et al.'s Tipsify).
+ *   3. Vertices are renumbered in the order they are first used, so vertex fetches walk through memory.
+ * Works on the 32 bit indices of a MeshData, before it is narrowed for the GPU.
+ */
+class MeshOptimizer
+{
+public:
+	static void Optimize(MeshData& mesh, MeshOptimizationStatistics& statistics);
+
+	static void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+	static size_t OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices);
+	static void OptimizeVertexFetch(std::vector<uint32_t>& indices, std::vector<Vertex>& vertices);
+
+	static VertexCacheStatistics AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount,
+		unsigned int cacheSize = VERTEX_CACHE_SIMULATION_SIZE);
+};
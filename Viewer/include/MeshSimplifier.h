@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "MeshData.h"
+
+// Every level of detail targets this fraction of the previous level's triangles
+static constexpr float LOD_REDUCTION = 0.5f;
+// Meshes smaller than this get no levels of detail, and no level is made smaller than MIN_LOD_TRIANGLES
+static constexpr size_t MIN_LOD_SOURCE_TRIANGLES = 2048;
+static constexpr size_t MIN_LOD_TRIANGLES = 128;
+
+/*
+ * MeshSimplifier class.
+ * Quadric error edge-collapse simplification (Garland & Heckbert) that only rewrites the index array:
+ * every collapse moves a vertex onto one of its neighbours, so the simplified triangles still index
+ * the original vertices and all the levels of detail of a mesh share its vertex buffer.
+ *
+ * Open borders are kept in place with extra edge quadrics. Vertices on normal/texture seams (several
+ * vertices at one position) and non-manifold vertices are never moved, so the seams can't tear open.
+ */
+class MeshSimplifier
+{
+public:
+	// Returns about targetIndexCount indices (more if the mesh can't be simplified that far). error receives the
+	// largest distance a collapse moved the surface, relative to the bounding box diagonal.
+	static std::vector<uint32_t> Simplify(const std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices,
+		size_t targetIndexCount, float& error);
+
+	// Builds up to levelCount coarser levels of mesh on the shared thread pool. Their indices are appended to
+	// mesh.indices and described by mesh.lods, after the full mesh (level 0).
+	static void GenerateLods(MeshData& mesh, unsigned int levelCount, unsigned int threadCount = 0);
+
+private:
+	// Sum of squared distances to a set of planes, weighted by the area the planes came from
+	struct Quadric
+	{
+		double a00, a01, a02, a11, a12, a22;
+		double b0, b1, b2;
+		double c;
+		double area;
+
+		void AddPlane(const glm::dvec3& normal, double distance, double weight);
+		void Add(const Quadric& other);
+		double Evaluate(const glm::dvec3& point) const;
+	};
+
+	struct Collapse
+	{
+		double error;
+		uint32_t from;
+		uint32_t to;
+
+		bool operator<(const Collapse& other) const { return error < other.error; }
+	};
+
+	static void lockSeams(const std::vector<Vertex>& vertices, std::vector<uint8_t>& locked);
+	static void buildAdjacency(const std::vector<uint32_t>& triangles, const std::vector<uint8_t>& removed, size_t vertexCount,
+		std::vector<uint32_t>& offsets, std::vector<uint32_t>& adjacency);
+	static bool flipsTriangles(const std::vector<uint32_t>& triangles, const std::vector<uint8_t>& removed,
+		const uint32_t* adjacent, const uint32_t* adjacentEnd, uint32_t from, uint32_t to, const std::vector<Vertex>& vertices);
+};
@@ -0,0 +1,74 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "Face.h"
+
+/*
+ * How much each adjacent face contributes to a vertex normal.
+ */
+enum class NormalWeighting
+{
+	Average, // Every face counts the same (what the viewer always did)
+	Area,    // Bigger faces count more
+	Angle    // Faces count by their angle at the vertex, so the result doesn't depend on the tessellation
+};
+
+/*
+ * NormalGenerator class.
+ * Computes smooth vertex normals of an indexed triangle mesh, working on the parsed arrays in place.
+ *
+ * Both are race free without any locking. Generate splits the faces into one contiguous range per thread,
+ * every thread sums the face normals into its own partial sums, and the partial sums are then added up per
+ * vertex in parallel. GenerateWithCreases needs all the faces around a vertex at once, so it builds a
+ * vertex -> corners table (a counting sort of the corners on their vertex) and gathers per vertex.
+ *
+ * Faces use the 1-based .obj indices. Vertices without any (non degenerate) face get a zero normal.
+ * Both throw std::out_of_range if a face refers to a vertex that doesn't exist. threadCount 0 uses every core.
+ */
+class NormalGenerator
+{
+public:
+	// One normal per vertex, indexed like the vertices
+	static std::vector<glm::vec3> Generate(const std::vector<glm::vec3>& vertices, const std::vector<Face>& faces,
+		NormalWeighting weighting = NormalWeighting::Average, unsigned int threadCount = 0);
+
+	// Like Generate, but only faces whose normals are less than creaseAngle (in degrees) apart are smoothed together,
+	// so hard edges stay hard. A vertex gets one normal per smoothing group: the normal indices of the faces are
+	// rewritten to point into the returned array.
+	static std::vector<glm::vec3> GenerateWithCreases(const std::vector<glm::vec3>& vertices, std::vector<Face>& faces,
+		float creaseAngle, NormalWeighting weighting = NormalWeighting::Average, unsigned int threadCount = 0);
+
+private:
+	// The corners (3 * face + corner) around each vertex, those of vertex i are corners[offsets[i]..offsets[i + 1])
+	struct VertexCorners
+	{
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> corners;
+	};
+
+	// Normal sums of the vertices firstVertex..firstVertex + sums.size() - 1, from one range of faces
+	struct PartialSums
+	{
+		size_t firstVertex = 0;
+		std::vector<glm::vec3> sums;
+	};
+
+	// Unit normal of every face and, unless weighting is Average, the weight of every corner
+	struct FaceNormals
+	{
+		std::vector<glm::vec3> normals;
+		std::vector<float> cornerWeights;
+
+		glm::vec3 GetContribution(uint32_t corner) const
+		{
+			return cornerWeights.empty() ? normals[corner / 3] : normals[corner / 3] * cornerWeights[corner];
+		}
+	};
+
+	static void computeFaceNormals(const std::vector<glm::vec3>& vertices, const std::vector<Face>& faces,
+		NormalWeighting weighting, FaceNormals& faceNormals, unsigned int threadCount);
+	static void accumulatePart(const std::vector<glm::vec3>& vertices, const std::vector<Face>& faces,
+		size_t firstFace, size_t lastFace, NormalWeighting weighting, PartialSums& part);
+	static void collectVertexCorners(size_t vertexCount, const std::vector<Face>& faces, VertexCorners& vertexCorners);
+};
@@ -0,0 +1,69 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include "Face.h"
+
+/*
+ * The raw contents of an .obj file, in file order.
+ * Face indices are kept exactly as written in the file (1-based).
+ */
+struct ObjData
+{
+	std::vector<glm::vec3> vertices;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> textureCoords;
+	std::vector<Face> faces;
+	size_t unknownLines = 0;
+};
+
+struct ObjParseStatistics
+{
+	size_t bytes = 0;
+	double seconds = 0.0;
+
+	double GetMegabytesPerSecond() const { return seconds > 0.0 ? (bytes / (1024.0 * 1024.0)) / seconds : 0.0; }
+};
+
+/*
+ * ObjParser class.
+ * Parses .obj files straight out of a memory mapped file. Lines are scanned in place by a hand written
+ * tokenizer, so there are no per-line strings/streams and the results don't depend on the locale.
+ *
+ * Floats are converted with an exact fast path (the same result std::strtof would give) and only fall back
+ * to std::strtof for the rare values the fast path can't round correctly.
+ *
+ * Big files are split into newline aligned chunks that are parsed in parallel and then merged in file order.
+ * threadCount 0 means "use every core", 1 parses on the calling thread only.
+ */
+class ObjParser
+{
+public:
+	static bool ParseFile(const std::string& filePath, ObjData& data, ObjParseStatistics& statistics, unsigned int threadCount = 0);
+	static void Parse(const char* begin, const char* end, ObjData& data, unsigned int threadCount = 0);
+
+private:
+	// Faces that used relative (negative) indices. Those are stored relative to the start of
+	// their chunk and only become global once the element counts of the previous chunks are known.
+	struct RelativeFace
+	{
+		size_t faceIndex;
+		unsigned int cornerMask; // bit (3 * kind + corner), kind is vertex/texture/normal
+	};
+
+	struct Chunk
+	{
+		const char* begin;
+		const char* end;
+		ObjData data;
+		std::vector<RelativeFace> relativeFaces;
+	};
+
+	static void parseChunk(Chunk& chunk);
+	static void mergeChunks(std::vector<Chunk>& chunks, ObjData& data, unsigned int threadCount);
+	static void parseLine(const char* cursor, const char* lineEnd, Chunk& chunk);
+	static const char* parseFace(const char* cursor, const char* lineEnd, Chunk& chunk);
+	static const char* parseFloat(const char* cursor, const char* lineEnd, float& value);
+	static const char* parseInt(const char* cursor, const char* lineEnd, int& value);
+	static const char* skipSpaces(const char* cursor, const char* lineEnd);
+};
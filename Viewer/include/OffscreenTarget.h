@@ -0,0 +1,40 @@
+#pragma once
+#include <glad/glad.h>
+#include <vector>
+
+/*
+ * OffscreenTarget class.
+ * A framebuffer object with an RGBA8 color and a 24 bit depth renderbuffer, for rendering without a window.
+ * While it is bound the renderer draws into it exactly as into a window's default framebuffer.
+ */
+class OffscreenTarget
+{
+public:
+	OffscreenTarget();
+	~OffscreenTarget();
+
+	// Creates (or resizes) the renderbuffers, returns false if the driver can't render into them
+	bool Create(int width, int height);
+
+	// Binds the framebuffer and sets the viewport to all of it
+	void Bind() const;
+
+	// Copies the color buffer into rgba (width * height * 4 bytes), top row first like image files
+	void ReadPixels(std::vector<unsigned char>& rgba) const;
+
+	// Copies the depth buffer into depth (width * height values from 0 to 1), top row first
+	void ReadDepth(std::vector<float>& depth) const;
+
+	int GetWidth() const  { return width; }
+	int GetHeight() const { return height; }
+
+private:
+	GLuint framebuffer;
+	GLuint colorBuffer;
+	GLuint depthBuffer;
+	int width;
+	int height;
+
+	OffscreenTarget(const OffscreenTarget&) = delete;
+	OffscreenTarget& operator=(const OffscreenTarget&) = delete;
+};
@@ -30,6 +30,10 @@ public:
 	// Inherited via LightSource
 	virtual const GLuint & GetVao()                  const override {return model->GetVao();}
 	virtual const unsigned int GetNumberOfVertices() const override {return model->GetNumberOfVertices();}
+	virtual const unsigned int GetNumberOfIndices()  const override {return model->GetNumberOfIndices();}
+	virtual const unsigned int GetFirstIndex()       const override {return model->GetFirstIndex();}
+	virtual const GLenum       GetIndexType()        const override {return model->GetIndexType();}
+	virtual const VertexDecoding& GetVertexDecoding() const override {return model->GetVertexDecoding();}
 	virtual const glm::mat4 GetWorldTransformation() const override {return model->GetWorldTransformation();}
 	virtual const glm::mat4 GetModelTransformation() const override {return model->GetModelTransformation();}
 
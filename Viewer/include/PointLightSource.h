@@ -23,6 +23,10 @@ public:
 	// Inherited via LightSource
 	virtual const GLuint & GetVao()                  const override { return cubeModel.GetVao(); }
 	virtual const unsigned int GetNumberOfVertices() const override { return cubeModel.GetNumberOfVertices(); }
+	virtual const unsigned int GetNumberOfIndices()  const override { return cubeModel.GetNumberOfIndices(); }
+	virtual const unsigned int GetFirstIndex()       const override { return cubeModel.GetFirstIndex(); }
+	virtual const GLenum       GetIndexType()        const override { return cubeModel.GetIndexType(); }
+	virtual const VertexDecoding& GetVertexDecoding() const override { return cubeModel.GetVertexDecoding(); }
 	virtual const glm::mat4 GetWorldTransformation() const override { return cubeModel.GetWorldTransformation(); }
 	virtual const glm::mat4 GetModelTransformation() const override { return cubeModel.GetModelTransformation(); }
 };
@@ -0,0 +1,174 @@
+#pragma once
+#include <glad/glad.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Zones kept per thread for the trace, a thread's oldest zones are overwritten by its new ones
+static constexpr size_t PROFILER_EVENTS_PER_THREAD = 65536;
+
+// Frames between a GPU zone and reading its timestamps, by then the GPU is done with them and reading doesn't stall
+static constexpr int PROFILER_GPU_LATENCY = 3;
+
+// GPU zones a frame can have, the frame zone included. The ones past it are not measured.
+static constexpr int PROFILER_GPU_ZONES_PER_FRAME = 64;
+
+// The thread of the GPU zones in the events and the trace
+static constexpr uint32_t PROFILER_GPU_THREAD = 0;
+
+// A zone that ended, in nanoseconds since the profiler started
+struct ProfilerEvent
+{
+	const char* name;       // A string literal, only the pointer is kept
+	int64_t start;
+	int64_t end;
+	uint32_t depth;         // 0 is the frame (or a zone outside of the frames)
+	uint32_t thread;        // PROFILER_GPU_THREAD for GPU zones
+};
+
+// The zones of a frame with the same name and depth, summed
+struct ProfilerZoneTime
+{
+	const char* name;
+	uint32_t depth;
+	uint32_t calls;
+	double seconds;
+};
+
+/*
+ * Profiler class.
+ * Collects nested CPU zones (ProfileZone) of every thread and GPU zones (GpuProfileZone) of the render thread.
+ *
+ * Every thread writes its zones into a ring of its own, so recording a zone takes no lock. GPU zones are pairs
+ * of timestamp queries, read PROFILER_GPU_LATENCY frames later, and placed on the CPU timeline with the GPU
+ * clock read at the start of their frame. The last frame is summed per zone for the menus, and the rings can
+ * be exported as a Chrome trace (chrome://tracing or ui.perfetto.dev).
+ */
+class Profiler
+{
+public:
+	static Profiler& Get();
+
+	// Bounds of a frame on the render thread, which become the "Frame" zone on the CPU and on the GPU
+	void BeginFrame();
+	void EndFrame();
+
+	void SetEnabled(bool enable)            { enabled.store(enable, std::memory_order_relaxed); }
+	bool IsEnabled() const                  { return enabled.load(std::memory_order_relaxed); }
+
+	// False when the driver has no timestamp queries (before OpenGL 3.3), GPU zones are then ignored
+	bool HasGpuTimer() const                { return gpuTimer; }
+
+	// Name of the calling thread in the trace
+	void SetThreadName(const std::string& name);
+
+	// The zones of the last frame, in the order they started. The GPU zones are of the frame
+	// PROFILER_GPU_LATENCY frames before it.
+	const std::vector<ProfilerZoneTime>& GetCpuFrame() const  { return cpuFrame; }
+	const std::vector<ProfilerZoneTime>& GetGpuFrame() const  { return gpuFrame; }
+
+	// Sum of the zones of the last frame called name, 0 if there were none
+	double GetCpuSeconds(const char* name) const;
+	double GetGpuSeconds(const char* name) const;
+
+	// Every zone still in the rings, false if the file can't be written. Called on the render thread.
+	bool ExportChromeTrace(const std::string& filePath);
+
+	// Nanoseconds since the profiler started
+	int64_t Now() const;
+
+private:
+	struct ThreadBuffer
+	{
+		std::unique_ptr<ProfilerEvent[]> events;
+		std::atomic<uint64_t> written;      // Zones ever written, the next goes to written % PROFILER_EVENTS_PER_THREAD
+		uint32_t thread;
+		uint32_t depth;                     // Zones open, only used by the thread itself
+		std::string name;
+	};
+
+	struct GpuFrame
+	{
+		GLuint queries[PROFILER_GPU_ZONES_PER_FRAME * 2];
+		const char* names[PROFILER_GPU_ZONES_PER_FRAME];
+		uint32_t depths[PROFILER_GPU_ZONES_PER_FRAME];
+		int zones;
+		int64_t clockOffset;                // CPU time minus GPU time at the start of the frame
+	};
+
+	std::atomic<bool> enabled;
+	int64_t startTime;
+
+	// Registered when a thread records its first zone, and never released
+	std::vector<std::unique_ptr<ThreadBuffer>> threads;
+	std::mutex threadsMutex;
+
+	// The render thread's frame
+	bool inFrame;
+	int64_t frameStart;
+	uint64_t frameFirstEvent;
+	std::vector<ProfilerZoneTime> cpuFrame;
+
+	bool gpuTimer;
+	bool gpuQueriesCreated;
+	GpuFrame gpuFrames[PROFILER_GPU_LATENCY + 1];
+	int gpuFrameIndex;
+	uint32_t gpuDepth;
+	std::vector<ProfilerZoneTime> gpuFrame;
+	std::vector<ProfilerEvent> gpuEvents;   // A ring like the threads'
+	uint64_t gpuEventsWritten;
+
+	ThreadBuffer& getThreadBuffer();
+	void record(ThreadBuffer& buffer, const char* name, int64_t start, int64_t end, uint32_t depth);
+	void createGpuQueries();
+	void resolveGpuFrame(GpuFrame& frame);
+	static void sumZones(std::vector<ProfilerEvent>& events, std::vector<ProfilerZoneTime>& zones);
+	static double getSeconds(const std::vector<ProfilerZoneTime>& zones, const char* name);
+
+	friend class ProfileZone;
+	friend class GpuProfileZone;
+
+	Profiler();
+	Profiler(const Profiler&) = delete;
+	Profiler& operator=(const Profiler&) = delete;
+};
+
+/*
+ * ProfileZone class.
+ * Times the scope it is declared in, on the calling thread: ProfileZone zone("Draw models");
+ */
+class ProfileZone
+{
+public:
+	explicit ProfileZone(const char* name);
+	~ProfileZone();
+
+private:
+	const char* name;
+	int64_t start;
+	bool active;
+
+	ProfileZone(const ProfileZone&) = delete;
+	ProfileZone& operator=(const ProfileZone&) = delete;
+};
+
+/*
+ * GpuProfileZone class.
+ * Times the OpenGL commands issued in its scope, on the render thread between BeginFrame and EndFrame.
+ */
+class GpuProfileZone
+{
+public:
+	explicit GpuProfileZone(const char* name);
+	~GpuProfileZone();
+
+private:
+	int zone;       // In the frame's queries, -1 if not measured
+
+	GpuProfileZone(const GpuProfileZone&) = delete;
+	GpuProfileZone& operator=(const GpuProfileZone&) = delete;
+};
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "FrameArena.h"
+
+// Sort key fields, from the most significant bits down. Draws are ordered by pass, then grouped by shader
+// program and texture so those switch as rarely as possible, then by material, and finally front to back
+// so early depth testing can reject hidden fragments.
+static constexpr int SORT_KEY_PASS_BITS = 2;
+static constexpr int SORT_KEY_SHADER_BITS = 4;
+static constexpr int SORT_KEY_TEXTURE_BITS = 16;
+static constexpr int SORT_KEY_MATERIAL_BITS = 16;
+static constexpr int SORT_KEY_DEPTH_BITS = 26;
+static_assert(SORT_KEY_PASS_BITS + SORT_KEY_SHADER_BITS + SORT_KEY_TEXTURE_BITS + SORT_KEY_MATERIAL_BITS + SORT_KEY_DEPTH_BITS == 64,
+	"The sort key fields must fill 64 bits");
+
+enum RenderPass
+{
+	RENDER_PASS_OPAQUE = 0
+};
+
+// One draw: its sort key and the index of what to draw (the caller decides what the index refers to)
+struct RenderCommand
+{
+	uint64_t key;
+	uint32_t item;
+};
+
+/*
+ * RenderQueue class.
+ * The draws of a frame, sorted by their 64 bit keys with a radix sort. The commands live in a FrameArena,
+ * so building the queue every frame doesn't allocate once the arena has grown to the frame's size.
+ */
+class RenderQueue
+{
+public:
+	RenderQueue() : commands(nullptr), scratch(nullptr), count(0), capacity(0) {}
+
+	// Packs the fields (each is cut to its width). depth is the distance from the camera; negative depths
+	// sort as 0.
+	static uint64_t MakeKey(unsigned int pass, unsigned int shader, unsigned int texture, unsigned int material, float depth);
+
+	// Empties the queue, making room for up to capacity commands in the frame's arena
+	void Begin(FrameArena& arena, size_t capacity);
+	void Add(uint64_t key, uint32_t item);
+
+	// Stable least significant digit radix sort, 8 bits per pass. Passes where every key has the same
+	// byte are skipped, which is most of them (the pass and shader bytes rarely differ).
+	void Sort();
+
+	size_t Size() const { return count; }
+	const RenderCommand* begin() const { return commands; }
+	const RenderCommand* end() const { return commands + count; }
+
+private:
+	RenderCommand* commands;
+	RenderCommand* scratch;
+	size_t count;
+	size_t capacity;
+};
@@ -6,6 +6,11 @@
 #include "TriangleDrawer.h"
 #include "Fogger.h"
 #include "ShaderProgram.h"
+#include "ShaderVariantCache.h"
+#include "Frustum.h"
+#include "UniformBuffer.h"
+#include "FrameArena.h"
+#include "RenderQueue.h"
 #include <vector>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
@@ -29,16 +34,41 @@ private:
 	// Drawing
 	TriangleDrawer triangleDrawer;
 
-	// Shaders
-	ShaderProgram* activeShader;
-	ShaderProgram colorShader;
-	ShaderProgram normalMappingShader;
+	// Culling, kept between frames so they don't allocate every frame
+	SphereBatch worldSpheres;
+	std::vector<uint8_t> modelVisibility;
+
+	// Culling and levels of detail of the instances of an InstancedModel
+	std::vector<uint8_t> instanceVisibility;
+	std::vector<size_t> instancesPerLod;
+
+	// The frame's draws, sorted to change state as rarely as possible. Their memory comes from frameArena.
+	FrameArena frameArena;
+	RenderQueue renderQueue;
+
+	// Shaders, a program per combination of features (see ShaderVariantCache)
+	ShaderVariantCache shaders;
+	ShaderVariant* activeVariant;
+	uint32_t frameShaderFeatures;   // The features every draw of the frame has
+	unsigned int frameLightCount;
+
+	// Per-frame shader data (see UniformBlocks.h)
+	UniformBuffer cameraData;
+	UniformBuffer lightingData;
 
 	// Render methods
+	void updateFrameData();
 	void drawModels();
+	void drawInstancedModels();
+	void drawInstancedModel(InstancedModel& instancedModel, GLint viewportHeight);
 	void drawLights();
 	void drawFloor();
 	void drawMeshModel(const MeshModel & model);
+	void useShader(uint32_t features);
+	uint32_t getShaderFeatures(const MeshModel& model) const;
+	void setVertexDecoding(const IMeshObject& meshObject);
+	uint64_t getSortKey(const MeshModel& model, const BoundingSphere& worldSphere) const;
+	float getProjectedSize(const BoundingSphere& worldSphere, float viewportHeight) const;
 
 public:
 	Renderer(Scene& scene);
@@ -7,6 +7,7 @@
 #include <memory>
 #include <chrono>
 #include "MeshModel.h"
+#include "InstancedModel.h"
 #include "Camera.h"
 #include "ProjectionType.h"
 #include "PointLightSource.h"
@@ -15,6 +16,14 @@
 
 #define MAX_LIGHTS_NUMBER 8
 
+// The culling benchmark scene is a grid of CULLING_BENCHMARK_SIDE x CULLING_BENCHMARK_SIDE small cubes
+static constexpr int CULLING_BENCHMARK_SIDE = 64;
+static constexpr float CULLING_BENCHMARK_SPACING = 0.5f;
+
+// The instancing benchmark scene is a square grid of INSTANCING_BENCHMARK_COUNT copies of one mesh
+static constexpr int INSTANCING_BENCHMARK_COUNT = 50000;
+static constexpr float INSTANCING_BENCHMARK_SPACING = 0.25f;
+
 /*
  * Scene class.
  * This class holds all the scene information (models, cameras, lights, etc..)
@@ -23,6 +32,7 @@
 class Scene {
 private:
 	std::vector<MeshModel*> models;
+	std::vector<InstancedModel*> instancedModels;
 	std::vector<Camera> cameras;
 	std::vector<LightSource*> lights;
 	glm::vec4 ambientLight;
@@ -32,12 +42,17 @@ private:
 	int activeModelIndex;
 	int activeLightsIndex;
 
-	// Execution Times
-	double imGuiRenderExecutionTime;
-	double zBufferExecutionTime;
-	double colorBufferExecutionTime;
-	double swapBuffersExecutionTime;
-	double renderExecutionTime;
+	// Triangles of the models in the last frame, and how many the levels of detail left out
+	size_t drawnTriangles = 0;
+	size_t lodSavedTriangles = 0;
+
+	// Models that passed/failed frustum culling in the last frame
+	size_t visibleModels = 0;
+	size_t culledModels = 0;
+
+	// OpenGL state changes made and filtered out by GLStateCache in the last frame
+	size_t issuedStateChanges = 0;
+	size_t skippedStateChanges = 0;
 
 	// Booleans
 	bool showNormals = false;
@@ -65,6 +80,13 @@ private:
 	bool toonShading = false;
 	int toonShadingLevels = 1;
 
+	// Level of detail
+	bool useLevelOfDetail = true;
+	float lodPixelError = 1.0f;
+
+	// Culling
+	bool useFrustumCulling = true;
+
 	// Generic models
 	Cube floor;
 
@@ -83,10 +105,18 @@ public:
 
 	// Models
 	void AddModel(MeshModel * const model);
-	const std::vector<MeshModel*> GetModelsVector() const { return models; };
+	void RemoveActiveModel();
+	void RemoveAllModels();                  // The instanced models too
+	const std::vector<MeshModel*>& GetModelsVector() const { return models; };
 	MeshModel* GetActiveModel() const;
 	const int GetModelCount() const;
 	void SetActiveModelIndex(const int index);
+	void AddCullingBenchmark();
+
+	// Instanced models, many copies of one mesh drawn together. The scene owns them (and their meshes).
+	InstancedModel* AddInstancedModel(MeshModel* const mesh);
+	const std::vector<InstancedModel*>& GetInstancedModelsVector() const { return instancedModels; }
+	InstancedModel* AddInstancingBenchmark(MeshModel* const mesh);
 	const int GetActiveModelIndex() const;
 
 	// Cameras
@@ -112,19 +142,19 @@ public:
 	bool GetShowFloor() { return showFloor; }
 
 	// Stats
-	const double GetRenderExecutionTime() const { return renderExecutionTime; }
-	void SetRenderExecutionTime(double time) { renderExecutionTime = time; }
-	const double GetImGuiRenderExecutionTime() const { return imGuiRenderExecutionTime; }
-	void SetImGuiRenderExecutionTime(double time) { imGuiRenderExecutionTime = time; }
-	const double GetZBufferExecutionTime() const { return zBufferExecutionTime; }
-	void SetZBufferExecutionTime(double time) { zBufferExecutionTime = time; }
-	const double GetColorBufferExecutionTime() const { return colorBufferExecutionTime; }
-	void SetColorBufferExecutionTime(double time) { colorBufferExecutionTime = time; }
-	const double GetSwapBuffersExecutionTime() const { return swapBuffersExecutionTime; }
-	void SetSwapBuffersExecutionTime(double time) { swapBuffersExecutionTime = time; }
+	size_t GetDrawnTriangles() const { return drawnTriangles; }
+	size_t GetLodSavedTriangles() const { return lodSavedTriangles; }
+	void SetTriangleCounts(size_t drawn, size_t savedByLod) { drawnTriangles = drawn; lodSavedTriangles = savedByLod; }
+	size_t GetVisibleModels() const { return visibleModels; }
+	size_t GetCulledModels() const { return culledModels; }
+	void SetModelCounts(size_t visible, size_t culled) { visibleModels = visible; culledModels = culled; }
+	size_t GetIssuedStateChanges() const { return issuedStateChanges; }
+	size_t GetSkippedStateChanges() const { return skippedStateChanges; }
+	void SetStateChangeCounts(size_t issued, size_t skipped) { issuedStateChanges = issued; skippedStateChanges = skipped; }
 
 	// Lights
 	void AddLight(LightSourceType type);
+	void RemoveAllLights();
 	LightSource* GetActiveLight() { return lights[GetActiveLightsIndex()]; }
 	const int GetActiveLightsIndex() const { return activeLightsIndex; }
 	void SetActiveLightsIndex(const int index) { activeLightsIndex = index; }
@@ -154,6 +184,16 @@ public:
 	void SetToonShadingLevels(int value) { toonShadingLevels = value; }
 	int GetToonShadingLevels() { return toonShadingLevels; }
 
+	// Level of detail
+	void SetUseLevelOfDetail(bool value) { useLevelOfDetail = value; }
+	bool GetUseLevelOfDetail() const { return useLevelOfDetail; }
+	void SetLodPixelError(float value) { lodPixelError = value; }
+	float GetLodPixelError() const { return lodPixelError; }
+
+	// Culling
+	void SetUseFrustumCulling(bool value) { useFrustumCulling = value; }
+	bool GetUseFrustumCulling() const { return useFrustumCulling; }
+
 	// Input
 	IMoving* GetActiveMovingObject() { return &GetActiveCamera(); }
 	IDirectional* GetActiveDirectionalObject() { return &GetActiveCamera(); }
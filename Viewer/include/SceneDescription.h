@@ -0,0 +1,88 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include "LightSource.h"
+#include "ProjectionType.h"
+
+class Scene;
+
+// Image size when a description doesn't set one
+static constexpr int SCENE_DESCRIPTION_DEFAULT_WIDTH = 1280;
+static constexpr int SCENE_DESCRIPTION_DEFAULT_HEIGHT = 720;
+
+struct ModelDescription
+{
+	std::string filePath;
+	glm::vec3 position = glm::vec3(0.0f);
+	glm::vec3 rotation = glm::vec3(0.0f);  // Degrees around x, then y, then z
+	float scale = 1.0f;
+	bool hasColor = false;
+	glm::vec4 color = glm::vec4(1.0f);     // Diffuse color, when hasColor
+};
+
+struct LightDescription
+{
+	LightSourceType type;
+	glm::vec3 vector;                      // Location of a point light, direction of a parallel one
+	bool hasColor = false;
+	glm::vec4 color = glm::vec4(1.0f);
+};
+
+/*
+ * SceneDescription class.
+ * Everything needed to render a view without the menus: models, camera, lights and the image, set with
+ * command line options ("--model bunny.obj --eye 0 1 3") or read from a file with one option per line,
+ * without the dashes ("model bunny.obj"). Options that follow a model (position, rotation, scale, color)
+ * apply to it.
+ */
+class SceneDescription
+{
+public:
+	// Image
+	int width = SCENE_DESCRIPTION_DEFAULT_WIDTH;
+	int height = SCENE_DESCRIPTION_DEFAULT_HEIGHT;
+	std::string outputFile;
+	std::string depthOutputFile;        // OpenEXR, the window depth values of the frame
+
+	// Camera, the defaults are the viewer's first camera
+	glm::vec3 eye = glm::vec3(10.0f, 10.0f, -10.0f);
+	glm::vec3 at = glm::vec3(0.0f);
+	glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
+	ProjectionType projection = Perspective;
+	float fov = 30.0f;
+	float zNear = 1.0f;
+	float zFar = 100.0f;
+	float orthographicHeight = 2.0f;
+
+	// Lights, none is the viewer's default light
+	std::vector<LightDescription> lights;
+	glm::vec4 ambientLight = glm::vec4(0.2f, 0.2f, 0.2f, 1.0f);
+	glm::vec4 clearColor = glm::vec4(0.2f, 0.2f, 0.2f, 1.0f);
+
+	// Models
+	std::vector<ModelDescription> models;
+	std::string instancingBenchmarkMesh;
+	bool cullingBenchmark = false;
+
+	// Rendering
+	int toonShadingLevels = 0;              // 0 is no toon shading
+	bool bumpMapping = false;
+	bool showFloor = false;
+	bool drawLights = true;
+	bool levelOfDetail = true;
+	bool frustumCulling = true;
+
+	// Adds the options to the description, returns false and prints why on an unknown option or a bad value
+	bool Parse(const std::vector<std::string>& arguments);
+	bool ParseFile(const std::string& filePath);
+
+	// Sets the camera, the lights and the switches of a scene and adds the models to it (a scene that is reused
+	// keeps its models, see Scene::RemoveAllModels). Returns false if a model didn't load.
+	bool Apply(Scene& scene) const;
+
+	static void PrintOptions();
+
+private:
+	bool parseOption(const std::string& name, const std::vector<std::string>& arguments, size_t& next);
+};
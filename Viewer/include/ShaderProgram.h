@@ -1,11 +1,22 @@
 #pragma once
 #include <string>
-#include <map>
+#include <vector>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
+#include "FrameStatistics.h"
 
 using std::string;
 
+// A uniform of a ShaderProgram, resolved once with getUniform<T>. Setting it is an index into the program's
+// table of active uniforms and a glUniform call. Uniforms the program doesn't have get index -1 and are ignored.
+template <typename T>
+struct UniformHandle
+{
+	int index = -1;
+
+	bool IsValid() const { return index >= 0; }
+};
+
 class ShaderProgram
 {
 public:
@@ -19,27 +30,75 @@ public:
 		PROGRAM
 	};
 
-	bool loadShaders(const char* vsFilename, const char* fsFilename);
+	// defines ("NAME" or "NAME value") are inserted into both shaders after their #version line
+	bool loadShaders(const char* vsFilename, const char* fsFilename, const std::vector<string>& defines = std::vector<string>());
 	void use();
 
 	GLuint getProgram() const;
+	const string& getName() const { return name; }
+
+	// Resolves a uniform by name. Reports names the program doesn't have (unless the uniform isn't required),
+	// and types that don't match T.
+	template <typename T>
+	UniformHandle<T> getUniform(const GLchar* name, bool required = true);
 
-	void setUniform(const GLchar* name, const glm::vec2& v);
-	void setUniform(const GLchar* name, const glm::vec3& v);
-	void setUniform(const GLchar* name, const glm::vec4& v);
-	void setUniform(const GLchar* name, const glm::mat4& m);
-	void setUniform(const GLchar* name, const GLfloat f);
-	void setUniform(const GLchar* name, const GLint v);
-	void setUniformSampler(const GLchar* name, const GLint& slot);
+	void setUniform(UniformHandle<glm::vec2> uniform, const glm::vec2& v);
+	void setUniform(UniformHandle<glm::vec3> uniform, const glm::vec3& v);
+	void setUniform(UniformHandle<glm::vec4> uniform, const glm::vec4& v);
+	void setUniform(UniformHandle<glm::mat4> uniform, const glm::mat4& m);
+	void setUniform(UniformHandle<GLfloat> uniform, const GLfloat f);
+	void setUniform(UniformHandle<GLint> uniform, const GLint v);
+
+	// Prints the active uniforms that were never set since the program was linked
+	void reportUnsetUniforms() const;
+
+	// Attaches the program's uniform block called name (if it has one) to a uniform buffer binding point
+	void bindUniformBlock(const GLchar* name, GLuint bindingPoint);
 
-	// We are going to speed up looking for uniforms by keeping their locations in a map
-	GLint getUniformLocation(const GLchar * name);
 
 private:
+	// An active uniform outside of the uniform blocks, as reported by glGetActiveUniform
+	struct ActiveUniform
+	{
+		string name;
+		GLint location;
+		GLenum type;
+		bool set;
+	};
 
 	string fileToString(const string& filename);
 	void  checkCompileErrors(GLuint shader, ShaderType type);
+	void  reflectUniforms();
+	// The index getUniform<T> stores in a handle; nothing else looks uniforms up by name
+	int   resolveUniform(const GLchar* name, GLenum expectedType, bool required);
+
+	// Marks the uniform as set and returns its location (-1 for invalid handles)
+	GLint setLocation(int index)
+	{
+		if (index < 0) return -1;
+		FrameStatistics::Get().CountUniformUpload();
+		uniforms[index].set = true;
+		return uniforms[index].location;
+	}
 
 	GLuint programHandle;
-	std::map<string, GLint> uniformLocations;
-};
\ No newline at end of file
+	string name;
+	std::vector<ActiveUniform> uniforms;
+};
+
+// The OpenGL uniform type each C++ type is set with (ints also set bools and samplers)
+template <typename T> struct UniformGLType;
+template <> struct UniformGLType<glm::vec2> { static constexpr GLenum value = GL_FLOAT_VEC2; };
+template <> struct UniformGLType<glm::vec3> { static constexpr GLenum value = GL_FLOAT_VEC3; };
+template <> struct UniformGLType<glm::vec4> { static constexpr GLenum value = GL_FLOAT_VEC4; };
+template <> struct UniformGLType<glm::mat4> { static constexpr GLenum value = GL_FLOAT_MAT4; };
+template <> struct UniformGLType<GLfloat>   { static constexpr GLenum value = GL_FLOAT; };
+template <> struct UniformGLType<GLint>     { static constexpr GLenum value = GL_INT; };
+
+template <typename T>
+UniformHandle<T> ShaderProgram::getUniform(const GLchar* name, bool required)
+{
+	UniformHandle<T> uniform;
+	uniform.index = resolveUniform(name, UniformGLType<T>::value, required);
+	return uniform;
+}
\ No newline at end of file
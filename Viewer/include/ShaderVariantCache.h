@@ -0,0 +1,74 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "ShaderProgram.h"
+
+// Features of a shader variant, each one a #define of the shaders (see fshader_color.glsl)
+enum ShaderFeature : uint32_t
+{
+	SHADER_TEXTURES = 1 << 0,
+	SHADER_BUMP_MAPPING = 1 << 1,
+	SHADER_TOON_SHADING = 1 << 2,
+	SHADER_EMISSIVE = 1 << 3
+};
+
+// The features are the low bits of a variant key, the light count is above them. The features fit the
+// shader field of the render queue's sort key.
+static constexpr uint32_t SHADER_FEATURE_BITS = 4;
+
+// Handles of the uniforms set for every draw, resolved once per shader program
+struct DrawUniforms
+{
+	UniformHandle<glm::mat4> model;
+	UniformHandle<glm::vec3> positionOffset;
+	UniformHandle<glm::vec3> positionScale;
+	UniformHandle<GLint> octahedralNormals;
+	UniformHandle<glm::vec4> ambiantColor;
+	UniformHandle<glm::vec4> diffuseColor;
+	UniformHandle<glm::vec4> specularColor;
+	UniformHandle<GLfloat> shininess;
+	UniformHandle<GLint> instanced;
+
+	// key is the variant's, its features tell which uniforms the program must have
+	void Resolve(ShaderProgram& program, uint32_t key);
+};
+
+// One compiled combination of features
+struct ShaderVariant
+{
+	uint32_t key;
+	ShaderProgram program;
+	DrawUniforms uniforms;
+	bool reportedUnsetUniforms;
+};
+
+/*
+ * ShaderVariantCache class.
+ * The programs built from one pair of shader files, one per combination of features and light count.
+ * A variant is compiled the first time it is asked for (with the features as #defines), then kept.
+ */
+class ShaderVariantCache
+{
+public:
+	ShaderVariantCache(const char* vertexShaderFile, const char* fragmentShaderFile);
+
+	static uint32_t MakeKey(uint32_t features, unsigned int lightCount) { return features | (lightCount << SHADER_FEATURE_BITS); }
+
+	ShaderVariant& Get(uint32_t key);
+
+	// Reports the uniforms that variants used since the last call never set (once per variant)
+	void ReportUnsetUniforms();
+
+	size_t GetCompiledVariants() const { return variants.size(); }
+
+private:
+	std::string vertexShaderFile;
+	std::string fragmentShaderFile;
+	std::unordered_map<uint32_t, std::unique_ptr<ShaderVariant>> variants;
+
+	ShaderVariantCache(const ShaderVariantCache&) = delete;
+	ShaderVariantCache& operator=(const ShaderVariantCache&) = delete;
+};
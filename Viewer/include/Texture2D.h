@@ -2,9 +2,18 @@
 #define TEXTURE2D_H
 
 #include <glad/glad.h>
+#include <cstddef>
 #include <string>
 using std::string;
 
+// One mip level of RGBA8 pixels, bottom row first
+struct TextureLevel
+{
+	const unsigned char* pixels;
+	int width;
+	int height;
+};
+
 class Texture2D
 {
 public:
@@ -13,10 +22,44 @@ public:
 	virtual ~Texture2D();
 
 	bool loadTexture(const string& fileName, bool generateMipMaps = true);
+	// Decodes an image file that is already in memory, fileName is only used in messages
+	bool loadTexture(const unsigned char* fileData, size_t fileSize, const string& fileName, bool generateMipMaps = true);
+	// Uploads prepared levels (see TextureCache), levels[0] is the full size one
+	void loadLevels(const TextureLevel* levels, size_t levelCount);
 	void bind(GLuint texUnit = 0)  const;
 	void unbind(GLuint texUnit = 0) const;
+	// While the texture is streamed in this is the placeholder texture
+	GLuint getTexture() const { return mTexture; }
+	// False until a streamed texture has finished uploading
+	bool isReady() const { return !mPending; }
+	// True when a streamed texture couldn't be decoded, it is then empty (texture 0)
+	bool hasFailed() const { return mFailed; }
+
+	// Reverses the rows of RGBA pixels in place, images are stored top row first but OpenGL wants the bottom row first
+	static void flipVertically(unsigned char* imageData, int width, int height);
+
+	// Size of the texture and of its whole mip chain on the GPU (RGBA8)
+	int getWidth() const { return mWidth; }
+	int getHeight() const { return mHeight; }
+	size_t getGpuBytes() const { return mGpuBytes; }
 
 private:
 	GLuint mTexture;
+	int mWidth;
+	int mHeight;
+	size_t mGpuBytes;
+	bool mPending;
+	bool mFailed;
+
+	// Streams the pixels in, see TextureStreamer
+	friend class TextureStreamer;
+	static size_t mipChainBytes(int width, int height, bool generateMipMaps);
+	// Min and mag filters and the last level of the bound texture, which has levelCount levels
+	static void setFilter(size_t levelCount);
+
+	bool upload(unsigned char* imageData, int width, int height, const string& fileName, bool generateMipMaps);
+
+	Texture2D(const Texture2D&) = delete;
+	Texture2D& operator=(const Texture2D&) = delete;
 };
 #endif
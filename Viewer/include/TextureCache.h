@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+#include "Texture2D.h"
+
+// Bump whenever the layout of the file or the mip filtering changes
+static constexpr uint32_t TEXTURE_CACHE_VERSION = 1;
+
+/*
+ * How the mip levels are averaged.
+ */
+enum class MipFilter : uint32_t
+{
+	Srgb,   // Box filter in linear light, for colors stored in sRGB (what images usually hold)
+	Linear  // Box filter on the stored values, for data such as normal maps
+};
+
+/*
+ * Header of a .mvtex file. The mip levels follow it directly, largest first, each one RGBA8 with the bottom
+ * row first. Level i is max(1, width >> i) by max(1, height >> i), down to 1x1.
+ */
+struct TextureCacheHeader
+{
+	char magic[4];                // "MVTX"
+	uint32_t version;             // TEXTURE_CACHE_VERSION
+	uint32_t width;
+	uint32_t height;
+	uint32_t levelCount;
+	uint32_t mipFilter;           // MipFilter the levels were built with
+	uint64_t sourceSize;          // Size of the image file the cache was built from
+	uint64_t sourceHash;          // Utils::HashBytes of its contents
+	uint64_t payloadHash;         // Utils::HashBytes of the levels, catches truncated/corrupt files
+};
+
+/*
+ * TextureCache class.
+ * A binary sidecar (image.jpg.mvtex) that holds a texture decoded, flipped and with its whole mip chain,
+ * so loading it again is a memory mapping instead of decoding the image and generating the mip maps.
+ *
+ * The levels point into the mapping (after Load) or into pixels owned by the object (after Decode),
+ * so they are only valid while the TextureCache object is alive.
+ */
+class TextureCache
+{
+private:
+	MappedFile file;
+	std::vector<unsigned char> pixels;
+	std::vector<TextureLevel> levels;
+
+	static std::vector<TextureLevel> getLevelSizes(int width, int height);
+	static void buildMipLevel(const TextureLevel& source, unsigned char* destination, const TextureLevel& level, MipFilter filter);
+
+public:
+	static std::string GetCacheFilePath(const std::string& sourceFilePath);
+
+	// Returns false if there is no cache, or if it is stale, corrupt or was built with another filter
+	bool Load(const std::string& sourceFilePath, uint64_t sourceSize, uint64_t sourceHash, MipFilter filter);
+
+	// Decodes an image file that is already in memory and builds its mip chain (in parallel)
+	bool Decode(const unsigned char* fileData, size_t fileSize, MipFilter filter);
+
+	// Load, or Decode and write the cache for the next time. sourceHash is Utils::HashBytes of the file.
+	bool LoadOrDecode(const std::string& sourceFilePath, const MappedFile& source, uint64_t sourceHash, MipFilter filter, bool useCache);
+
+	// Largest first, down to 1x1
+	const std::vector<TextureLevel>& GetLevels() const { return levels; }
+
+	// Writes the levels of the last Decode
+	bool Save(const std::string& sourceFilePath, uint64_t sourceSize, uint64_t sourceHash, MipFilter filter) const;
+};
@@ -0,0 +1,18 @@
+#pragma once
+#include "TextureCache.h"
+
+/*
+ * TextureLoadOptions struct.
+ * Knobs for TextureManager::Load. The defaults are what the viewer uses for color textures.
+ */
+struct TextureLoadOptions
+{
+	// Upload the mip chain, or only the full size level
+	bool generateMipMaps = true;
+
+	// How the mip levels are averaged, Linear for textures that aren't colors (normal maps)
+	MipFilter mipFilter = MipFilter::Srgb;
+
+	// Read/write the decoded image.jpg.mvtex next to the image, see TextureCache
+	bool useTextureCache = true;
+};
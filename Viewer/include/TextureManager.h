@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include "Texture2D.h"
+#include "TextureLoadOptions.h"
+
+// Default of TextureManager::SetMemoryBudget
+static constexpr size_t TEXTURE_MEMORY_BUDGET = 256 * 1024 * 1024;
+
+// The normal map every model uses for bump mapping, in the Data directory (see Utils::GetDataFilePath)
+static constexpr const char* DEFAULT_NORMAL_MAP_FILE = "brickwall_normal.jpg";
+
+/*
+ * TextureManager class.
+ * Loads textures once and hands out shared handles to them. Files are identified by their contents, so
+ * loading a path again, or another path with the same image, returns the texture that is already resident.
+ *
+ * The manager keeps a texture after its last handle goes away, in case it is loaded again. Those unused
+ * textures are unloaded (least recently loaded first) once the textures take more GPU memory than the
+ * budget; textures that are in use are never unloaded, even above the budget.
+ *
+ * New textures are streamed in by the TextureStreamer (from their TextureCache when it is up to date), so
+ * Load returns right away with a texture that is the placeholder for a few frames (and takes no memory
+ * until then).
+ */
+class TextureManager
+{
+public:
+	static TextureManager& Get();
+
+	// nullptr if the file can't be read (or, when loading synchronously, decoded). A file that can't be read
+	// is reported once, and not opened again.
+	std::shared_ptr<const Texture2D> Load(const std::string& filePath, const TextureLoadOptions& options = TextureLoadOptions());
+
+	// Unloads unused textures until the resident ones fit in the budget (bytes, mip chains included)
+	void Trim();
+	void SetMemoryBudget(size_t bytes)    { memoryBudget = bytes; Trim(); }
+	size_t GetMemoryBudget() const        { return memoryBudget; }
+
+	// Synchronous loading decodes and uploads the texture inside Load
+	void SetAsyncLoading(bool async)      { asyncLoading = async; }
+	bool GetAsyncLoading() const          { return asyncLoading; }
+
+	// The normal map every model loads for bump mapping (see MeshModel)
+	void SetNormalMapFile(const std::string& filePath)    { normalMapFile = filePath; }
+	const std::string& GetNormalMapFile() const           { return normalMapFile; }
+
+	// Statistics
+	size_t GetResidentTextures() const    { return entries.size(); }
+	size_t GetResidentBytes() const;
+	size_t GetUnusedTextures() const;
+	size_t GetSharedLoads() const         { return sharedLoads; }
+
+private:
+	struct Entry
+	{
+		std::shared_ptr<Texture2D> texture;
+		uint64_t lastLoad;        // loadCount when it was last loaded
+	};
+
+	// Keyed by the hash of the file contents and the mip map option
+	std::unordered_map<std::string, Entry> entries;
+	std::unordered_set<std::string> missingFiles;
+	std::string normalMapFile;
+	size_t memoryBudget;
+	bool asyncLoading;
+	size_t sharedLoads;
+	uint64_t loadCount;
+
+	TextureManager();
+	TextureManager(const TextureManager&) = delete;
+	TextureManager& operator=(const TextureManager&) = delete;
+};
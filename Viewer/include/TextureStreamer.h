@@ -0,0 +1,77 @@
+#pragma once
+#include <glad/glad.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "MappedFile.h"
+#include "Texture2D.h"
+#include "TextureCache.h"
+#include "TextureLoadOptions.h"
+
+// Decoded pixels copied through the pixel buffers and uploaded per frame, bigger textures take several frames
+static constexpr size_t TEXTURE_STREAM_BYTES_PER_FRAME = 4 * 1024 * 1024;
+
+// Pixel buffers used in turn, so a copy doesn't have to wait for the driver to read the previous one
+static constexpr int TEXTURE_STREAM_BUFFERS = 2;
+
+/*
+ * TextureStreamer class.
+ * Loads textures without stalling the render thread. The shared thread pool prepares the levels (from the
+ * TextureCache, or by decoding the file and building its mip chain), and Update (called once per frame)
+ * streams them into the textures through pixel buffer objects, a few rows at a time. Until its upload is
+ * done a texture is the 1x1 gray placeholder. A texture whose file can't be decoded ends up empty and
+ * failed (see Texture2D::hasFailed), like a texture that TextureManager can't load synchronously.
+ */
+class TextureStreamer
+{
+public:
+	static TextureStreamer& Get();
+
+	// texture must be empty, it becomes the placeholder until file is streamed in.
+	// sourceHash is Utils::HashBytes of the file.
+	void Load(const std::shared_ptr<Texture2D>& texture, const std::shared_ptr<MappedFile>& file,
+		const std::string& fileName, uint64_t sourceHash, const TextureLoadOptions& options);
+
+	// Uploads up to TEXTURE_STREAM_BYTES_PER_FRAME of the decoded textures
+	void Update();
+
+	// Textures that are decoding or uploading
+	size_t GetPendingTextures() const    { return pendingTextures; }
+
+private:
+	struct PreparedImage
+	{
+		std::weak_ptr<Texture2D> texture;
+		std::shared_ptr<TextureCache> image;    // nullptr if the file couldn't be decoded
+		size_t levelCount;          // 1 without mip maps
+	};
+
+	// Prepared by the workers, waiting for the render thread
+	std::deque<PreparedImage> preparedImages;
+	std::mutex preparedMutex;
+
+	// The image being uploaded, and the first level and row it still has to upload
+	PreparedImage upload;
+	GLuint uploadTexture;
+	size_t uploadLevel;
+	int uploadRow;
+
+	GLuint placeholder;
+	GLuint pixelBuffers[TEXTURE_STREAM_BUFFERS];
+	int nextPixelBuffer;
+	std::atomic<size_t> pendingTextures;
+
+	void createBuffers();
+	void beginUpload();
+	void finishUpload();
+	void releaseUpload();
+	void failTexture(const std::weak_ptr<Texture2D>& texture);
+
+	TextureStreamer();
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+};
@@ -0,0 +1,45 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * ThreadPool class.
+ * A fixed set of worker threads that run queued tasks. ParallelFor lets the calling thread take part in
+ * the work, so it is safe to call it from inside another task.
+ *
+ * Use ThreadPool::GetShared() rather than creating pools, so the whole application shares one set of workers.
+ */
+class ThreadPool
+{
+private:
+	std::vector<std::thread> workers;
+	std::deque<std::function<void()>> tasks;
+	std::mutex tasksMutex;
+	std::condition_variable taskAvailable;
+	bool stopping;
+
+	void workerLoop();
+
+public:
+	ThreadPool(unsigned int workerCount);
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+	~ThreadPool();
+
+	static ThreadPool& GetShared();
+
+	// Number of threads that can run a ParallelFor at once (the workers plus the caller)
+	unsigned int GetConcurrency() const { return (unsigned int)workers.size() + 1; }
+
+	void Enqueue(std::function<void()> task);
+
+	// Calls body(i) for every i in [0, count) and returns when all of them are done.
+	// At most maxThreads threads (including the caller) work on the range. 0 means all of them.
+	// If body throws, the indices not started yet are skipped and the first exception is rethrown here.
+	void ParallelFor(size_t count, const std::function<void(size_t)>& body, unsigned int maxThreads = 0);
+};
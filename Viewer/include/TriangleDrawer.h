@@ -15,7 +15,9 @@
 class TriangleDrawer
 {
 private:
-	int verticesNumber;
+	GLsizei indicesNumber;
+	GLenum indexType;
+	size_t indicesOffset; // In bytes
 	GLuint vao;
 
 public:
@@ -25,5 +27,9 @@ public:
 	// Methods
 	void DrawTriangles() const;
 	void FillTriangles() const;
+
+	// The same, instanceCount times (the model's vao supplies the per-instance attributes)
+	void DrawTrianglesInstanced(GLsizei instanceCount) const;
+	void FillTrianglesInstanced(GLsizei instanceCount) const;
 };
 
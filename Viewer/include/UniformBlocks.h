@@ -0,0 +1,35 @@
+#pragma once
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "Scene.h" // For MAX_LIGHTS_NUMBER
+
+// Binding points of the uniform blocks, assigned to every ShaderProgram when it is linked
+enum UniformBlockBinding : GLuint
+{
+	CAMERA_DATA_BINDING = 0,
+	LIGHTING_DATA_BINDING = 1
+};
+
+// The C++ side of the std140 uniform blocks declared in the shaders. std140 aligns vec3 (also in arrays)
+// to 16 bytes, so they are stored here as vec4s, and bools are 4 byte ints.
+
+// layout(std140) uniform CameraData
+struct CameraData
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::vec4 cameraLocation;     // vec3 cameraLocation
+};
+
+// layout(std140) uniform LightingData
+struct LightingData
+{
+	glm::vec4 ambiantLighting;
+	GLint toonShadingLevels;
+	GLint padding[3];             // The arrays start on 16 bytes
+	glm::vec4 lightsPositions[MAX_LIGHTS_NUMBER]; // vec3 lightsPositions[MAX_LIGHTS_NUMBER]
+	glm::vec4 lightColors[MAX_LIGHTS_NUMBER];
+};
+
+static_assert(sizeof(CameraData) == 144, "CameraData must match the std140 layout of the shaders' block");
+static_assert(sizeof(LightingData) == 32 + 2 * 16 * MAX_LIGHTS_NUMBER, "LightingData must match the std140 layout of the shaders' block");
@@ -0,0 +1,35 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+
+/*
+ * UniformBuffer class.
+ * A GL_UNIFORM_BUFFER bound to a fixed binding point, so every program whose uniform block uses that binding
+ * point reads from it. Written once per frame with Update instead of setting the same uniforms on every draw.
+ */
+class UniformBuffer
+{
+public:
+	UniformBuffer();
+	~UniformBuffer();
+
+	// Creates the buffer (size bytes) and binds it to bindingPoint
+	void Create(GLuint bindingPoint, size_t size);
+
+	// Replaces the whole buffer. The old storage is orphaned first, so the driver doesn't have to wait for
+	// the draws of the previous frame that still read it.
+	void Update(const void* data, size_t size);
+
+	template <typename Block>
+	void Update(const Block& block) { Update(&block, sizeof(Block)); }
+
+	GLuint GetBindingPoint() const { return bindingPoint; }
+
+private:
+	GLuint buffer;
+	GLuint bindingPoint;
+	size_t size;
+
+	UniformBuffer(const UniformBuffer&) = delete;
+	UniformBuffer& operator=(const UniformBuffer&) = delete;
+};
@@ -1,7 +1,10 @@
 #pragma once
 #include <glm/glm.hpp>
 #include <string>
+#include <cstdint>
 #include "MeshModel.h"
+#include "MeshLoadOptions.h"
+#include "MeshData.h"
 #include "Point.h"
 constexpr auto PI = 3.141592653589793238462643383279502884f;
 
@@ -21,9 +24,24 @@ public:
 	static glm::vec4 Vec4FromVec3WithZero(const glm::vec3 & other);
 	static glm::vec3 ScreenVec3FromWorldPoint(const Point & _worldPoint, int _viewportWidth, int _viewportHeightPar);
 	static glm::vec3 ScreenVec3FromWorldPoint(const glm::vec4 & worldPoint, int _viewportWidth, int _viewportHeight);
-	static MeshModel* LoadMeshModel(const std::string& filePath);
-	static std::vector<glm::vec3> CalculateNormals(std::vector<glm::vec3> vertices, std::vector<Face> faces);
+	static MeshModel* LoadMeshModel(const std::string& filePath, const MeshLoadOptions& options = MeshLoadOptions());
+	static std::vector<glm::vec3> CalculateNormals(const std::vector<glm::vec3>& vertices, const std::vector<Face>& faces);
+	static MeshData BuildMeshData(const std::vector<Face>& faces, const std::vector<glm::vec3>& vertices, const std::vector<glm::vec3>& normals, const std::vector<glm::vec2>& textureCoords, bool useNormalIndices = false);
 	static std::string GetTextureFileName(std::string filePath);
+	// fileName in the repository's Data directory (the sample models and textures). The build sets the directory
+	// (MESHVIEWER_DATA_DIR), the environment variable of the same name overrides it.
+	static std::string GetDataFilePath(const std::string& fileName);
+
+	static void PrintMeshMemory(const std::string& modelName, const MeshView& mesh);
+
+	// Fast non-cryptographic hash, used to tell whether files changed
+	static uint64_t HashBytes(const void* data, size_t size);
+
+	// Cache files are written to a temporary file first, so a crash never leaves a half written cache behind.
+	// The temporary name is unique to the process and the call, since batch workers write the same caches.
+	static std::string GetTemporaryFilePath(const std::string& filePath);
+	// Puts the temporary file in place of filePath (or removes it if that fails)
+	static bool ReplaceFile(const std::string& temporaryFilePath, const std::string& filePath);
 
 	// Common math
 	static float degreesToRadians(float degress);
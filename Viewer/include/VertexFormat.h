@@ -0,0 +1,37 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * How the vertices of a mesh are stored in its vertex buffer, see VertexQuantizer.
+ */
+enum class VertexFormat : uint32_t
+{
+	Float = 0,        // Vertex as is: float positions, normals and texture coordinates (32 bytes)
+	Quantized16 = 1,  // 16 bit positions in the bounding box, 2x16 bit octahedral normals, half float UVs (16 bytes)
+	Quantized8 = 2,   // Like Quantized16, but with 2x8 bit octahedral normals (12 bytes)
+	Auto = 0xFF       // Only valid as a load option: the smallest format that is precise enough for the mesh
+};
+
+// Bytes per vertex in the vertex buffer
+inline size_t GetVertexStride(VertexFormat format)
+{
+	switch (format)
+	{
+	case VertexFormat::Quantized16: return 16;
+	case VertexFormat::Quantized8:  return 12;
+	default:                        return 32; // sizeof(Vertex)
+	}
+}
+
+/*
+ * What the vertex shader needs to turn stored vertices back into model space positions and normals:
+ * position = positionOffset + positionScale * stored position.
+ */
+struct VertexDecoding
+{
+	glm::vec3 positionOffset = glm::vec3(0.0f);
+	glm::vec3 positionScale = glm::vec3(1.0f);
+	bool octahedralNormals = false;
+};
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "MeshData.h"
+#include "VertexFormat.h"
+
+// VertexFormat::Auto picks the smallest format whose errors stay within these
+static constexpr double MAX_POSITION_ERROR = 1.0 / 16384.0; // Relative to the bounding box diagonal
+static constexpr double MAX_NORMAL_ERROR_DEGREES = 0.5;
+static constexpr double MAX_TEXTURE_COORDS_ERROR = 1.0 / 4096.0; // A quarter of a texel of a 1024x1024 texture
+
+/*
+ * The largest differences between a mesh and its quantized version, as the shaders decode it.
+ */
+struct QuantizationError
+{
+	double position = 0.0;         // Relative to the bounding box diagonal
+	double normalDegrees = 0.0;
+	double textureCoords = 0.0;
+
+	bool IsWithinTolerance() const
+	{
+		return position <= MAX_POSITION_ERROR && normalDegrees <= MAX_NORMAL_ERROR_DEGREES && textureCoords <= MAX_TEXTURE_COORDS_ERROR;
+	}
+};
+
+/*
+ * VertexQuantizer class.
+ * Packs meshes into the compact vertex formats, to save memory and vertex fetch bandwidth:
+ *   - positions as 16 bit unsigned normalized values inside the mesh's bounding box,
+ *   - normals octahedral encoded in 2x16 or 2x8 bit unsigned normalized values,
+ *   - texture coordinates as half floats.
+ * The GPU converts the normalized/half values when fetching them, the vertex shaders apply the VertexDecoding.
+ */
+class VertexQuantizer
+{
+public:
+	static VertexDecoding GetDecoding(VertexFormat format, const glm::vec3& minimums, const glm::vec3& maximums);
+
+	// Sets up the attributes (0 = position, 1 = normal, 2 = texture coordinates) of the bound vao/vbo
+	static void SetupAttributes(VertexFormat format);
+
+	// Returns mesh (which must be in the Float format) converted to format, the vertices are written into storage
+	static MeshView Quantize(const MeshView& mesh, VertexFormat format, std::vector<uint8_t>& storage);
+
+	static QuantizationError MeasureError(const MeshView& mesh, VertexFormat format);
+
+	// Resolves VertexFormat::Auto for a mesh in the Float format, and fills in the error of the chosen format
+	static VertexFormat ChooseFormat(const MeshView& mesh, VertexFormat requested, QuantizationError& error);
+
+	static const char* GetFormatName(VertexFormat format);
+
+private:
+	static void encodeVertex(const Vertex& vertex, VertexFormat format, const VertexDecoding& decoding, uint8_t* output);
+	static Vertex decodeVertex(const uint8_t* input, VertexFormat format, const VertexDecoding& decoding);
+};
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "MeshData.h"
+
+/*
+ * VertexWelder class.
+ * Builds an indexed mesh out of triangle corners. Corners with exactly the same position, normal and texture
+ * coordinates (bit for bit) share one vertex, found through an open addressing hash table.
+ */
+class VertexWelder
+{
+private:
+	MeshData& meshData;
+	std::vector<uint32_t> slots;
+	size_t slotMask;
+
+	void grow();
+	size_t findSlot(const Vertex& vertex) const;
+
+public:
+	VertexWelder(MeshData& meshData, size_t expectedCorners);
+
+	// Appends the corner's index to meshData.indices (and the vertex to meshData.vertices if it is new)
+	void AddCorner(const Vertex& vertex);
+};
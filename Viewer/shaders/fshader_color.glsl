@@ -3,38 +3,49 @@
 // MAX_LIGHTS_NUMBER is defined in Scene.h and the
 // define statement is inserted by the ShaderProgram::LoadShaders function
 
+// Every combination of features is its own program (see ShaderVariantCache), so nothing below branches
+// on them at runtime. The variant's defines are inserted the same way:
+// TEXTURES, BUMP_MAPPING, TOON_SHADING, EMISSIVE and LIGHT_COUNT (the number of lights).
+
 in vec3 fragPosition;
 in vec3 fragNormal;
 in vec2 fragTexCoords;
 
-// Camera
-uniform vec3 cameraLocation;
+// Camera and lights, set once per frame (see UniformBlocks.h)
+layout(std140) uniform CameraData
+{
+	mat4 view;
+	mat4 projection;
+	vec3 cameraLocation;
+};
+
+layout(std140) uniform LightingData
+{
+	vec4 ambiantLighting;
+	int toonShadingLevels;
+	vec3 lightsPositions[MAX_LIGHTS_NUMBER];
+	vec4 lightColors[MAX_LIGHTS_NUMBER];
+};
 
 // Textures
 uniform sampler2D textureMap;
-uniform bool useTextures;
-
-// Light
-uniform int numberOfLights;
-uniform vec3 lightsPositions[MAX_LIGHTS_NUMBER];
-uniform vec4 lightColors[MAX_LIGHTS_NUMBER];
 
-// Toon shading
-uniform bool useToonShading;
-uniform int toonShadingLevels;
+// Bump mapping, the models' normal map. Like the normal mapping program the BUMP_MAPPING variants replaced,
+// they don't sample it yet, so they shade the same as the others.
+uniform sampler2D bumpMap;
 
-// Model
-uniform vec4 ambiantColor;
-uniform vec4 ambiantLighting;
-uniform vec4 diffuseColor;
-uniform vec4 specularColor;
-uniform float shininess;
+// Model, its material comes from the vertex shader. Emissive models (the light sources) are drawn
+// in their ambiant color, without lighting.
+flat in vec4 fragAmbiantColor;
+flat in vec4 fragDiffuseColor;
+flat in vec4 fragSpecularColor;
+flat in float fragShininess;
 
 // The final color of the fragment (pixel)
 out vec4 frag_color;
 
-vec4 calculateDiffusePart( vec3 lightSourceLocation, vec4 lightColor);
-vec4 calculateSpecularPart(vec3 lightSourceLocation, vec4 lightColor);
+vec4 calculateDiffusePart( vec3 lightSourceLocation, vec4 lightColor, vec3 normal);
+vec4 calculateSpecularPart(vec3 lightSourceLocation, vec4 lightColor, vec3 normal);
 vec4 getDiffuseColor(float brightness, vec4 lightColor);
 float getBrightness(vec4 directionToLight, vec4 normalVector);
 float getDampedFactor(float relectionCameraDotProduct);
@@ -42,23 +53,25 @@ vec4 toonShade(vec4 color);
 
 void main()
 {
+#ifdef EMISSIVE
+	frag_color = fragAmbiantColor;
+#else
+	vec3 normal = fragNormal;
 	vec4 diffusePartSum =  vec4(0.0f);
 	vec4 specularPartSum = vec4(0.0f);
 	
-	for(int i = 0; i < numberOfLights; i++)
+	for(int i = 0; i < LIGHT_COUNT; i++)
 	{
-		diffusePartSum  = diffusePartSum  + calculateDiffusePart(lightsPositions[i],lightColors[i]);
-		specularPartSum = specularPartSum + calculateSpecularPart(lightsPositions[i],lightColors[i]);
+		diffusePartSum  = diffusePartSum  + calculateDiffusePart(lightsPositions[i],lightColors[i],normal);
+		specularPartSum = specularPartSum + calculateSpecularPart(lightsPositions[i],lightColors[i],normal);
 	}
-	diffusePartSum = diffusePartSum;
-	specularPartSum = specularPartSum;
 
-	frag_color = ambiantColor * ambiantLighting + diffusePartSum + specularPartSum;
+	frag_color = fragAmbiantColor * ambiantLighting + diffusePartSum + specularPartSum;
+#endif
 	frag_color.w = 1.0f;
-	if(useToonShading)
-	{
-		frag_color = toonShade(frag_color);
-	}
+#ifdef TOON_SHADING
+	frag_color = toonShade(frag_color);
+#endif
 }
 
 vec4 toonShade(vec4 color)
@@ -73,10 +86,10 @@ vec4 toonShade(vec4 color)
 	return color;
 }
 
-vec4 calculateDiffusePart(vec3 lightSourceLocation, vec4 lightColor)
+vec4 calculateDiffusePart(vec3 lightSourceLocation, vec4 lightColor, vec3 normal)
 {
 	vec4 directionToLight = vec4(normalize(lightSourceLocation - fragPosition),0.0f);
-	vec4 normalVector = vec4(fragNormal,0.0f);
+	vec4 normalVector = vec4(normal,0.0f);
 	float brightness = getBrightness(directionToLight, normalVector);
 	vec4 result = getDiffuseColor(brightness, lightColor);
 	
@@ -96,27 +109,17 @@ float getBrightness(vec4 directionToLight, vec4 normalVector)
 
 vec4 getDiffuseColor(float brightness, vec4 lightColor)
 {
-	if(useTextures) 
-	{
-		vec4 color = vec4(texture(textureMap, fragTexCoords) * brightness * lightColor);
-		//if(useToonShading)
-		//{
-		//	float level = floor(color.r * toonShadingLevels);
-		//	color.r = level/toonShadingLevels;
-		//	level = floor(color.g * toonShadingLevels);
-		//	color.g = level/toonShadingLevels;
-		//	level = floor(color.b * toonShadingLevels);
-		//	color.b = level/toonShadingLevels;
-		//}
-		return color;
-	}
-	return vec4(diffuseColor * brightness * lightColor);
+#ifdef TEXTURES
+	return vec4(texture(textureMap, fragTexCoords) * brightness * lightColor);
+#else
+	return vec4(fragDiffuseColor * brightness * lightColor);
+#endif
 }
 
-vec4 calculateSpecularPart(vec3 lightSourceLocation, vec4 lightColor)
+vec4 calculateSpecularPart(vec3 lightSourceLocation, vec4 lightColor, vec3 normal)
 {
 	// Explanation is here: http://learnwebgl.brown37.net/09_lights/lights_specular.html
-	vec4 normalVector = normalize(vec4(fragNormal,0.0f));
+	vec4 normalVector = normalize(vec4(normal,0.0f));
 	vec4 directionToLight = vec4(normalize(lightSourceLocation - fragPosition),0.0f);
 	float normalFactor = dot(directionToLight,normalVector);
 	vec4 N = normalVector * normalFactor; // light source projection on the normal
@@ -126,14 +129,14 @@ vec4 calculateSpecularPart(vec3 lightSourceLocation, vec4 lightColor)
 	vec4 V = vec4(normalize(cameraLocation - fragPosition),0.0f); // Direction to camera
 	float relectionCameraDotProduct = max(dot(R,V),0.0f);
 	float dampedFactor = getDampedFactor(relectionCameraDotProduct);
-	vec4 result = specularColor * dampedFactor * lightColor; 
+	vec4 result = fragSpecularColor * dampedFactor * lightColor; 
 	
 	return result;
 }
 
 float getDampedFactor(float relectionCameraDotProduct)
 {
-	float dampedFactor = pow(relectionCameraDotProduct,shininess);
+	float dampedFactor = pow(relectionCameraDotProduct,fragShininess);
 	dampedFactor = max(dampedFactor,0.001f);
 	//if(useToonShading)
 	//{
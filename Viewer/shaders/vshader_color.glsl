@@ -1,31 +1,77 @@
 #version 330 core
 
-layout(location = 0) in vec3 pos;
-layout(location = 1) in vec3 normal;
+layout(location = 0) in vec3 storedPosition;
+layout(location = 1) in vec3 storedNormal;
 layout(location = 2) in vec2 texCoords;
 
-// The model/view/projection matrices
+// The model matrix and the material are set for every draw, the camera is set once per frame (see UniformBlocks.h)
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform vec4 ambiantColor;
+uniform vec4 diffuseColor;
+uniform vec4 specularColor;
+uniform float shininess;
+
+// Instanced draws read them from the instance buffer instead (see InstancedModel)
+uniform bool instanced;
+layout(location = 3) in mat4 instanceModel;
+layout(location = 7) in vec4 instanceAmbiantColor;
+layout(location = 8) in vec4 instanceDiffuseColor;
+layout(location = 9) in vec4 instanceSpecularColor;
+layout(location = 10) in float instanceShininess;
+
+layout(std140) uniform CameraData
+{
+	mat4 view;
+	mat4 projection;
+	vec3 cameraLocation;
+};
+
+// How the vertices are stored (see VertexQuantizer). Quantized positions are relative to the
+// bounding box, quantized normals are octahedral encoded in storedNormal.xy.
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+uniform bool octahedralNormals;
 
 out vec3 fragPosition;
 out vec3 fragNormal;
 out vec2 fragTexCoords;
+flat out vec4 fragAmbiantColor;
+flat out vec4 fragDiffuseColor;
+flat out vec4 fragSpecularColor;
+flat out float fragShininess;
+
+vec3 decodeOctahedral(vec2 encoded)
+{
+	vec3 n = vec3(encoded, 1.0f - abs(encoded.x) - abs(encoded.y));
+	float fold = max(-n.z, 0.0f);
+	n.x += n.x >= 0.0f ? -fold : fold;
+	n.y += n.y >= 0.0f ? -fold : fold;
+	return normalize(n);
+}
 
 void main()
 {
+	vec3 pos = positionOffset + positionScale * storedPosition;
+	vec3 normal = octahedralNormals ? decodeOctahedral(storedNormal.xy * 2.0f - 1.0f) : storedNormal;
+	mat4 modelMatrix = instanced ? instanceModel : model;
+
 	// Apply the model transformation to the 'position' and 'normal' properties of the vertex,
 	// so the interpolated values of these properties will be available for usi n the fragment shader
-	vec4 position = vec4(model * vec4(pos,1.0f));
+	vec4 position = vec4(modelMatrix * vec4(pos,1.0f));
 	fragPosition = vec3(position) / position.w;
-	fragNormal = vec3(model * vec4(normal,0.0f));
+	fragNormal = vec3(modelMatrix * vec4(normal,0.0f));
 
 	// Pass the vertex texture coordinates property as it is. Its interpolated value
 	// will be avilable for us in the fragment shader
 	fragTexCoords = texCoords;
 
+	// The material is the same over the whole triangle
+	fragAmbiantColor = instanced ? instanceAmbiantColor : ambiantColor;
+	fragDiffuseColor = instanced ? instanceDiffuseColor : diffuseColor;
+	fragSpecularColor = instanced ? instanceSpecularColor : specularColor;
+	fragShininess = instanced ? instanceShininess : shininess;
+
 	// This is an internal OpenGL variable, we must set a value to this variable
-	gl_Position = projection * view * model * vec4(pos.x, pos.y, pos.z, 1.0f);
+	gl_Position = projection * view * modelMatrix * vec4(pos.x, pos.y, pos.z, 1.0f);
 	gl_Position = gl_Position / gl_Position.w;
 }
\ No newline at end of file
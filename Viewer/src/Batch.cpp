@@ -0,0 +1,396 @@
+#include "Batch.h"
+#include "GLStateCache.h"
+#include "HeadlessContext.h"
+#include "ImageWriter.h"
+#include "MeshAssetCache.h"
+#include "OffscreenTarget.h"
+#include "Renderer.h"
+#include "Scene.h"
+#include "TextureManager.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+int Batch::Run(int argc, char** argv)
+{
+	if (argc < 1 || std::string(argv[0]) == "--help")
+	{
+		printUsage();
+		return argc < 1 ? 1 : 0;
+	}
+
+	std::string jobsFile = argv[0];
+	int workers = 1;
+	std::vector<std::string> defaultArguments;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--workers" && i + 1 < argc)
+		{
+			workers = std::atoi(argv[++i]);
+		}
+		else
+		{
+			defaultArguments.push_back(argument);
+		}
+	}
+
+	SceneDescription defaults;
+	std::vector<Job> jobs;
+	if (workers < 1 || !defaults.Parse(defaultArguments) || !readJobs(jobsFile, defaults, jobs))
+	{
+		printUsage();
+		return 1;
+	}
+	if (jobs.empty())
+	{
+		std::cout << "No jobs in '" << jobsFile << "'" << std::endl;
+		return 0;
+	}
+
+	workers = std::min(workers, (int)jobs.size());
+	std::vector<std::vector<size_t>> shards = shardJobs(jobs, workers);
+	std::cout << "Rendering " << jobs.size() << " jobs with " << workers << " worker" << (workers > 1 ? "s" : "") << std::endl;
+
+	auto start = std::chrono::high_resolution_clock::now();
+	std::vector<BatchStatistics> statistics(workers);
+	if (workers == 1)
+	{
+		statistics[0] = runWorker(jobs, shards[0]);
+	}
+	else if (!runWorkerProcesses(jobs, shards, statistics))
+	{
+		return 1;
+	}
+	std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+	BatchStatistics total = {};
+	for (int worker = 0; worker < workers; worker++)
+	{
+		const BatchStatistics& workerStatistics = statistics[worker];
+		printStatistics("Worker " + std::to_string(worker), workerStatistics, workerStatistics.workerSeconds);
+		total.jobs += workerStatistics.jobs;
+		total.failedJobs += workerStatistics.failedJobs;
+		total.sharedMeshLoads += workerStatistics.sharedMeshLoads;
+		total.loadSeconds += workerStatistics.loadSeconds;
+		total.renderSeconds += workerStatistics.renderSeconds;
+		total.readbackSeconds += workerStatistics.readbackSeconds;
+		total.encodeSeconds += workerStatistics.encodeSeconds;
+		total.writeSeconds += workerStatistics.writeSeconds;
+	}
+	printStatistics("Batch", total, elapsed.count());
+	return total.failedJobs > 0 ? 1 : 0;
+}
+
+void Batch::printUsage()
+{
+	std::cout << "Usage: MeshViewer --batch <jobs file> [--workers <count = 1>] [scene options]" << std::endl;
+	std::cout << "  Every line of the jobs file is one image, written with the scene options of the line" << std::endl;
+	std::cout << "  (--output required), for example:" << std::endl;
+	std::cout << "    --model bunny.obj --eye 0 1 3 --at 0 0.5 0 --output bunny_front.png" << std::endl;
+	std::cout << "  The scene options given here are the defaults of every job." << std::endl;
+	SceneDescription::PrintOptions();
+}
+
+bool Batch::readJobs(const std::string& filePath, const SceneDescription& defaults, std::vector<Job>& jobs)
+{
+	std::ifstream file(filePath);
+	if (!file)
+	{
+		std::cerr << "Could not open the jobs file '" << filePath << "'" << std::endl;
+		return false;
+	}
+
+	// Every job is checked before any worker starts, a typo on the last line shouldn't waste the night
+	bool valid = true;
+	std::string line;
+	for (int lineNumber = 1; std::getline(file, line); lineNumber++)
+	{
+		std::istringstream tokens(line.substr(0, line.find('#')));
+		std::vector<std::string> arguments;
+		std::string token;
+		while (tokens >> token)
+		{
+			arguments.push_back(token);
+		}
+		if (arguments.empty())
+		{
+			continue;
+		}
+
+		Job job = { defaults, lineNumber };
+		ImageWriter::Format format;
+		if (!job.description.Parse(arguments))
+		{
+			valid = false;
+		}
+		else if (job.description.outputFile.empty())
+		{
+			std::cerr << "The job has no --output" << std::endl;
+			valid = false;
+		}
+		else if (!ImageWriter::GetFormat(job.description.outputFile, format))
+		{
+			std::cerr << "Unknown image format '" << job.description.outputFile << "', use .png or .ppm" << std::endl;
+			valid = false;
+		}
+		else if (!job.description.depthOutputFile.empty() && !ImageWriter::IsExrFile(job.description.depthOutputFile))
+		{
+			std::cerr << "The depth is written as OpenEXR, '" << job.description.depthOutputFile << "' isn't an .exr file" << std::endl;
+			valid = false;
+		}
+		else
+		{
+			jobs.push_back(job);
+			continue;
+		}
+		std::cerr << "  in " << filePath << ", line " << lineNumber << std::endl;
+	}
+	return valid;
+}
+
+std::vector<std::vector<size_t>> Batch::shardJobs(const std::vector<Job>& jobs, int workers)
+{
+	// Jobs with the same models are a group, in the order of the file
+	std::vector<std::vector<size_t>> groups;
+	std::unordered_map<std::string, size_t> groupIndices;
+	for (size_t i = 0; i < jobs.size(); i++)
+	{
+		const SceneDescription& description = jobs[i].description;
+		std::string key = description.instancingBenchmarkMesh + (description.cullingBenchmark ? "\n+cubes" : "");
+		for (const ModelDescription& model : description.models)
+		{
+			key += "\n" + model.filePath;
+		}
+
+		auto found = groupIndices.find(key);
+		if (found == groupIndices.end())
+		{
+			found = groupIndices.emplace(key, groups.size()).first;
+			groups.emplace_back();
+		}
+		groups[found->second].push_back(i);
+	}
+
+	// Groups bigger than a worker's share are split, so many views of one model still keep every worker busy
+	size_t share = (jobs.size() + workers - 1) / workers;
+	std::vector<std::vector<size_t>> chunks;
+	for (const std::vector<size_t>& group : groups)
+	{
+		for (size_t first = 0; first < group.size(); first += share)
+		{
+			chunks.emplace_back(group.begin() + first, group.begin() + std::min(group.size(), first + share));
+		}
+	}
+
+	// Rounding up the share can leave fewer chunks than workers (5 jobs of one model for 4 workers are chunks of
+	// 2, 2 and 1), the longest ones are halved until every worker gets one. There are never more workers than jobs.
+	while (chunks.size() < (size_t)workers)
+	{
+		auto longest = std::max_element(chunks.begin(), chunks.end(), [](const std::vector<size_t>& a, const std::vector<size_t>& b) { return a.size() < b.size(); });
+		size_t half = longest->size() / 2;
+		std::vector<size_t> secondHalf(longest->end() - half, longest->end());
+		longest->resize(longest->size() - half);
+		chunks.push_back(std::move(secondHalf));
+	}
+
+	// Longest chunks first, each to the worker with the fewest jobs so far
+	std::stable_sort(chunks.begin(), chunks.end(), [](const std::vector<size_t>& a, const std::vector<size_t>& b) { return a.size() > b.size(); });
+	std::vector<std::vector<size_t>> shards(workers);
+	for (const std::vector<size_t>& chunk : chunks)
+	{
+		auto shortest = std::min_element(shards.begin(), shards.end(), [](const std::vector<size_t>& a, const std::vector<size_t>& b) { return a.size() < b.size(); });
+		shortest->insert(shortest->end(), chunk.begin(), chunk.end());
+	}
+	return shards;
+}
+
+bool Batch::runWorkerProcesses(const std::vector<Job>& jobs, const std::vector<std::vector<size_t>>& shards, std::vector<BatchStatistics>& statistics)
+{
+#ifdef _WIN32
+	// There is no fork(), the shards run one after the other
+	for (size_t worker = 0; worker < shards.size(); worker++)
+	{
+		statistics[worker] = runWorker(jobs, shards[worker]);
+	}
+	return true;
+#else
+	// llvmpipe starts a thread per core in every context, the workers share the cores instead
+	unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+	std::string rasterizerThreads = std::to_string(std::max(1u, cores / (unsigned int)shards.size()));
+
+	// The children get a copy of everything, the output buffered so far included
+	std::cout.flush();
+	std::cerr.flush();
+
+	std::vector<pid_t> processes;
+	std::vector<int> pipes;
+	for (size_t worker = 0; worker < shards.size(); worker++)
+	{
+		int descriptors[2];
+		if (pipe(descriptors) != 0)
+		{
+			std::cerr << "Could not create a pipe for worker " << worker << std::endl;
+			break;
+		}
+
+		pid_t process = fork();
+		if (process == 0)
+		{
+			close(descriptors[0]);
+			setenv("LP_NUM_THREADS", rasterizerThreads.c_str(), 0);
+			BatchStatistics workerStatistics = runWorker(jobs, shards[worker]);
+			std::cout.flush();
+			std::cerr.flush();
+			bool sent = write(descriptors[1], &workerStatistics, sizeof(workerStatistics)) == sizeof(workerStatistics);
+			_exit(sent ? 0 : 1);
+		}
+
+		close(descriptors[1]);
+		if (process < 0)
+		{
+			std::cerr << "Could not start worker " << worker << std::endl;
+			close(descriptors[0]);
+			break;
+		}
+		processes.push_back(process);
+		pipes.push_back(descriptors[0]);
+	}
+
+	// A worker that died sends nothing, all of its jobs count as failed
+	bool started = processes.size() == shards.size();
+	for (size_t worker = 0; worker < processes.size(); worker++)
+	{
+		BatchStatistics& workerStatistics = statistics[worker];
+		if (read(pipes[worker], &workerStatistics, sizeof(workerStatistics)) != sizeof(workerStatistics))
+		{
+			std::cerr << "Worker " << worker << " did not finish" << std::endl;
+			workerStatistics = {};
+			workerStatistics.jobs = shards[worker].size();
+			workerStatistics.failedJobs = shards[worker].size();
+		}
+		close(pipes[worker]);
+		waitpid(processes[worker], nullptr, 0);
+	}
+	return started;
+#endif
+}
+
+BatchStatistics Batch::runWorker(const std::vector<Job>& jobs, const std::vector<size_t>& shard)
+{
+	auto workerStart = std::chrono::high_resolution_clock::now();
+	BatchStatistics statistics = {};
+	statistics.jobs = shard.size();
+
+	HeadlessContext context;
+	if (!context.Create())
+	{
+		statistics.failedJobs = shard.size();
+		return statistics;
+	}
+
+	// Scoped so the scene, the renderer and the target are gone before the context (see HeadlessContext)
+	{
+		TextureManager::Get().SetAsyncLoading(false);
+		GLStateCache::Get().SetDepthTest(true);
+		size_t sharedLoadsBefore = MeshAssetCache::Get().GetSharedLoads();
+
+		OffscreenTarget target;
+		Scene scene;
+		Renderer renderer(scene);
+		std::vector<unsigned char> pixels;
+		std::vector<unsigned char> encoded;
+		std::vector<float> depth;
+		std::vector<unsigned char> encodedDepth;
+		for (size_t index : shard)
+		{
+			const Job& job = jobs[index];
+			const SceneDescription& description = job.description;
+
+			// The meshes of the previous job are released here, and taken back by the loads that use them again
+			// (they are only deleted by the next Render)
+			auto start = std::chrono::high_resolution_clock::now();
+			scene.RemoveAllModels();
+			bool loaded = description.Apply(scene);
+			if (target.GetWidth() != description.width || target.GetHeight() != description.height)
+			{
+				loaded = target.Create(description.width, description.height) && loaded;
+			}
+			auto loadFinish = std::chrono::high_resolution_clock::now();
+			statistics.loadSeconds += std::chrono::duration<double>(loadFinish - start).count();
+			if (!loaded)
+			{
+				std::cerr << "Job of line " << job.line << " failed" << std::endl;
+				statistics.failedJobs++;
+				continue;
+			}
+
+			target.Bind();
+			renderer.ClearBuffers();
+			renderer.Render();
+			glFinish();
+			auto renderFinish = std::chrono::high_resolution_clock::now();
+
+			bool writeDepth = !description.depthOutputFile.empty();
+			target.ReadPixels(pixels);
+			if (writeDepth)
+			{
+				target.ReadDepth(depth);
+			}
+			auto readbackFinish = std::chrono::high_resolution_clock::now();
+
+			ImageWriter::Format format;
+			ImageWriter::GetFormat(description.outputFile, format);
+			ImageWriter::Encode(format, pixels.data(), target.GetWidth(), target.GetHeight(), encoded);
+			if (writeDepth)
+			{
+				ImageWriter::EncodeExrDepth(depth.data(), target.GetWidth(), target.GetHeight(), encodedDepth);
+			}
+			auto encodeFinish = std::chrono::high_resolution_clock::now();
+
+			bool written = ImageWriter::WriteFile(description.outputFile, encoded);
+			if (written && writeDepth && !ImageWriter::WriteFile(description.depthOutputFile, encodedDepth))
+			{
+				std::cerr << "Could not write '" << description.depthOutputFile << "' (line " << job.line << ")" << std::endl;
+				statistics.failedJobs++;
+			}
+			else if (!written)
+			{
+				std::cerr << "Could not write '" << description.outputFile << "' (line " << job.line << ")" << std::endl;
+				statistics.failedJobs++;
+			}
+			auto writeFinish = std::chrono::high_resolution_clock::now();
+
+			statistics.renderSeconds += std::chrono::duration<double>(renderFinish - loadFinish).count();
+			statistics.readbackSeconds += std::chrono::duration<double>(readbackFinish - renderFinish).count();
+			statistics.encodeSeconds += std::chrono::duration<double>(encodeFinish - readbackFinish).count();
+			statistics.writeSeconds += std::chrono::duration<double>(writeFinish - encodeFinish).count();
+		}
+		statistics.sharedMeshLoads = MeshAssetCache::Get().GetSharedLoads() - sharedLoadsBefore;
+	}
+
+	context.Destroy();
+	statistics.workerSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - workerStart).count();
+	return statistics;
+}
+
+void Batch::printStatistics(const std::string& name, const BatchStatistics& statistics, double seconds)
+{
+	size_t jobs = std::max<size_t>(1, statistics.jobs);
+	std::cout << name << ": " << statistics.jobs << " jobs (" << statistics.failedJobs << " failed) in " << seconds << " s, "
+		<< statistics.jobs / std::max(seconds, 1e-9) << " jobs/s, " << statistics.sharedMeshLoads << " loads of resident meshes" << std::endl;
+	std::cout << "  per job: load " << statistics.loadSeconds * 1000.0 / jobs << " ms, render " << statistics.renderSeconds * 1000.0 / jobs
+		<< " ms, readback " << statistics.readbackSeconds * 1000.0 / jobs << " ms, encode " << statistics.encodeSeconds * 1000.0 / jobs
+		<< " ms, write " << statistics.writeSeconds * 1000.0 / jobs << " ms" << std::endl;
+}
@@ -0,0 +1,522 @@
+#include "Benchmarks.h"
+#include "Frustum.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "NormalGenerator.h"
+#include "ObjParser.h"
+#include "ThreadPool.h"
+#include "Utils.h"
+#include "VertexQuantizer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <glm/ext.hpp>
+
+static constexpr int BENCHMARK_REPETITIONS = 3;
+
+// Returns the fastest of a few runs, in seconds
+template <typename Function>
+static double timeBestOf(int repetitions, Function function)
+{
+	double best = 0.0;
+	for (int i = 0; i < repetitions; i++)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		function();
+		auto finish = std::chrono::high_resolution_clock::now();
+		std::chrono::duration<double> elapsed = finish - start;
+		best = i == 0 ? elapsed.count() : std::min(best, elapsed.count());
+	}
+	return best;
+}
+
+// A wavy grid with per-vertex normals, written the way exporters usually write .obj files
+static std::string createSyntheticObj(size_t faceCount)
+{
+	size_t quadsPerSide = std::max<size_t>(1, (size_t)std::sqrt(faceCount / 2.0));
+	size_t verticesPerSide = quadsPerSide + 1;
+
+	std::string text;
+	text.reserve(verticesPerSide * verticesPerSide * 70 + quadsPerSide * quadsPerSide * 80);
+	text += "# synthetic benchmark mesh\n";
+
+	char line[128];
+	for (size_t row = 0; row < verticesPerSide; row++)
+	{
+		for (size_t column = 0; column < verticesPerSide; column++)
+		{
+			float x = (float)column / quadsPerSide - 0.5f;
+			float z = (float)row / quadsPerSide - 0.5f;
+			float y = 0.05f * std::sin(x * 40.0f) * std::cos(z * 40.0f);
+			int length = snprintf(line, sizeof(line), "v %.6f %.6f %.6f\nvn %.5f %.5f %.5f\n", x, y, z, 0.0f, 1.0f, 0.0f);
+			text.append(line, length);
+		}
+	}
+
+	for (size_t row = 0; row < quadsPerSide; row++)
+	{
+		for (size_t column = 0; column < quadsPerSide; column++)
+		{
+			size_t a = row * verticesPerSide + column + 1;
+			size_t b = a + 1;
+			size_t c = a + verticesPerSide;
+			size_t d = c + 1;
+			int length = snprintf(line, sizeof(line), "f %zu//%zu %zu//%zu %zu//%zu\nf %zu//%zu %zu//%zu %zu//%zu\n",
+				a, a, c, c, b, b, b, b, c, c, d, d);
+			text.append(line, length);
+		}
+	}
+
+	return text;
+}
+
+// The same wavy grid as createSyntheticObj, built directly in memory
+static void createSyntheticMesh(size_t faceCount, ObjData& data)
+{
+	size_t quadsPerSide = std::max<size_t>(1, (size_t)std::sqrt(faceCount / 2.0));
+	size_t verticesPerSide = quadsPerSide + 1;
+
+	data.vertices.reserve(verticesPerSide * verticesPerSide);
+	for (size_t row = 0; row < verticesPerSide; row++)
+	{
+		for (size_t column = 0; column < verticesPerSide; column++)
+		{
+			float x = (float)column / quadsPerSide - 0.5f;
+			float z = (float)row / quadsPerSide - 0.5f;
+			data.vertices.push_back(glm::vec3(x, 0.05f * std::sin(x * 40.0f) * std::cos(z * 40.0f), z));
+		}
+	}
+
+	const int noIndices[3] = { 0, 0, 0 };
+	data.faces.reserve(2 * quadsPerSide * quadsPerSide);
+	for (size_t row = 0; row < quadsPerSide; row++)
+	{
+		for (size_t column = 0; column < quadsPerSide; column++)
+		{
+			int a = (int)(row * verticesPerSide + column + 1);
+			int b = a + 1;
+			int c = a + (int)verticesPerSide;
+			int d = c + 1;
+			const int first[3] = { a, c, b };
+			const int second[3] = { b, c, d };
+			data.faces.emplace_back(first, noIndices, noIndices);
+			data.faces.emplace_back(second, noIndices, noIndices);
+		}
+	}
+}
+
+// Utils::CalculateNormals before NormalGenerator replaced it, kept as the baseline
+static std::vector<glm::vec3> legacyCalculateNormals(const std::vector<glm::vec3>& vertices, const std::vector<Face>& faces)
+{
+	std::vector<glm::vec3> normals(vertices.size());
+	std::vector<int> adjacent_faces_count(vertices.size());
+
+	for (unsigned int i = 0; i < adjacent_faces_count.size(); i++)
+	{
+		adjacent_faces_count[i] = 0;
+	}
+
+	for (unsigned int i = 0; i < faces.size(); i++)
+	{
+		const Face& currentFace = faces[i];
+
+		int index0 = currentFace.GetVertexIndex(0) - 1;
+		int index1 = currentFace.GetVertexIndex(1) - 1;
+		int index2 = currentFace.GetVertexIndex(2) - 1;
+
+		glm::vec3 v0 = vertices.at(index0);
+		glm::vec3 v1 = vertices.at(index1);
+		glm::vec3 v2 = vertices.at(index2);
+
+		glm::vec3 u = v0 - v1;
+		glm::vec3 v = v2 - v1;
+		glm::vec3 face_normal = glm::normalize(-glm::cross(u, v));
+
+		normals.at(index0) += face_normal;
+		normals.at(index1) += face_normal;
+		normals.at(index2) += face_normal;
+
+		adjacent_faces_count.at(index0) += 1;
+		adjacent_faces_count.at(index1) += 1;
+		adjacent_faces_count.at(index2) += 1;
+	}
+
+	for (unsigned int i = 0; i < normals.size(); i++)
+	{
+		normals[i] /= adjacent_faces_count[i];
+		normals[i] = glm::normalize(normals[i]);
+	}
+
+	return normals;
+}
+
+int Benchmarks::Run(int argc, char** argv)
+{
+	if (argc < 1)
+	{
+		printUsage();
+		return 1;
+	}
+
+	std::string name = argv[0];
+	if (name == "obj-parser") return objParserScaling(argc - 1, argv + 1);
+	if (name == "mesh-memory") return meshMemory(argc - 1, argv + 1);
+	if (name == "normals") return normalGeneration(argc - 1, argv + 1);
+	if (name == "mesh-optimizer") return meshOptimizer(argc - 1, argv + 1);
+	if (name == "vertex-formats") return vertexFormats(argc - 1, argv + 1);
+	if (name == "lod") return levelsOfDetail(argc - 1, argv + 1);
+	if (name == "culling") return frustumCulling(argc - 1, argv + 1);
+
+	printUsage();
+	return 1;
+}
+
+void Benchmarks::printUsage()
+{
+	std::cout << "Usage: MeshViewer --benchmark <name> [arguments]" << std::endl;
+	std::cout << "  obj-parser [million faces = 2]    .obj parsing speedup for 1/2/4/8/all threads" << std::endl;
+	std::cout << "  mesh-memory <file.obj>...         GPU buffer sizes before/after vertex welding" << std::endl;
+	std::cout << "  normals [million faces = 5] [file.obj]...  normal generation vs. the old CalculateNormals" << std::endl;
+	std::cout << "  mesh-optimizer <file.obj>...      vertex cache efficiency (ACMR/ATVR) before/after MeshOptimizer" << std::endl;
+	std::cout << "  vertex-formats <file.obj>...      vertex buffer size and precision of every VertexFormat" << std::endl;
+	std::cout << "  lod <file.obj>...                 levels of detail built by MeshSimplifier, 1 thread vs. all" << std::endl;
+	std::cout << "  culling [models = 100000]         frustum culling of bounding spheres, scalar vs. SSE batches" << std::endl;
+}
+
+int Benchmarks::objParserScaling(int argc, char** argv)
+{
+	double millionFaces = argc > 0 ? std::atof(argv[0]) : 2.0;
+	size_t faceCount = (size_t)(millionFaces * 1000000.0);
+
+	std::cout << "Generating a synthetic .obj with " << faceCount << " faces..." << std::endl;
+	std::string text = createSyntheticObj(faceCount);
+	double megabytes = text.size() / (1024.0 * 1024.0);
+
+	unsigned int allThreads = ThreadPool::GetShared().GetConcurrency();
+	std::vector<unsigned int> threadCounts = { 1, 2, 4, 8, allThreads };
+	std::sort(threadCounts.begin(), threadCounts.end());
+	threadCounts.erase(std::unique(threadCounts.begin(), threadCounts.end()), threadCounts.end());
+
+	std::cout << megabytes << " MB, " << allThreads << " hardware threads" << std::endl;
+	printf("%8s %12s %12s %10s\n", "threads", "time (ms)", "MB/s", "speedup");
+
+	double singleThreadSeconds = 0.0;
+	size_t expectedFaces = 0;
+	for (unsigned int threads : threadCounts)
+	{
+		size_t parsedFaces = 0;
+		double seconds = timeBestOf(BENCHMARK_REPETITIONS, [&]()
+		{
+			ObjData data;
+			ObjParser::Parse(text.data(), text.data() + text.size(), data, threads);
+			parsedFaces = data.faces.size();
+		});
+
+		if (threads == 1)
+		{
+			singleThreadSeconds = seconds;
+			expectedFaces = parsedFaces;
+		}
+		else if (parsedFaces != expectedFaces)
+		{
+			std::cerr << "Error: " << threads << " threads parsed " << parsedFaces << " faces instead of " << expectedFaces << std::endl;
+			return 1;
+		}
+
+		printf("%8u %12.2f %12.1f %9.2fx%s\n", threads, seconds * 1000.0, megabytes / seconds, singleThreadSeconds / seconds,
+			threads > allThreads ? " (oversubscribed)" : "");
+	}
+
+	return 0;
+}
+
+int Benchmarks::meshMemory(int argc, char** argv)
+{
+	if (argc < 1)
+	{
+		printUsage();
+		return 1;
+	}
+
+	printf("%-24s %10s %10s %8s %14s %14s %8s\n", "model", "corners", "vertices", "index", "de-indexed KB", "indexed KB", "saved");
+	for (int i = 0; i < argc; i++)
+	{
+		ObjData objData;
+		ObjParseStatistics statistics;
+		if (!ObjParser::ParseFile(argv[i], objData, statistics))
+		{
+			std::cerr << "Error loading model '" << argv[i] << "'" << std::endl;
+			return 1;
+		}
+
+		std::vector<glm::vec3> normals = Utils::CalculateNormals(objData.vertices, objData.faces);
+		MeshData meshData = Utils::BuildMeshData(objData.faces, objData.vertices, normals, objData.textureCoords);
+		std::vector<uint16_t> shortIndices;
+		MeshView mesh = meshData.GetView().WithShortIndices(shortIndices);
+		std::string filePath = argv[i];
+		std::string fileName = filePath.substr(filePath.find_last_of("/\\") + 1);
+
+		double deindexedKilobytes = mesh.indexCount * sizeof(Vertex) / 1024.0;
+		double indexedKilobytes = (mesh.GetVertexBytes() + mesh.GetIndexBytes()) / 1024.0;
+		printf("%-24s %10zu %10zu %6zu b %14.1f %14.1f %7.1f%%\n", fileName.c_str(), mesh.indexCount, mesh.vertexCount,
+			8 * mesh.indexSize, deindexedKilobytes, indexedKilobytes, deindexedKilobytes > 0.0 ? 100.0 * (1.0 - indexedKilobytes / deindexedKilobytes) : 0.0);
+	}
+
+	return 0;
+}
+
+int Benchmarks::normalGeneration(int argc, char** argv)
+{
+	struct NamedMesh
+	{
+		std::string name;
+		ObjData data;
+	};
+	std::vector<NamedMesh> meshes;
+
+	double millionFaces = argc > 0 ? std::atof(argv[0]) : 5.0;
+	for (int i = 1; i < argc; i++)
+	{
+		NamedMesh mesh;
+		std::string filePath = argv[i];
+		mesh.name = filePath.substr(filePath.find_last_of("/\\") + 1);
+		ObjParseStatistics statistics;
+		if (!ObjParser::ParseFile(filePath, mesh.data, statistics))
+		{
+			std::cerr << "Error loading model '" << filePath << "'" << std::endl;
+			return 1;
+		}
+		meshes.push_back(std::move(mesh));
+	}
+
+	NamedMesh synthetic;
+	synthetic.name = "synthetic";
+	createSyntheticMesh((size_t)(millionFaces * 1000000.0), synthetic.data);
+	meshes.push_back(std::move(synthetic));
+
+	unsigned int allThreads = ThreadPool::GetShared().GetConcurrency();
+	std::cout << allThreads << " hardware threads, times in ms" << std::endl;
+	printf("%-14s %9s %9s | %9s %9s %9s %9s %9s | %9s\n", "model", "faces", "legacy",
+		"avg 1 thr", "avg all", "area", "angle", "crease60", "max error");
+
+	for (NamedMesh& mesh : meshes)
+	{
+		const std::vector<glm::vec3>& vertices = mesh.data.vertices;
+		std::vector<Face>& faces = mesh.data.faces;
+		std::vector<glm::vec3> legacyNormals, normals;
+
+		double legacySeconds = timeBestOf(BENCHMARK_REPETITIONS, [&]() { legacyNormals = legacyCalculateNormals(vertices, faces); });
+		double averageSeconds = timeBestOf(BENCHMARK_REPETITIONS, [&]() { normals = NormalGenerator::Generate(vertices, faces, NormalWeighting::Average, 1); });
+		double parallelSeconds = timeBestOf(BENCHMARK_REPETITIONS, [&]() { NormalGenerator::Generate(vertices, faces, NormalWeighting::Average); });
+		double areaSeconds = timeBestOf(BENCHMARK_REPETITIONS, [&]() { NormalGenerator::Generate(vertices, faces, NormalWeighting::Area); });
+		double angleSeconds = timeBestOf(BENCHMARK_REPETITIONS, [&]() { NormalGenerator::Generate(vertices, faces, NormalWeighting::Angle); });
+		double creaseSeconds = timeBestOf(BENCHMARK_REPETITIONS, [&]() { NormalGenerator::GenerateWithCreases(vertices, faces, 60.0f); });
+
+		// Largest angle (in degrees) between the old and the new averaged normals, ignoring the NaNs the old code produced
+		double maximumError = 0.0;
+		for (size_t i = 0; i < normals.size(); i++)
+		{
+			glm::vec3 cross = glm::cross(legacyNormals[i], normals[i]);
+			double angle = std::atan2(std::sqrt(glm::dot(cross, cross)), glm::dot(legacyNormals[i], normals[i]));
+			if (angle == angle)
+			{
+				maximumError = std::max(maximumError, angle * 180.0 / 3.14159265358979);
+			}
+		}
+
+		printf("%-14s %9zu %9.2f | %9.2f %9.2f %9.2f %9.2f %9.2f | %8.5f\n", mesh.name.c_str(), faces.size(), legacySeconds * 1000.0,
+			averageSeconds * 1000.0, parallelSeconds * 1000.0, areaSeconds * 1000.0, angleSeconds * 1000.0, creaseSeconds * 1000.0, maximumError);
+	}
+
+	return 0;
+}
+
+int Benchmarks::meshOptimizer(int argc, char** argv)
+{
+	if (argc < 1)
+	{
+		printUsage();
+		return 1;
+	}
+
+	std::cout << "FIFO cache of " << VERTEX_CACHE_SIMULATION_SIZE << " vertices" << std::endl;
+	printf("%-24s %10s %8s %8s %8s %8s %9s %10s\n", "model", "triangles", "ACMR", "after", "ATVR", "after", "clusters", "time (ms)");
+	for (int i = 0; i < argc; i++)
+	{
+		ObjData objData;
+		ObjParseStatistics statistics;
+		if (!ObjParser::ParseFile(argv[i], objData, statistics))
+		{
+			std::cerr << "Error loading model '" << argv[i] << "'" << std::endl;
+			return 1;
+		}
+
+		std::vector<glm::vec3> normals = Utils::CalculateNormals(objData.vertices, objData.faces);
+		MeshData meshData = Utils::BuildMeshData(objData.faces, objData.vertices, normals, objData.textureCoords);
+		MeshOptimizationStatistics optimization;
+		MeshOptimizer::Optimize(meshData, optimization);
+
+		std::string filePath = argv[i];
+		std::string fileName = filePath.substr(filePath.find_last_of("/\\") + 1);
+		printf("%-24s %10zu %8.3f %8.3f %8.3f %8.3f %9zu %10.2f\n", fileName.c_str(), meshData.indices.size() / 3,
+			optimization.before.acmr, optimization.after.acmr, optimization.before.atvr, optimization.after.atvr,
+			optimization.overdrawClusters, optimization.seconds * 1000.0);
+	}
+
+	return 0;
+}
+
+int Benchmarks::vertexFormats(int argc, char** argv)
+{
+	if (argc < 1)
+	{
+		printUsage();
+		return 1;
+	}
+
+	const VertexFormat formats[] = { VertexFormat::Float, VertexFormat::Quantized16, VertexFormat::Quantized8 };
+	printf("%-24s %-28s %12s %14s %13s %12s %10s\n", "model", "format", "vertices (KB)", "position error", "normal (deg)", "uv error", "time (ms)");
+	for (int i = 0; i < argc; i++)
+	{
+		ObjData objData;
+		ObjParseStatistics statistics;
+		if (!ObjParser::ParseFile(argv[i], objData, statistics))
+		{
+			std::cerr << "Error loading model '" << argv[i] << "'" << std::endl;
+			return 1;
+		}
+
+		std::vector<glm::vec3> normals = Utils::CalculateNormals(objData.vertices, objData.faces);
+		MeshData meshData = Utils::BuildMeshData(objData.faces, objData.vertices, normals, objData.textureCoords);
+
+		std::string filePath = argv[i];
+		std::string fileName = filePath.substr(filePath.find_last_of("/\\") + 1);
+		for (VertexFormat format : formats)
+		{
+			std::vector<uint8_t> storage;
+			MeshView mesh;
+			double seconds = timeBestOf(BENCHMARK_REPETITIONS, [&]() { mesh = VertexQuantizer::Quantize(meshData.GetView(), format, storage); });
+			QuantizationError error = VertexQuantizer::MeasureError(meshData.GetView(), format);
+
+			printf("%-24s %-28s %12.1f %14.2e %13.4f %12.2e %10.2f\n", fileName.c_str(), VertexQuantizer::GetFormatName(format),
+				mesh.GetVertexBytes() / 1024.0, error.position, error.normalDegrees, error.textureCoords, seconds * 1000.0);
+		}
+
+		QuantizationError error;
+		VertexFormat chosen = VertexQuantizer::ChooseFormat(meshData.GetView(), VertexFormat::Auto, error);
+		printf("%-24s %-28s\n", fileName.c_str(), (std::string("auto: ") + VertexQuantizer::GetFormatName(chosen)).c_str());
+	}
+
+	return 0;
+}
+
+int Benchmarks::levelsOfDetail(int argc, char** argv)
+{
+	if (argc < 1)
+	{
+		printUsage();
+		return 1;
+	}
+
+	printf("%-24s %10s %10s %12s %12s %12s\n", "model", "level", "triangles", "error", "1 thread", "all threads");
+	for (int i = 0; i < argc; i++)
+	{
+		ObjData objData;
+		ObjParseStatistics statistics;
+		if (!ObjParser::ParseFile(argv[i], objData, statistics))
+		{
+			std::cerr << "Error loading model '" << argv[i] << "'" << std::endl;
+			return 1;
+		}
+
+		std::vector<glm::vec3> normals = Utils::CalculateNormals(objData.vertices, objData.faces);
+		MeshData meshData = Utils::BuildMeshData(objData.faces, objData.vertices, normals, objData.textureCoords);
+		MeshOptimizationStatistics optimization;
+		MeshOptimizer::Optimize(meshData, optimization);
+		size_t fullIndexCount = meshData.indices.size();
+
+		MeshData levels;
+		auto generate = [&](unsigned int threadCount)
+		{
+			levels = meshData;
+			MeshSimplifier::GenerateLods(levels, 4, threadCount);
+		};
+		double serialSeconds = timeBestOf(1, [&]() { generate(1); });
+		double parallelSeconds = timeBestOf(1, [&]() { generate(0); });
+
+		std::string filePath = argv[i];
+		std::string fileName = filePath.substr(filePath.find_last_of("/\\") + 1);
+		if (levels.lods.empty())
+		{
+			printf("%-24s %10s %10zu %12s %12.2f %12.2f\n", fileName.c_str(), "none", fullIndexCount / 3, "-", serialSeconds * 1000.0, parallelSeconds * 1000.0);
+			continue;
+		}
+
+		for (size_t level = 0; level < levels.lods.size(); level++)
+		{
+			printf("%-24s %10zu %10u %12.5f", fileName.c_str(), level, levels.lods[level].indexCount / 3, levels.lods[level].error);
+			if (level == 0) printf(" %12.2f %12.2f", serialSeconds * 1000.0, parallelSeconds * 1000.0);
+			printf("\n");
+		}
+	}
+
+	return 0;
+}
+
+int Benchmarks::frustumCulling(int argc, char** argv)
+{
+	size_t modelCount = argc > 0 ? (size_t)std::atol(argv[0]) : 100000;
+	static constexpr int FRAMES = 64;
+
+	// Models scattered around the camera, which turns a full circle over the frames
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> radius(0.1f, 2.0f);
+	SphereBatch spheres;
+	for (size_t i = 0; i < modelCount; i++)
+	{
+		BoundingSphere sphere;
+		sphere.center = glm::vec3(position(random), position(random) * 0.1f, position(random));
+		sphere.radius = radius(random);
+		spheres.Add(sphere);
+	}
+
+	std::vector<Frustum> frustums;
+	glm::mat4 projection = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 150.0f);
+	for (int frame = 0; frame < FRAMES; frame++)
+	{
+		float angle = 2.0f * PI * frame / FRAMES;
+		glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(std::cos(angle), 0.0f, std::sin(angle)), glm::vec3(0.0f, 1.0f, 0.0f));
+		frustums.push_back(Frustum(projection * view));
+	}
+
+	// Both versions must agree on every model in every frame
+	std::vector<uint8_t> scalarVisible, simdVisible;
+	size_t visibleTotal = 0;
+	for (const Frustum& frustum : frustums)
+	{
+		visibleTotal += frustum.CullScalar(spheres, scalarVisible);
+		frustum.Cull(spheres, simdVisible);
+		if (scalarVisible != simdVisible)
+		{
+			std::cerr << "Error: the SSE and scalar culling results differ" << std::endl;
+			return 1;
+		}
+	}
+
+	std::vector<uint8_t> visible;
+	double scalarSeconds = timeBestOf(BENCHMARK_REPETITIONS, [&]() { for (const Frustum& frustum : frustums) frustum.CullScalar(spheres, visible); });
+	double simdSeconds = timeBestOf(BENCHMARK_REPETITIONS, [&]() { for (const Frustum& frustum : frustums) frustum.Cull(spheres, visible); });
+
+	printf("%zu models, %.1f%% visible on average\n", modelCount, 100.0 * visibleTotal / ((double)modelCount * FRAMES));
+	printf("%-10s %14s %14s %9s\n", "test", "ms per frame", "ns per model", "speedup");
+	printf("%-10s %14.3f %14.2f %9.2fx\n", "scalar", scalarSeconds * 1000.0 / FRAMES, scalarSeconds * 1e9 / ((double)modelCount * FRAMES), 1.0);
+	printf("%-10s %14.3f %14.2f %9.2fx\n", "batched", simdSeconds * 1000.0 / FRAMES, simdSeconds * 1e9 / ((double)modelCount * FRAMES), scalarSeconds / simdSeconds);
+	return 0;
+}
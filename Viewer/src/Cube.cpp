@@ -1,11 +1,11 @@
 #include "Cube.h"
+#include "VertexWelder.h"
 using namespace std;
 
 Cube::Cube(glm::vec4 location, float size) :Cube(location,size,size,size) {}
 
 Cube::Cube(glm::vec4 location, float length, float width, float height) : length(length), width(width), height(height), location(location)
 {
-	textureLoaded = false;
 	std::vector<glm::vec3> vertices;
 	vertices = {
 	glm::vec3(-width, -height,  length),
@@ -41,10 +41,11 @@ Cube::Cube(glm::vec4 location, float length, float width, float height) : length
 		glm::vec3(0,  0, -1)
 	};
 
-	modelVertices.reserve(3 * faces.size());
+	MeshData meshData;
+	VertexWelder welder(meshData, 3 * faces.size());
 	for (unsigned int i = 0; i < faces.size(); i++)
 	{
-		Face currentFace = faces.at(i);
+		const Face& currentFace = faces[i];
 		for (int j = 0; j < 3; j++)
 		{
 			int vertexIndex = currentFace.GetVertexIndex(j) - 1;
@@ -53,32 +54,15 @@ Cube::Cube(glm::vec4 location, float length, float width, float height) : length
 			Vertex vertex;
 			vertex.position = vertices[vertexIndex];
 			vertex.normal = normals[normalIndex];
-			modelVertices.push_back(vertex);
+			welder.AddCorner(vertex);
 		}
 	}
 
-	glGenVertexArrays(1, &vao);
-	glGenBuffers(1, &vbo);
-
-	glBindVertexArray(vao);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, modelVertices.size() * sizeof(Vertex), &modelVertices[0], GL_STATIC_DRAW);
-
-	// Vertex Positions
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)0);
-	glEnableVertexAttribArray(0);
-
-	// Normals attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)(3 * sizeof(GLfloat)));
-	glEnableVertexAttribArray(1);
-
-	// unbind to make sure other code does not change it somewhere else
-	glBindVertexArray(0);
+	meshData.CalculateBounds();
+	uploadMesh(meshData.GetView());
 }
 
 Cube::~Cube()
 {
-	glDeleteVertexArrays(1, &vao);
-	glDeleteBuffers(1, &vbo);
+	// The GPU mesh is released by ~MeshModel
 }
-
@@ -1,15 +1,21 @@
 #include "Face.h"
 
-Face::Face(std::istream& issLine)
+Face::Face()
 {
-	vertexIndices =  { 0, 0, 0 };
-	normalIndices =  { 0, 0, 0 };
-	textureIndices = { 0, 0, 0 };
+	for (int i = 0; i < 3; i++)
+	{
+		vertexIndices[i] = 0;
+		normalIndices[i] = 0;
+		textureIndices[i] = 0;
+	}
+}
 
+Face::Face(std::istream& issLine) : Face()
+{
 	char c;
 	for (int i = 0; i < 3; i++)
 	{
-		issLine >> std::ws >> vertexIndices.at(i) >> std::ws;
+		issLine >> std::ws >> vertexIndices[i] >> std::ws;
 
 		if (issLine.peek() != '/')
 		{
@@ -20,12 +26,12 @@ Face::Face(std::istream& issLine)
 
 		if (issLine.peek() == '/')
 		{
-			issLine >> c >> std::ws >> normalIndices.at(i);
+			issLine >> c >> std::ws >> normalIndices[i];
 			continue;
 		}
 		else
 		{
-			issLine >> textureIndices.at(i);
+			issLine >> textureIndices[i];
 		}
 
 		if (issLine.peek() != '/')
@@ -33,33 +39,27 @@ Face::Face(std::istream& issLine)
 			continue;
 		}
 
-		issLine >> c >> normalIndices.at(i);
+		issLine >> c >> normalIndices[i];
 	}
 }
 
-Face::Face(std::vector<int>& newVerticesIndices, std::vector<int>& newNormalIndices, std::vector<int>& newTextureIndices)
+// Missing indices (e.g. an empty textures vector) are left as 0
+Face::Face(const std::vector<int>& newVerticesIndices, const std::vector<int>& newNormalIndices, const std::vector<int>& newTextureIndices) : Face()
 {
-	vertexIndices = newVerticesIndices;
-	normalIndices = newNormalIndices;
-	textureIndices = newTextureIndices;
-}
-
-Face::~Face()
-{
-
-}
-
-const int Face::GetVertexIndex(int index)
-{
-	return vertexIndices[index];
-}
-
-const int Face::GetNormalIndex(int index)
-{
-	return normalIndices[index];
+	for (int i = 0; i < 3; i++)
+	{
+		if (i < (int)newVerticesIndices.size()) vertexIndices[i] = newVerticesIndices[i];
+		if (i < (int)newNormalIndices.size())   normalIndices[i] = newNormalIndices[i];
+		if (i < (int)newTextureIndices.size())  textureIndices[i] = newTextureIndices[i];
+	}
 }
 
-const int Face::GetTextureIndex(int index)
+Face::Face(const int newVerticesIndices[3], const int newNormalIndices[3], const int newTextureIndices[3])
 {
-	return textureIndices[index];
+	for (int i = 0; i < 3; i++)
+	{
+		vertexIndices[i] = newVerticesIndices[i];
+		normalIndices[i] = newNormalIndices[i];
+		textureIndices[i] = newTextureIndices[i];
+	}
 }
@@ -0,0 +1,55 @@
+#include "FrameArena.h"
+#include <algorithm>
+
+FrameArena::FrameArena() : used(0), frameSize(0), blockAllocations(0)
+{
+	addBlock(FRAME_ARENA_INITIAL_SIZE);
+}
+
+void FrameArena::addBlock(size_t size)
+{
+	Block block;
+	block.memory.reset(new uint8_t[size]);
+	block.size = size;
+	blocks.push_back(std::move(block));
+	used = 0;
+	blockAllocations++;
+}
+
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+	Block* block = &blocks.back();
+	uintptr_t base = (uintptr_t)block->memory.get();
+	size_t offset = ((base + used + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base;
+
+	if (offset + size > block->size)
+	{
+		// Doubles the arena (at least), so a frame needs few blocks even while it is warming up
+		addBlock(std::max(size + alignment, frameSize + blocks.back().size));
+		block = &blocks.back();
+		base = (uintptr_t)block->memory.get();
+		offset = ((base + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base;
+	}
+
+	used = offset + size;
+	frameSize += size;
+	return block->memory.get() + offset;
+}
+
+void FrameArena::Reset()
+{
+	if (blocks.size() > 1)
+	{
+		// Replace the blocks with one that fits the whole frame (with room for the alignment padding)
+		size_t total = 0;
+		for (const Block& block : blocks)
+		{
+			total += block.size;
+		}
+		blocks.clear();
+		addBlock(total);
+	}
+
+	used = 0;
+	frameSize = 0;
+}
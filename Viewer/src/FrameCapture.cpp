@@ -0,0 +1,304 @@
+#include "FrameCapture.h"
+#include "ImageWriter.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+FrameCapture::FrameCapture() :
+	slots{},
+	nextSlot(0),
+	oldestSlot(0),
+	busySlots(0),
+	frame(0),
+	dropWhenBusy(true),
+	recording(false),
+	recordedFrames(0),
+	encodesInFlight(0),
+	statistics{}
+{
+}
+
+FrameCapture& FrameCapture::Get()
+{
+	// Flush before the context is destroyed, captures still in its buffers would be lost
+	static FrameCapture capture;
+	return capture;
+}
+
+void FrameCapture::createBuffers()
+{
+	for (Slot& slot : slots)
+	{
+		glGenBuffers(1, &slot.colorBuffer);
+		glGenBuffers(1, &slot.depthBuffer);
+	}
+}
+
+std::string FrameCapture::GetFrameFilePath(const std::string& pattern, int frame)
+{
+	std::string filePath = pattern;
+	size_t number = filePath.find("%d");
+	if (number != std::string::npos)
+	{
+		filePath.replace(number, 2, std::to_string(frame));
+	}
+	return filePath;
+}
+
+bool FrameCapture::Capture(int width, int height, const std::string& colorFile, const std::string& depthFile)
+{
+	if (slots[0].colorBuffer == 0)
+	{
+		createBuffers();
+	}
+
+	if (slots[nextSlot].busy)
+	{
+		if (dropWhenBusy)
+		{
+			std::lock_guard<std::mutex> lock(encodeMutex);
+			statistics.droppedFrames++;
+			return false;
+		}
+		readBack(slots[oldestSlot], true);
+	}
+
+	Slot& slot = slots[nextSlot];
+	slot.width = width;
+	slot.height = height;
+	slot.colorFile = colorFile;
+	slot.depthFile = depthFile;
+	slot.frame = frame;
+	slot.captureTime = std::chrono::high_resolution_clock::now();
+
+	// glReadPixels into a bound pack buffer only queues the copy, the fence tells when it is done
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	if (!colorFile.empty())
+	{
+		size_t bytes = (size_t)width * height * 4;
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.colorBuffer);
+		if (slot.colorBytes < bytes)
+		{
+			glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+			slot.colorBytes = bytes;
+		}
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	}
+	if (!depthFile.empty())
+	{
+		size_t bytes = (size_t)width * height * sizeof(float);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.depthBuffer);
+		if (slot.depthBytes < bytes)
+		{
+			glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+			slot.depthBytes = bytes;
+		}
+		glReadPixels(0, 0, width, height, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	slot.busy = true;
+	busySlots++;
+	nextSlot = (nextSlot + 1) % FRAME_CAPTURE_BUFFERS;
+
+	std::lock_guard<std::mutex> lock(encodeMutex);
+	statistics.capturedFrames++;
+	return true;
+}
+
+bool FrameCapture::StartRecording(const std::string& colorPattern, const std::string& depthPattern)
+{
+	ImageWriter::Format format;
+	if (!ImageWriter::GetFormat(colorPattern, format) || (!depthPattern.empty() && !ImageWriter::IsExrFile(depthPattern)))
+	{
+		std::cerr << "Can't record to '" << colorPattern << "', use a .png or .ppm file (and an .exr file for the depth)" << std::endl;
+		return false;
+	}
+
+	recordColorPattern = colorPattern;
+	recordDepthPattern = depthPattern;
+	recordedFrames = 0;
+	recording = true;
+	return true;
+}
+
+void FrameCapture::RecordFrame(int width, int height)
+{
+	if (!recording)
+	{
+		return;
+	}
+
+	// Dropped frames keep their number, so the gaps show in the sequence
+	std::string depthFile = recordDepthPattern.empty() ? "" : GetFrameFilePath(recordDepthPattern, recordedFrames);
+	Capture(width, height, GetFrameFilePath(recordColorPattern, recordedFrames), depthFile);
+	recordedFrames++;
+}
+
+void FrameCapture::Update()
+{
+	frame++;
+	while (busySlots > 0)
+	{
+		Slot& slot = slots[oldestSlot];
+		if (frame - slot.frame < (size_t)FRAME_CAPTURE_LATENCY)
+		{
+			break;
+		}
+
+		// Captures complete in order, if the oldest isn't done neither are the others
+		if (glClientWaitSync(slot.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+		{
+			break;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(encodeMutex);
+			if (encodesInFlight >= FRAME_CAPTURE_MAX_ENCODES) break;
+		}
+		readBack(slot, false);
+	}
+}
+
+void FrameCapture::Flush()
+{
+	while (busySlots > 0)
+	{
+		readBack(slots[oldestSlot], true);
+	}
+
+	std::unique_lock<std::mutex> lock(encodeMutex);
+	encodeDone.wait(lock, [this]() { return encodesInFlight == 0; });
+}
+
+void FrameCapture::readBack(Slot& slot, bool wait)
+{
+	if (wait)
+	{
+		while (glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED)
+		{
+		}
+
+		std::unique_lock<std::mutex> lock(encodeMutex);
+		encodeDone.wait(lock, [this]() { return encodesInFlight < FRAME_CAPTURE_MAX_ENCODES; });
+	}
+	glDeleteSync(slot.fence);
+	slot.fence = nullptr;
+
+	encode(slot);
+
+	slot.busy = false;
+	busySlots--;
+	oldestSlot = (oldestSlot + 1) % FRAME_CAPTURE_BUFFERS;
+}
+
+void FrameCapture::encode(Slot& slot)
+{
+	// OpenGL reads the bottom row first, the images are stored top row first
+	int width = slot.width;
+	int height = slot.height;
+	bool mapped = true;
+
+	auto color = std::make_shared<std::vector<unsigned char>>();
+	if (!slot.colorFile.empty())
+	{
+		size_t rowBytes = (size_t)width * 4;
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.colorBuffer);
+		const unsigned char* pixels = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, rowBytes * height, GL_MAP_READ_BIT);
+		if (pixels != nullptr)
+		{
+			color->resize(rowBytes * height);
+			for (int y = 0; y < height; y++)
+			{
+				std::memcpy(color->data() + y * rowBytes, pixels + (height - 1 - y) * rowBytes, rowBytes);
+			}
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		mapped = mapped && pixels != nullptr;
+	}
+
+	auto depth = std::make_shared<std::vector<float>>();
+	if (!slot.depthFile.empty())
+	{
+		size_t rowBytes = (size_t)width * sizeof(float);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.depthBuffer);
+		const float* values = (const float*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, rowBytes * height, GL_MAP_READ_BIT);
+		if (values != nullptr)
+		{
+			depth->resize((size_t)width * height);
+			for (int y = 0; y < height; y++)
+			{
+				std::memcpy(depth->data() + (size_t)y * width, values + (size_t)(height - 1 - y) * width, rowBytes);
+			}
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		mapped = mapped && values != nullptr;
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	if (!mapped)
+	{
+		std::cerr << "Could not map the captured frame for '" << slot.colorFile << "'" << std::endl;
+		std::lock_guard<std::mutex> lock(encodeMutex);
+		statistics.failedFiles++;
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(encodeMutex);
+		encodesInFlight++;
+	}
+
+	std::string colorFile = slot.colorFile;
+	std::string depthFile = slot.depthFile;
+	auto captureTime = slot.captureTime;
+	ThreadPool::GetShared().Enqueue([this, color, depth, colorFile, depthFile, width, height, captureTime]()
+	{
+		size_t written = 0, failed = 0;
+		{
+			ProfileZone zone("Encode frame");
+			if (!colorFile.empty())
+			{
+				bool colorWritten = ImageWriter::Write(colorFile, color->data(), width, height);
+				written += colorWritten;
+				failed += !colorWritten;
+			}
+			if (!depthFile.empty())
+			{
+				std::vector<unsigned char> bytes;
+				ImageWriter::EncodeExrDepth(depth->data(), width, height, bytes);
+				bool depthWritten = ImageWriter::WriteFile(depthFile, bytes);
+				written += depthWritten;
+				failed += !depthWritten;
+			}
+		}
+		std::chrono::duration<double> latency = std::chrono::high_resolution_clock::now() - captureTime;
+
+		std::lock_guard<std::mutex> lock(encodeMutex);
+		statistics.writtenFiles += written;
+		statistics.failedFiles += failed;
+		statistics.lastLatency = latency.count();
+		statistics.maxLatency = std::max(statistics.maxLatency, latency.count());
+		encodesInFlight--;
+		encodeDone.notify_all();
+	});
+}
+
+FrameCaptureStatistics FrameCapture::GetStatistics()
+{
+	std::lock_guard<std::mutex> lock(encodeMutex);
+	FrameCaptureStatistics current = statistics;
+	current.pendingFrames = busySlots + encodesInFlight;
+	return current;
+}
+
+void FrameCapture::ResetStatistics()
+{
+	std::lock_guard<std::mutex> lock(encodeMutex);
+	statistics = FrameCaptureStatistics{};
+}
@@ -0,0 +1,131 @@
+#include "FrameStatistics.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+
+FrameStatistics::FrameStatistics() :
+	nextFrame(0),
+	framesEnded(0),
+	frameStart(std::chrono::steady_clock::now())
+{
+	frames.reserve(FRAME_STATISTICS_HISTORY);
+}
+
+FrameStatistics& FrameStatistics::Get()
+{
+	static FrameStatistics statistics;
+	return statistics;
+}
+
+void FrameStatistics::EndFrame()
+{
+	auto now = std::chrono::steady_clock::now();
+	Frame frame = { std::chrono::duration<double>(now - frameStart).count(), current };
+	frameStart = now;
+
+	if (frames.size() < FRAME_STATISTICS_HISTORY)
+	{
+		frames.push_back(frame);
+	}
+	else
+	{
+		frames[nextFrame] = frame;
+	}
+	nextFrame = (nextFrame + 1) % FRAME_STATISTICS_HISTORY;
+	framesEnded++;
+
+	last = current;
+	current = FrameCounters();
+}
+
+void FrameStatistics::Reset()
+{
+	frames.clear();
+	nextFrame = 0;
+	framesEnded = 0;
+	current = FrameCounters();
+	frameStart = std::chrono::steady_clock::now();
+}
+
+FrameTimeSummary FrameStatistics::GetSummary() const
+{
+	FrameTimeSummary summary;
+	if (frames.empty())
+	{
+		return summary;
+	}
+
+	std::vector<double> times;
+	times.reserve(frames.size());
+	for (const Frame& frame : frames)
+	{
+		times.push_back(frame.seconds);
+	}
+	std::sort(times.begin(), times.end());
+
+	// Nearest rank: the smallest time that at least that fraction of the frames don't exceed
+	auto percentile = [&times](double fraction)
+	{
+		size_t rank = (size_t)std::ceil(fraction * times.size());
+		return times[std::max<size_t>(rank, 1) - 1];
+	};
+
+	double total = 0.0;
+	for (double time : times)
+	{
+		total += time;
+	}
+
+	summary.frames = times.size();
+	summary.mean = total / times.size();
+	summary.p50 = percentile(0.50);
+	summary.p95 = percentile(0.95);
+	summary.p99 = percentile(0.99);
+	summary.max = times.back();
+	return summary;
+}
+
+void FrameStatistics::GetFrameTimes(std::vector<float>& times) const
+{
+	times.clear();
+	forEachFrame([&times](const Frame& frame) { times.push_back((float)(frame.seconds * 1000.0)); });
+}
+
+void FrameStatistics::GetHistogram(std::vector<float>& buckets, double& maxSeconds) const
+{
+	buckets.assign(FRAME_STATISTICS_HISTOGRAM_BUCKETS, 0.0f);
+	maxSeconds = 0.0;
+	for (const Frame& frame : frames)
+	{
+		maxSeconds = std::max(maxSeconds, frame.seconds);
+	}
+	if (maxSeconds <= 0.0)
+	{
+		return;
+	}
+
+	for (const Frame& frame : frames)
+	{
+		int bucket = (int)(frame.seconds / maxSeconds * FRAME_STATISTICS_HISTOGRAM_BUCKETS);
+		buckets[std::min(bucket, FRAME_STATISTICS_HISTOGRAM_BUCKETS - 1)]++;
+	}
+}
+
+bool FrameStatistics::ExportCsv(const std::string& filePath) const
+{
+	std::ofstream file(filePath);
+	if (!file)
+	{
+		return false;
+	}
+
+	file << "frame,time_ms,draw_calls,triangles,shader_binds,texture_binds,uniform_uploads\n";
+	size_t number = framesEnded - frames.size();
+	forEachFrame([&file, &number](const Frame& frame)
+	{
+		const FrameCounters& counters = frame.counters;
+		file << number++ << "," << frame.seconds * 1000.0 << "," << counters.drawCalls << "," << counters.triangles << ","
+			<< counters.shaderBinds << "," << counters.textureBinds << "," << counters.uniformUploads << "\n";
+	});
+	return (bool)file;
+}
@@ -0,0 +1,122 @@
+#include "Frustum.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FRUSTUM_USE_SSE
+#include <xmmintrin.h>
+#endif
+
+Frustum::Frustum()
+{
+	// Accepts everything until it is built from a camera
+	for (int i = 0; i < 6; i++)
+	{
+		planes[i] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+	}
+}
+
+Frustum::Frustum(const glm::mat4& viewProjection)
+{
+	// glm matrices are column major, so row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++)
+	{
+		rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+	}
+
+	// Left, right, bottom, top, near, far (OpenGL clip space, -w <= z <= w)
+	planes[0] = rows[3] + rows[0];
+	planes[1] = rows[3] - rows[0];
+	planes[2] = rows[3] + rows[1];
+	planes[3] = rows[3] - rows[1];
+	planes[4] = rows[3] + rows[2];
+	planes[5] = rows[3] - rows[2];
+
+	// Normalized planes give real distances, which the sphere radii are compared against
+	for (int i = 0; i < 6; i++)
+	{
+		float length = glm::length(glm::vec3(planes[i]));
+		if (length > 0.0f)
+		{
+			planes[i] /= length;
+		}
+	}
+}
+
+bool Frustum::Intersects(const BoundingSphere& sphere) const
+{
+	for (int i = 0; i < 6; i++)
+	{
+		if (glm::dot(glm::vec3(planes[i]), sphere.center) + planes[i].w < -sphere.radius)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+size_t Frustum::cullRange(const SphereBatch& spheres, size_t first, std::vector<uint8_t>& visible) const
+{
+	size_t visibleCount = 0;
+	for (size_t i = first; i < spheres.Size(); i++)
+	{
+		BoundingSphere sphere;
+		sphere.center = glm::vec3(spheres.x[i], spheres.y[i], spheres.z[i]);
+		sphere.radius = spheres.radius[i];
+		visible[i] = Intersects(sphere) ? 1 : 0;
+		visibleCount += visible[i];
+	}
+	return visibleCount;
+}
+
+size_t Frustum::CullScalar(const SphereBatch& spheres, std::vector<uint8_t>& visible) const
+{
+	visible.resize(spheres.Size());
+	return cullRange(spheres, 0, visible);
+}
+
+size_t Frustum::Cull(const SphereBatch& spheres, std::vector<uint8_t>& visible) const
+{
+#ifdef FRUSTUM_USE_SSE
+	visible.resize(spheres.Size());
+
+	__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+	for (int i = 0; i < 6; i++)
+	{
+		planeX[i] = _mm_set1_ps(planes[i].x);
+		planeY[i] = _mm_set1_ps(planes[i].y);
+		planeZ[i] = _mm_set1_ps(planes[i].z);
+		planeW[i] = _mm_set1_ps(planes[i].w);
+	}
+
+	// Four spheres per iteration, each plane tested against all four at once
+	size_t visibleCount = 0;
+	size_t batchEnd = spheres.Size() & ~(size_t)3;
+	for (size_t i = 0; i < batchEnd; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(&spheres.x[i]);
+		__m128 y = _mm_loadu_ps(&spheres.y[i]);
+		__m128 z = _mm_loadu_ps(&spheres.z[i]);
+		__m128 negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&spheres.radius[i]));
+
+		__m128 outside = _mm_setzero_ps();
+		for (int p = 0; p < 6; p++)
+		{
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], x), _mm_mul_ps(planeY[p], y)),
+				_mm_add_ps(_mm_mul_ps(planeZ[p], z), planeW[p]));
+			outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negativeRadius));
+		}
+
+		int outsideMask = _mm_movemask_ps(outside);
+		for (int lane = 0; lane < 4; lane++)
+		{
+			visible[i + lane] = (outsideMask >> lane) & 1 ? 0 : 1;
+			visibleCount += visible[i + lane];
+		}
+	}
+
+	// The last (up to three) spheres
+	return visibleCount + cullRange(spheres, batchEnd, visible);
+#else
+	return CullScalar(spheres, visible);
+#endif
+}
@@ -0,0 +1,165 @@
+#include "GLStateCache.h"
+#include "FrameStatistics.h"
+
+GLStateCache::GLStateCache() :
+	program(0),
+	vao(0),
+	activeUnit(0),
+	polygonMode(GL_FILL),
+	depthTest(false),
+	depthMask(true),
+	depthFunc(GL_LESS)
+{
+	for (GLuint unit = 0; unit < STATE_CACHE_TEXTURE_UNITS; unit++)
+	{
+		textures[unit] = 0;
+	}
+	Invalidate();
+}
+
+GLStateCache& GLStateCache::Get()
+{
+	// Mirrors the bindings of the one context a process renders with (the window's or a HeadlessContext)
+	static GLStateCache cache;
+	return cache;
+}
+
+void GLStateCache::Invalidate()
+{
+	programKnown = false;
+	vaoKnown = false;
+	activeUnitKnown = false;
+	polygonModeKnown = false;
+	depthTestKnown = false;
+	depthMaskKnown = false;
+	depthFuncKnown = false;
+	for (GLuint unit = 0; unit < STATE_CACHE_TEXTURE_UNITS; unit++)
+	{
+		texturesKnown[unit] = false;
+	}
+}
+
+void GLStateCache::BeginFrame()
+{
+	frame = GLStateStatistics();
+
+	// Other code (ImGui) ran between the frames
+	Invalidate();
+}
+
+void GLStateCache::UseProgram(GLuint newProgram)
+{
+	if (change(program, newProgram, programKnown))
+	{
+		glUseProgram(newProgram);
+		FrameStatistics::Get().CountShaderBind();
+	}
+}
+
+void GLStateCache::BindVertexArray(GLuint newVao)
+{
+	if (change(vao, newVao, vaoKnown))
+	{
+		glBindVertexArray(newVao);
+	}
+}
+
+void GLStateCache::ActiveTexture(GLuint unit)
+{
+	if (change(activeUnit, unit, activeUnitKnown))
+	{
+		glActiveTexture(GL_TEXTURE0 + unit);
+	}
+}
+
+void GLStateCache::BindTexture(GLuint texture)
+{
+	if (!activeUnitKnown)
+	{
+		ActiveTexture(0);
+	}
+	BindTexture(activeUnit, texture);
+}
+
+void GLStateCache::BindTexture(GLuint unit, GLuint texture)
+{
+	if (unit >= STATE_CACHE_TEXTURE_UNITS) return;
+
+	// Skipping the glActiveTexture as well when the unit already has the texture
+	if (texturesKnown[unit] && textures[unit] == texture)
+	{
+		frame.skipped++;
+		return;
+	}
+
+	ActiveTexture(unit);
+	change(textures[unit], texture, texturesKnown[unit]);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	FrameStatistics::Get().CountTextureBind();
+}
+
+void GLStateCache::PolygonMode(GLenum mode)
+{
+	if (change(polygonMode, mode, polygonModeKnown))
+	{
+		glPolygonMode(GL_FRONT_AND_BACK, mode);
+	}
+}
+
+void GLStateCache::SetDepthTest(bool enabled)
+{
+	if (change(depthTest, enabled, depthTestKnown))
+	{
+		if (enabled) glEnable(GL_DEPTH_TEST);
+		else glDisable(GL_DEPTH_TEST);
+	}
+}
+
+void GLStateCache::SetDepthMask(bool enabled)
+{
+	if (change(depthMask, enabled, depthMaskKnown))
+	{
+		glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+	}
+}
+
+void GLStateCache::SetDepthFunc(GLenum function)
+{
+	if (change(depthFunc, function, depthFuncKnown))
+	{
+		glDepthFunc(function);
+	}
+}
+
+void GLStateCache::DeleteProgram(GLuint deletedProgram)
+{
+	if (deletedProgram == 0) return;
+
+	// A deleted program stays in use until another one is used, so the cached value is still right
+	glDeleteProgram(deletedProgram);
+}
+
+void GLStateCache::DeleteVertexArray(GLuint deletedVao)
+{
+	if (deletedVao == 0) return;
+
+	glDeleteVertexArrays(1, &deletedVao);
+	if (vao == deletedVao)
+	{
+		vao = 0;
+	}
+}
+
+void GLStateCache::DeleteTexture(GLuint deletedTexture)
+{
+	if (deletedTexture == 0) return;
+
+	glDeleteTextures(1, &deletedTexture);
+	for (GLuint unit = 0; unit < STATE_CACHE_TEXTURE_UNITS; unit++)
+	{
+		if (textures[unit] == deletedTexture)
+		{
+			textures[unit] = 0;
+		}
+	}
+}
@@ -0,0 +1,59 @@
+#include "GpuMesh.h"
+#include "VertexQuantizer.h"
+#include "GLStateCache.h"
+#include <cstdint>
+
+GpuMesh::GpuMesh(const MeshView& meshToUpload) :
+	vao(0),
+	vbo(0),
+	ebo(0)
+{
+	std::vector<uint16_t> shortIndices;
+	MeshView mesh = meshToUpload.WithShortIndices(shortIndices);
+
+	vertexCount = (GLsizei)mesh.vertexCount;
+	indexCount = (GLsizei)mesh.indexCount;
+	indexType = mesh.indexSize == sizeof(uint16_t) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+	vertexFormat = mesh.vertexFormat;
+	vertexDecoding = VertexQuantizer::GetDecoding(mesh.vertexFormat, mesh.minimums, mesh.maximums);
+	minimums = mesh.minimums;
+	maximums = mesh.maximums;
+	bufferBytes = mesh.GetVertexBytes() + mesh.GetIndexBytes();
+
+	for (size_t level = 0; level < mesh.GetLodCount(); level++)
+	{
+		lods.push_back(mesh.GetLod(level));
+	}
+
+	glGenVertexArrays(1, &vao);
+	glGenBuffers(1, &vbo);
+	glGenBuffers(1, &ebo);
+
+	GLStateCache::Get().BindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+	glBufferData(GL_ARRAY_BUFFER, mesh.GetVertexBytes(), mesh.vertices, GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.GetIndexBytes(), mesh.indices, GL_STATIC_DRAW);
+	AttachBuffers();
+
+	// unbind to make sure other code does not change it somewhere else
+	GLStateCache::Get().BindVertexArray(0);
+}
+
+GpuMesh::~GpuMesh()
+{
+	GLStateCache::Get().DeleteVertexArray(vao);
+	glDeleteBuffers(1, &vbo);
+	glDeleteBuffers(1, &ebo);
+}
+
+void GpuMesh::AttachBuffers() const
+{
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+	// Positions, normals and texture coordinates, in whatever format the vertices were stored
+	VertexQuantizer::SetupAttributes(vertexFormat);
+
+	// The element buffer binding is part of the vao state
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+}
@@ -0,0 +1,226 @@
+#include "Headless.h"
+#include "FrameCapture.h"
+#include "FrameStatistics.h"
+#include "GLStateCache.h"
+#include "HeadlessContext.h"
+#include "ImageWriter.h"
+#include "OffscreenTarget.h"
+#include "Profiler.h"
+#include "Renderer.h"
+#include "Scene.h"
+#include "TextureManager.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <numeric>
+#include <vector>
+
+int Headless::Run(int argc, char** argv)
+{
+	// The options of the run itself, all the others describe the scene
+	int frames = 1;
+	int warmupFrames = 0;
+	std::string traceFile;
+	std::string csvFile;
+	std::vector<std::string> sceneArguments;
+	for (int i = 0; i < argc; i++)
+	{
+		std::string argument = argv[i];
+		if (argument == "--help")
+		{
+			printUsage();
+			return 0;
+		}
+		else if (argument == "--frames" && i + 1 < argc)
+		{
+			frames = std::atoi(argv[++i]);
+		}
+		else if (argument == "--warmup" && i + 1 < argc)
+		{
+			warmupFrames = std::atoi(argv[++i]);
+		}
+		else if (argument == "--trace" && i + 1 < argc)
+		{
+			traceFile = argv[++i];
+		}
+		else if (argument == "--csv" && i + 1 < argc)
+		{
+			csvFile = argv[++i];
+		}
+		else
+		{
+			sceneArguments.push_back(argument);
+		}
+	}
+
+	SceneDescription description;
+	if (!description.Parse(sceneArguments) || frames < 1 || warmupFrames < 0)
+	{
+		printUsage();
+		return 1;
+	}
+
+	ImageWriter::Format format;
+	if (!description.outputFile.empty() && !ImageWriter::GetFormat(description.outputFile, format))
+	{
+		std::cerr << "Unknown image format '" << description.outputFile << "', use .png or .ppm" << std::endl;
+		return 1;
+	}
+	if (!description.depthOutputFile.empty() && !ImageWriter::IsExrFile(description.depthOutputFile))
+	{
+		std::cerr << "The depth is written as OpenEXR, '" << description.depthOutputFile << "' isn't an .exr file" << std::endl;
+		return 1;
+	}
+
+	HeadlessContext context;
+	if (!context.Create())
+	{
+		return 1;
+	}
+
+	return render(description, frames, warmupFrames, traceFile, csvFile);
+}
+
+void Headless::printUsage()
+{
+	std::cout << "Usage: MeshViewer --headless [--frames <count = 1>] [--warmup <count = 0>] [--trace <file.json>] [--csv <file.csv>] [scene options]" << std::endl;
+	std::cout << "  Renders offscreen, times every frame and writes the last one to --output and --depth-output" << std::endl;
+	std::cout << "  (every frame if the file name has %d, which becomes the frame number)." << std::endl;
+	std::cout << "  --trace writes the profiler's zones as a Chrome trace, --csv the time and draw counters of every frame." << std::endl;
+	SceneDescription::PrintOptions();
+}
+
+int Headless::render(const SceneDescription& description, int frames, int warmupFrames, const std::string& traceFile, const std::string& csvFile)
+{
+	OffscreenTarget target;
+	if (!target.Create(description.width, description.height))
+	{
+		return 1;
+	}
+	target.Bind();
+	GLStateCache::Get().SetDepthTest(true);
+
+	TextureManager::Get().SetAsyncLoading(false);
+
+	auto loadStart = std::chrono::high_resolution_clock::now();
+	Scene scene;
+	if (!description.Apply(scene))
+	{
+		return 1;
+	}
+	std::chrono::duration<double> loadElapsed = std::chrono::high_resolution_clock::now() - loadStart;
+	std::cout << "Loaded the scene in " << loadElapsed.count() * 1000.0 << " ms" << std::endl;
+
+	Renderer renderer(scene);
+	bool writeEveryFrame = description.outputFile.find("%d") != std::string::npos || description.depthOutputFile.find("%d") != std::string::npos;
+	bool writeFrames = !description.outputFile.empty() || !description.depthOutputFile.empty();
+	std::vector<double> renderTimes, frameTimes, gpuTimes;
+	Profiler& profiler = Profiler::Get();
+	FrameStatistics& frameStatistics = FrameStatistics::Get();
+
+	// A sequence must have every frame, so a capture waits for a buffer rather than being dropped
+	FrameCapture& capture = FrameCapture::Get();
+	capture.SetDropWhenBusy(false);
+	capture.ResetStatistics();
+	frameStatistics.Reset();
+	for (int frame = 0; frame < warmupFrames + frames; frame++)
+	{
+		// Render() is what the window's loop calls, glFinish adds the time the driver takes to draw it.
+		// The captures are read back and encoded in the background, only queueing them is part of the frame.
+		auto start = std::chrono::high_resolution_clock::now();
+		profiler.BeginFrame();
+		renderer.ClearBuffers();
+		renderer.Render();
+
+		int measuredFrame = frame - warmupFrames;
+		if (writeFrames && measuredFrame >= 0 && (writeEveryFrame || measuredFrame == frames - 1))
+		{
+			std::string colorFile = FrameCapture::GetFrameFilePath(description.outputFile, measuredFrame);
+			std::string depthFile = FrameCapture::GetFrameFilePath(description.depthOutputFile, measuredFrame);
+			capture.Capture(target.GetWidth(), target.GetHeight(), colorFile, depthFile);
+		}
+		capture.Update();
+		profiler.EndFrame();
+		glFinish();
+		std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+		// The frame times and counters are of the measured frames only
+		if (measuredFrame < 0)
+		{
+			frameStatistics.Reset();
+			continue;
+		}
+		frameStatistics.EndFrame();
+		renderTimes.push_back(profiler.GetCpuSeconds("Renderer::Render"));
+		frameTimes.push_back(elapsed.count());
+
+		// The GPU times come PROFILER_GPU_LATENCY frames late, the first ones may be of the warmup
+		if (!profiler.GetGpuFrame().empty())
+		{
+			gpuTimes.push_back(profiler.GetGpuSeconds("Renderer::Render"));
+		}
+	}
+
+	auto flushStart = std::chrono::high_resolution_clock::now();
+	capture.Flush();
+	std::chrono::duration<double> flushElapsed = std::chrono::high_resolution_clock::now() - flushStart;
+
+	auto printTimes = [](const char* name, std::vector<double>& times)
+	{
+		std::sort(times.begin(), times.end());
+		double mean = std::accumulate(times.begin(), times.end(), 0.0) / times.size();
+		std::cout << "  " << name << ": mean " << mean * 1000.0 << " ms, min " << times.front() * 1000.0
+			<< " ms, median " << times[times.size() / 2] * 1000.0 << " ms, max " << times.back() * 1000.0 << " ms" << std::endl;
+	};
+
+	double totalTime = std::accumulate(frameTimes.begin(), frameTimes.end(), 0.0);
+	std::cout << "Rendered " << frames << " frames of " << description.width << "x" << description.height
+		<< " (" << frames / totalTime << " frames/s)" << std::endl;
+	printTimes("Renderer::Render (CPU)", renderTimes);
+	printTimes("Frame (with glFinish)", frameTimes);
+	if (!gpuTimes.empty())
+	{
+		printTimes("Renderer::Render (GPU)", gpuTimes);
+	}
+	FrameTimeSummary summary = frameStatistics.GetSummary();
+	std::cout << "  Frame time percentiles: p50 " << summary.p50 * 1000.0 << " ms, p95 " << summary.p95 * 1000.0 << " ms, p99 "
+		<< summary.p99 * 1000.0 << " ms, max " << summary.max * 1000.0 << " ms" << std::endl;
+	const FrameCounters& counters = frameStatistics.GetLastCounters();
+	std::cout << "  Last frame: " << counters.drawCalls << " draw calls, " << counters.triangles << " triangles submitted, "
+		<< counters.shaderBinds << " shader binds, " << counters.textureBinds << " texture binds, " << counters.uniformUploads
+		<< " uniform uploads" << std::endl;
+	std::cout << "  Last frame: " << scene.GetDrawnTriangles() << " triangles, " << scene.GetVisibleModels() << " visible and "
+		<< scene.GetCulledModels() << " culled models, " << scene.GetIssuedStateChanges() << " state changes" << std::endl;
+
+	FrameCaptureStatistics captureStatistics = capture.GetStatistics();
+	if (writeFrames)
+	{
+		std::cout << "Wrote " << captureStatistics.writtenFiles << " files of " << captureStatistics.capturedFrames << " captured frames, "
+			<< flushElapsed.count() * 1000.0 << " ms after the last frame. Capture latency: last "
+			<< captureStatistics.lastLatency * 1000.0 << " ms, max " << captureStatistics.maxLatency * 1000.0 << " ms" << std::endl;
+	}
+	if (captureStatistics.failedFiles > 0)
+	{
+		std::cerr << "Could not write " << captureStatistics.failedFiles << " files" << std::endl;
+		return 1;
+	}
+	if (!csvFile.empty() && !frameStatistics.ExportCsv(csvFile))
+	{
+		std::cerr << "Could not write '" << csvFile << "'" << std::endl;
+		return 1;
+	}
+	if (!traceFile.empty() && !profiler.ExportChromeTrace(traceFile))
+	{
+		std::cerr << "Could not write the trace '" << traceFile << "'" << std::endl;
+		return 1;
+	}
+
+	GLenum error = glGetError();
+	if (error != GL_NO_ERROR)
+	{
+		std::cerr << "OpenGL error 0x" << std::hex << error << std::dec << std::endl;
+		return 1;
+	}
+	return 0;
+}
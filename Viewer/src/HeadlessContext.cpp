@@ -0,0 +1,113 @@
+#include "HeadlessContext.h"
+#include <glad/glad.h>
+#include <iostream>
+
+#ifdef MESHVIEWER_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+HeadlessContext::HeadlessContext() : display(nullptr), context(nullptr)
+{
+}
+
+HeadlessContext::~HeadlessContext()
+{
+	Destroy();
+}
+
+#ifdef MESHVIEWER_EGL
+
+bool HeadlessContext::Create()
+{
+	Destroy();
+
+	// A surfaceless display needs no X server or DRM device, the default display is the fallback
+	EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay != nullptr)
+	{
+		eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	}
+	if (eglDisplay == EGL_NO_DISPLAY)
+	{
+		eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+
+	EGLint major, minor;
+	if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, &major, &minor))
+	{
+		std::cerr << "Could not initialize an EGL display" << std::endl;
+		return false;
+	}
+	display = eglDisplay;
+
+	if (!eglBindAPI(EGL_OPENGL_API))
+	{
+		std::cerr << "EGL " << major << "." << minor << " does not support desktop OpenGL" << std::endl;
+		Destroy();
+		return false;
+	}
+
+	// The same version and profile as the window's context
+	const EGLint contextAttributes[] =
+	{
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 2,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+	EGLContext eglContext = eglCreateContext(eglDisplay, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttributes);
+	if (eglContext == EGL_NO_CONTEXT || !eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext))
+	{
+		std::cerr << "Could not create a surfaceless OpenGL 3.2 core context (EGL error 0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+		if (eglContext != EGL_NO_CONTEXT)
+		{
+			eglDestroyContext(eglDisplay, eglContext);
+		}
+		Destroy();
+		return false;
+	}
+	context = eglContext;
+
+	if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress))
+	{
+		std::cerr << "Could not load the OpenGL functions" << std::endl;
+		Destroy();
+		return false;
+	}
+
+	std::cout << "Headless OpenGL context: " << glGetString(GL_RENDERER) << ", " << glGetString(GL_VERSION) << std::endl;
+	return true;
+}
+
+void HeadlessContext::Destroy()
+{
+	if (display == nullptr)
+	{
+		return;
+	}
+
+	eglMakeCurrent((EGLDisplay)display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	if (context != nullptr)
+	{
+		eglDestroyContext((EGLDisplay)display, (EGLContext)context);
+	}
+	eglTerminate((EGLDisplay)display);
+	display = nullptr;
+	context = nullptr;
+}
+
+#else
+
+bool HeadlessContext::Create()
+{
+	std::cerr << "This build has no headless rendering, it needs EGL (Mesa on Linux)" << std::endl;
+	return false;
+}
+
+void HeadlessContext::Destroy()
+{
+}
+
+#endif
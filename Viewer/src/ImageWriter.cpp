@@ -0,0 +1,467 @@
+#include "ImageWriter.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// LZ77 parameters of the deflate compressor. Renders are mostly long runs and repeated rows, so a short
+// hash chain finds nearly all of the matches.
+static constexpr int DEFLATE_WINDOW_SIZE = 32768;
+static constexpr int DEFLATE_HASH_BITS = 15;
+static constexpr int DEFLATE_MAX_CHAIN = 32;
+static constexpr int DEFLATE_MIN_MATCH = 3;
+static constexpr int DEFLATE_MAX_MATCH = 258;
+
+static const int LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const int LENGTH_EXTRA_BITS[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const int DISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const int DISTANCE_EXTRA_BITS[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+// Deflate streams are written least significant bit first
+struct BitWriter
+{
+	std::vector<unsigned char>& output;
+	uint32_t buffer = 0;
+	int count = 0;
+
+	BitWriter(std::vector<unsigned char>& output) : output(output) {}
+
+	void Write(uint32_t bits, int length)
+	{
+		buffer |= bits << count;
+		count += length;
+		while (count >= 8)
+		{
+			output.push_back((unsigned char)(buffer & 0xFF));
+			buffer >>= 8;
+			count -= 8;
+		}
+	}
+
+	void Flush()
+	{
+		if (count > 0)
+		{
+			output.push_back((unsigned char)(buffer & 0xFF));
+		}
+		buffer = 0;
+		count = 0;
+	}
+};
+
+// Huffman codes are the only part of deflate stored most significant bit first
+static uint32_t reverseBits(uint32_t code, int length)
+{
+	uint32_t reversed = 0;
+	for (int i = 0; i < length; i++)
+	{
+		reversed = (reversed << 1) | (code & 1);
+		code >>= 1;
+	}
+	return reversed;
+}
+
+// The fixed Huffman code of a literal/length symbol (RFC 1951, 3.2.6)
+static void writeLiteralLength(BitWriter& writer, int symbol)
+{
+	if (symbol <= 143)      writer.Write(reverseBits(0x30 + symbol, 8), 8);
+	else if (symbol <= 255) writer.Write(reverseBits(0x190 + symbol - 144, 9), 9);
+	else if (symbol <= 279) writer.Write(reverseBits(symbol - 256, 7), 7);
+	else                    writer.Write(reverseBits(0xC0 + symbol - 280, 8), 8);
+}
+
+static void writeMatch(BitWriter& writer, int length, int distance)
+{
+	int lengthCode = 0;
+	while (lengthCode < 28 && LENGTH_BASE[lengthCode + 1] <= length) lengthCode++;
+	writeLiteralLength(writer, 257 + lengthCode);
+	writer.Write(length - LENGTH_BASE[lengthCode], LENGTH_EXTRA_BITS[lengthCode]);
+
+	int distanceCode = 0;
+	while (distanceCode < 29 && DISTANCE_BASE[distanceCode + 1] <= distance) distanceCode++;
+	writer.Write(reverseBits(distanceCode, 5), 5);
+	writer.Write(distance - DISTANCE_BASE[distanceCode], DISTANCE_EXTRA_BITS[distanceCode]);
+}
+
+static uint32_t hashBytes3(const unsigned char* bytes)
+{
+	uint32_t value = ((uint32_t)bytes[0] << 16) | ((uint32_t)bytes[1] << 8) | bytes[2];
+	return (value * 2654435761u) >> (32 - DEFLATE_HASH_BITS);
+}
+
+// One block with the fixed Huffman codes, which is close to dynamic codes on the filtered rows of a render
+// and much simpler
+static void deflate(const unsigned char* data, size_t size, std::vector<unsigned char>& output)
+{
+	BitWriter writer(output);
+	writer.Write(1, 1); // Last block
+	writer.Write(1, 2); // Fixed Huffman codes
+
+	// Most recent position of every hash, and the previous position with the same hash of every position in the window
+	std::vector<int64_t> head((size_t)1 << DEFLATE_HASH_BITS, -1);
+	std::vector<int64_t> previous(DEFLATE_WINDOW_SIZE, -1);
+	auto insert = [&](size_t position)
+	{
+		uint32_t hash = hashBytes3(data + position);
+		previous[position % DEFLATE_WINDOW_SIZE] = head[hash];
+		head[hash] = (int64_t)position;
+	};
+
+	size_t position = 0;
+	while (position < size)
+	{
+		int bestLength = 0;
+		int bestDistance = 0;
+		if (position + DEFLATE_MIN_MATCH <= size)
+		{
+			int maxLength = (int)std::min<size_t>(DEFLATE_MAX_MATCH, size - position);
+			int64_t candidate = head[hashBytes3(data + position)];
+			for (int chain = 0; chain < DEFLATE_MAX_CHAIN && candidate >= 0 && (int64_t)position - candidate <= DEFLATE_WINDOW_SIZE; chain++)
+			{
+				int length = 0;
+				while (length < maxLength && data[candidate + length] == data[position + length]) length++;
+				if (length > bestLength)
+				{
+					bestLength = length;
+					bestDistance = (int)(position - candidate);
+					if (length == maxLength) break;
+				}
+
+				// The slot may already hold a newer position, the chain ends there
+				int64_t next = previous[candidate % DEFLATE_WINDOW_SIZE];
+				if (next >= candidate) break;
+				candidate = next;
+			}
+			insert(position);
+		}
+
+		if (bestLength >= DEFLATE_MIN_MATCH)
+		{
+			writeMatch(writer, bestLength, bestDistance);
+			for (size_t skipped = position + 1; skipped < position + bestLength && skipped + DEFLATE_MIN_MATCH <= size; skipped++)
+			{
+				insert(skipped);
+			}
+			position += bestLength;
+		}
+		else
+		{
+			writeLiteralLength(writer, data[position]);
+			position++;
+		}
+	}
+
+	writeLiteralLength(writer, 256); // End of block
+	writer.Flush();
+}
+
+static uint32_t adler32(const unsigned char* data, size_t size)
+{
+	uint32_t a = 1, b = 0;
+	while (size > 0)
+	{
+		// The largest run that can't overflow before the modulo
+		size_t run = std::min<size_t>(size, 5552);
+		for (size_t i = 0; i < run; i++)
+		{
+			a += data[i];
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+		data += run;
+		size -= run;
+	}
+	return (b << 16) | a;
+}
+
+static uint32_t crc32(const unsigned char* data, size_t size, uint32_t crc = 0)
+{
+	struct CrcTable
+	{
+		uint32_t values[256];
+
+		CrcTable()
+		{
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				uint32_t value = i;
+				for (int bit = 0; bit < 8; bit++)
+				{
+					value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+				}
+				values[i] = value;
+			}
+		}
+	};
+	static const CrcTable table;
+
+	crc = ~crc;
+	for (size_t i = 0; i < size; i++)
+	{
+		crc = table.values[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	}
+	return ~crc;
+}
+
+static void appendBigEndian(std::vector<unsigned char>& output, uint32_t value)
+{
+	output.push_back((unsigned char)(value >> 24));
+	output.push_back((unsigned char)(value >> 16));
+	output.push_back((unsigned char)(value >> 8));
+	output.push_back((unsigned char)value);
+}
+
+static void appendChunk(std::vector<unsigned char>& output, const char type[5], const std::vector<unsigned char>& data)
+{
+	appendBigEndian(output, (uint32_t)data.size());
+	size_t typeStart = output.size();
+	output.insert(output.end(), type, type + 4);
+	output.insert(output.end(), data.begin(), data.end());
+	appendBigEndian(output, crc32(output.data() + typeStart, output.size() - typeStart));
+}
+
+static void appendLittleEndian(std::vector<unsigned char>& output, uint64_t value, int bytes)
+{
+	for (int i = 0; i < bytes; i++)
+	{
+		output.push_back((unsigned char)(value >> (8 * i)));
+	}
+}
+
+static void appendFloat(std::vector<unsigned char>& output, float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	appendLittleEndian(output, bits, 4);
+}
+
+// An OpenEXR header attribute: name, type, size of the value, then the value
+static void appendExrAttribute(std::vector<unsigned char>& output, const char* name, const char* type, const std::vector<unsigned char>& value)
+{
+	output.insert(output.end(), name, name + std::strlen(name) + 1);
+	output.insert(output.end(), type, type + std::strlen(type) + 1);
+	appendLittleEndian(output, value.size(), 4);
+	output.insert(output.end(), value.begin(), value.end());
+}
+
+static int paethPredictor(int left, int up, int upLeft)
+{
+	int estimate = left + up - upLeft;
+	int distanceLeft = std::abs(estimate - left);
+	int distanceUp = std::abs(estimate - up);
+	int distanceUpLeft = std::abs(estimate - upLeft);
+	if (distanceLeft <= distanceUp && distanceLeft <= distanceUpLeft) return left;
+	if (distanceUp <= distanceUpLeft) return up;
+	return upLeft;
+}
+
+bool ImageWriter::GetFormat(const std::string& filePath, Format& format)
+{
+	size_t dot = filePath.find_last_of('.');
+	if (dot == std::string::npos) return false;
+
+	std::string extension = filePath.substr(dot + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+	if (extension == "png")
+	{
+		format = Format::Png;
+		return true;
+	}
+	if (extension == "ppm")
+	{
+		format = Format::Ppm;
+		return true;
+	}
+	return false;
+}
+
+void ImageWriter::Encode(Format format, const unsigned char* rgba, int width, int height, std::vector<unsigned char>& output)
+{
+	switch (format)
+	{
+	case Format::Png:
+		encodePng(rgba, width, height, output);
+		return;
+	case Format::Ppm:
+		encodePpm(rgba, width, height, output);
+		return;
+	}
+}
+
+bool ImageWriter::IsExrFile(const std::string& filePath)
+{
+	size_t dot = filePath.find_last_of('.');
+	if (dot == std::string::npos) return false;
+
+	std::string extension = filePath.substr(dot + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+	return extension == "exr";
+}
+
+void ImageWriter::EncodeExrDepth(const float* depth, int width, int height, std::vector<unsigned char>& output)
+{
+	static const unsigned char EXR_MAGIC[4] = { 0x76, 0x2F, 0x31, 0x01 };
+
+	output.clear();
+	output.insert(output.end(), EXR_MAGIC, EXR_MAGIC + sizeof(EXR_MAGIC));
+	appendLittleEndian(output, 2, 4); // Version 2, single part scan lines
+
+	// One channel: name, FLOAT pixels, not linear, 3 reserved bytes, x and y sampling, then the list's end
+	std::vector<unsigned char> channels = { 'Z', 0 };
+	appendLittleEndian(channels, 2, 4);
+	appendLittleEndian(channels, 0, 4);
+	appendLittleEndian(channels, 1, 4);
+	appendLittleEndian(channels, 1, 4);
+	channels.push_back(0);
+
+	std::vector<unsigned char> window;
+	appendLittleEndian(window, 0, 4);
+	appendLittleEndian(window, 0, 4);
+	appendLittleEndian(window, (uint32_t)(width - 1), 4);
+	appendLittleEndian(window, (uint32_t)(height - 1), 4);
+
+	std::vector<unsigned char> one, center;
+	appendFloat(one, 1.0f);
+	appendFloat(center, 0.0f);
+	appendFloat(center, 0.0f);
+
+	appendExrAttribute(output, "channels", "chlist", channels);
+	appendExrAttribute(output, "compression", "compression", { 0 }); // None
+	appendExrAttribute(output, "dataWindow", "box2i", window);
+	appendExrAttribute(output, "displayWindow", "box2i", window);
+	appendExrAttribute(output, "lineOrder", "lineOrder", { 0 });     // Increasing y, top row first
+	appendExrAttribute(output, "pixelAspectRatio", "float", one);
+	appendExrAttribute(output, "screenWindowCenter", "v2f", center);
+	appendExrAttribute(output, "screenWindowWidth", "float", one);
+	output.push_back(0);
+
+	// The offset table, then one block per row: its y, its size and the floats
+	size_t rowBytes = (size_t)width * sizeof(float);
+	size_t firstRow = output.size() + (size_t)height * sizeof(uint64_t);
+	output.reserve(firstRow + (rowBytes + 8) * height);
+	for (int y = 0; y < height; y++)
+	{
+		appendLittleEndian(output, firstRow + (rowBytes + 8) * y, 8);
+	}
+	for (int y = 0; y < height; y++)
+	{
+		appendLittleEndian(output, (uint32_t)y, 4);
+		appendLittleEndian(output, rowBytes, 4);
+		for (int x = 0; x < width; x++)
+		{
+			appendFloat(output, depth[(size_t)y * width + x]);
+		}
+	}
+}
+
+void ImageWriter::encodePng(const unsigned char* rgba, int width, int height, std::vector<unsigned char>& output)
+{
+	static const unsigned char PNG_SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+	// Every row is RGB after a filter type byte. The filter of a row is the one whose output has the
+	// smallest sum of absolute values (the heuristic the PNG specification recommends).
+	size_t rowBytes = (size_t)width * 3;
+	std::vector<unsigned char> filtered((rowBytes + 1) * height);
+	std::vector<unsigned char> row(rowBytes), previousRow(rowBytes, 0), candidate(rowBytes);
+	for (int y = 0; y < height; y++)
+	{
+		const unsigned char* source = rgba + (size_t)y * width * 4;
+		for (int x = 0; x < width; x++)
+		{
+			std::memcpy(&row[x * 3], source + x * 4, 3);
+		}
+
+		unsigned char* destination = &filtered[y * (rowBytes + 1)];
+		unsigned long bestSum = ~0ul;
+		for (int filter = 0; filter <= 4; filter++)
+		{
+			unsigned long sum = 0;
+			for (size_t i = 0; i < rowBytes; i++)
+			{
+				int left = i >= 3 ? row[i - 3] : 0;
+				int up = previousRow[i];
+				int upLeft = i >= 3 ? previousRow[i - 3] : 0;
+				int prediction = 0;
+				switch (filter)
+				{
+				case 1: prediction = left; break;
+				case 2: prediction = up; break;
+				case 3: prediction = (left + up) / 2; break;
+				case 4: prediction = paethPredictor(left, up, upLeft); break;
+				}
+				candidate[i] = (unsigned char)(row[i] - prediction);
+				sum += std::abs((int)(signed char)candidate[i]);
+			}
+			if (sum < bestSum)
+			{
+				bestSum = sum;
+				destination[0] = (unsigned char)filter;
+				std::memcpy(destination + 1, candidate.data(), rowBytes);
+			}
+		}
+		std::swap(row, previousRow);
+	}
+
+	std::vector<unsigned char> header;
+	appendBigEndian(header, (uint32_t)width);
+	appendBigEndian(header, (uint32_t)height);
+	header.push_back(8); // Bits per channel
+	header.push_back(2); // RGB
+	header.push_back(0); // Deflate
+	header.push_back(0); // Adaptive filtering
+	header.push_back(0); // Not interlaced
+
+	// zlib stream: header (deflate, 32K window), the data, then its Adler-32
+	std::vector<unsigned char> compressed = { 0x78, 0x01 };
+	compressed.reserve(filtered.size() / 4);
+	deflate(filtered.data(), filtered.size(), compressed);
+	appendBigEndian(compressed, adler32(filtered.data(), filtered.size()));
+
+	output.clear();
+	output.insert(output.end(), PNG_SIGNATURE, PNG_SIGNATURE + sizeof(PNG_SIGNATURE));
+	appendChunk(output, "IHDR", header);
+	appendChunk(output, "IDAT", compressed);
+	appendChunk(output, "IEND", std::vector<unsigned char>());
+}
+
+void ImageWriter::encodePpm(const unsigned char* rgba, int width, int height, std::vector<unsigned char>& output)
+{
+	char header[64];
+	int headerLength = snprintf(header, sizeof(header), "P6\n%d %d\n255\n", width, height);
+
+	output.resize(headerLength + (size_t)width * height * 3);
+	std::memcpy(output.data(), header, headerLength);
+	unsigned char* destination = output.data() + headerLength;
+	for (size_t i = 0; i < (size_t)width * height; i++)
+	{
+		std::memcpy(destination + i * 3, rgba + i * 4, 3);
+	}
+}
+
+bool ImageWriter::Write(const std::string& filePath, const unsigned char* rgba, int width, int height)
+{
+	Format format;
+	if (!GetFormat(filePath, format))
+	{
+		return false;
+	}
+
+	std::vector<unsigned char> bytes;
+	Encode(format, rgba, width, height, bytes);
+	return WriteFile(filePath, bytes);
+}
+
+bool ImageWriter::WriteFile(const std::string& filePath, const std::vector<unsigned char>& bytes)
+{
+	FILE* output = std::fopen(filePath.c_str(), "wb");
+	if (output == nullptr)
+	{
+		return false;
+	}
+
+	bool written = bytes.empty() || std::fwrite(bytes.data(), bytes.size(), 1, output) == 1;
+	return std::fclose(output) == 0 && written;
+}
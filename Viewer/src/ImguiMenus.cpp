@@ -5,12 +5,22 @@
 #include "MeshModel.h"
 #include "Camera.h"
 #include "Utils.h"
+#include "MeshAssetCache.h"
+#include "TextureManager.h"
+#include "TextureStreamer.h"
+#include "FrameCapture.h"
+#include "Profiler.h"
+#include "FrameStatistics.h"
 #include "IDirectional.h"
+#include <algorithm>
+#include <cfloat>
 #include <cmath>
+#include <cstring>
 #include <memory>
 #include <stdio.h>
 #include <string>
 #include <sstream>
+#include <vector>
 #include <stdlib.h>
 #include <nfd.h>
 #include <random>
@@ -39,6 +49,16 @@ static bool showNormals =				  false;
 // World
 float worldRadius = 5.0f;
 
+// Recording, "%d" becomes the frame number
+static char recordColorPattern[256] = "capture_%d.png";
+static char recordDepthPattern[256] = "";
+
+// Profiler
+static char traceFile[256] = "trace.json";
+static char frameStatisticsFile[256] = "frames.csv";
+static std::vector<float> frameTimes;
+static std::vector<float> frameTimeHistogram;
+
 void DrawMenus(ImGuiIO& io, Scene& scene)
 {
 	ImGui::ShowDemoWindow();
@@ -49,17 +69,27 @@ void DrawMenus(ImGuiIO& io, Scene& scene)
 	
 	if (ImGui::Button("Add Banana"))
 	{	
-		scene.AddModel(Utils::LoadMeshModel("C:\\Users\\aagami\\Documents\\project-de-west-denya-massiv\\Data\\banana.obj"));
+		scene.AddModel(Utils::LoadMeshModel(Utils::GetDataFilePath("obj_examples/banana.obj")));
 	}
 	ImGui::SameLine();
 	if (ImGui::Button("Add Crate"))
 	{
-		scene.AddModel(Utils::LoadMeshModel("C:\\Users\\aagami\\Documents\\project-de-west-denya-massiv\\Data\\crate.obj"));
+		scene.AddModel(Utils::LoadMeshModel(Utils::GetDataFilePath("crate.obj")));
 	}
 	ImGui::SameLine();
 	if (ImGui::Button("Add Cow"))
 	{
-		scene.AddModel(Utils::LoadMeshModel("C:\\Users\\aagami\\Documents\\project-de-west-denya-massiv\\Data\\cow.obj"));
+		scene.AddModel(Utils::LoadMeshModel(Utils::GetDataFilePath("obj_examples/cow.obj")));
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("Add Culling Benchmark"))
+	{
+		scene.AddCullingBenchmark();
+	}
+	ImGui::SameLine();
+	if (ImGui::Button("Add Instanced Cows"))
+	{
+		scene.AddInstancingBenchmark(Utils::LoadMeshModel(Utils::GetDataFilePath("obj_examples/cow.obj")));
 	}
 
 	if (ImGui::CollapsingHeader("General"))
@@ -72,6 +102,9 @@ void DrawMenus(ImGuiIO& io, Scene& scene)
 		bool toonShading = scene.GetToonShading();
 		bool bumpMapping = scene.GetUseBumpMapping();
 		int toonShadingLevels = scene.GetToonShadingLevels();
+		bool useLevelOfDetail = scene.GetUseLevelOfDetail();
+		float lodPixelError = scene.GetLodPixelError();
+		bool useFrustumCulling = scene.GetUseFrustumCulling();
 
 		ImGui::Checkbox("Show axis", &drawAxis);
 		ImGui::Checkbox("Show demo triangles", &demoTriangle);
@@ -86,12 +119,127 @@ void DrawMenus(ImGuiIO& io, Scene& scene)
 		// Bump Mapping
 		ImGui::Checkbox("Bump Mapping", &bumpMapping);
 
+		// Level of detail
+		ImGui::Checkbox("Level of detail", &useLevelOfDetail);
+		ImGui::SameLine();
+		ImGui::SliderFloat("Max error (pixels)", &lodPixelError, 0.25f, 8.0f);
+
+		// Culling
+		ImGui::Checkbox("Frustum culling", &useFrustumCulling);
+
 		ImGui::ColorEdit3("Background color", (float*)&clearColor, ImGuiColorEditFlags_NoInputs);
 		ImGui::SliderFloat("World Radius", &worldRadius, 0.1f, 10.0f);
-		// Execution stats
-		ImGui::Text("ImGui render execution time: %.3f", scene.GetImGuiRenderExecutionTime());
-		ImGui::Text("Color buffer clearing execution time: %.3f", scene.GetColorBufferExecutionTime());
-		ImGui::Text("Render execution time: %.3f", scene.GetRenderExecutionTime());
+		// Execution stats, the zones of the last frame. The GPU times are a few frames older.
+		Profiler& profiler = Profiler::Get();
+		bool profiling = profiler.IsEnabled();
+		if (ImGui::Checkbox("Profile frames", &profiling))
+		{
+			profiler.SetEnabled(profiling);
+		}
+		if (profiling && ImGui::TreeNode("Frame profile"))
+		{
+			const std::vector<ProfilerZoneTime>& gpuZones = profiler.GetGpuFrame();
+			for (const ProfilerZoneTime& zone : profiler.GetCpuFrame())
+			{
+				auto gpuZone = std::find_if(gpuZones.begin(), gpuZones.end(), [&zone](const ProfilerZoneTime& gpuZone)
+				{
+					return gpuZone.depth == zone.depth && std::strcmp(gpuZone.name, zone.name) == 0;
+				});
+				int indent = (int)zone.depth * 2;
+				if (gpuZone != gpuZones.end())
+				{
+					ImGui::Text("%*s%s: %.3f ms CPU, %.3f ms GPU (%u)", indent, "", zone.name, zone.seconds * 1000.0, gpuZone->seconds * 1000.0, zone.calls);
+				}
+				else
+				{
+					ImGui::Text("%*s%s: %.3f ms CPU (%u)", indent, "", zone.name, zone.seconds * 1000.0, zone.calls);
+				}
+			}
+			if (!profiler.HasGpuTimer())
+			{
+				ImGui::Text("No GPU times, the driver has no timestamp queries");
+			}
+
+			ImGui::InputText("Trace file", traceFile, sizeof(traceFile));
+			if (ImGui::Button("Export Chrome trace") && !profiler.ExportChromeTrace(traceFile))
+			{
+				fprintf(stderr, "Could not write the trace '%s'\n", traceFile);
+			}
+			ImGui::TreePop();
+		}
+
+		// Frame times: the slow frames matter more than the average
+		FrameStatistics& frameStatistics = FrameStatistics::Get();
+		if (ImGui::TreeNode("Frame times"))
+		{
+			FrameTimeSummary summary = frameStatistics.GetSummary();
+			ImGui::Text("Last %zu frames: mean %.2f ms, p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, max %.2f ms", summary.frames,
+				summary.mean * 1000.0, summary.p50 * 1000.0, summary.p95 * 1000.0, summary.p99 * 1000.0, summary.max * 1000.0);
+
+			frameStatistics.GetFrameTimes(frameTimes);
+			if (!frameTimes.empty())
+			{
+				ImGui::PlotLines("Frame time (ms)", frameTimes.data(), (int)frameTimes.size(), 0, nullptr, 0.0f, (float)(summary.max * 1000.0), ImVec2(0, 60));
+			}
+			double histogramMax;
+			frameStatistics.GetHistogram(frameTimeHistogram, histogramMax);
+			std::string histogramRange = "0 - " + std::to_string((int)std::ceil(histogramMax * 1000.0)) + " ms";
+			ImGui::PlotHistogram("Frames per time", frameTimeHistogram.data(), (int)frameTimeHistogram.size(), 0, histogramRange.c_str(), 0.0f, FLT_MAX, ImVec2(0, 60));
+
+			const FrameCounters& counters = frameStatistics.GetLastCounters();
+			ImGui::Text("Last frame: %zu draw calls, %zu triangles submitted", counters.drawCalls, counters.triangles);
+			ImGui::Text("%zu shader binds, %zu texture binds, %zu uniform uploads", counters.shaderBinds, counters.textureBinds, counters.uniformUploads);
+
+			ImGui::InputText("CSV file", frameStatisticsFile, sizeof(frameStatisticsFile));
+			if (ImGui::Button("Export frames") && !frameStatistics.ExportCsv(frameStatisticsFile))
+			{
+				fprintf(stderr, "Could not write '%s'\n", frameStatisticsFile);
+			}
+			ImGui::SameLine();
+			if (ImGui::Button("Reset"))
+			{
+				frameStatistics.Reset();
+			}
+			ImGui::TreePop();
+		}
+		ImGui::Text("Triangles: %zu drawn, %zu saved by level of detail", scene.GetDrawnTriangles(), scene.GetLodSavedTriangles());
+		ImGui::Text("Models: %zu visible, %zu culled", scene.GetVisibleModels(), scene.GetCulledModels());
+		ImGui::Text("GL state changes: %zu issued, %zu skipped", scene.GetIssuedStateChanges(), scene.GetSkippedStateChanges());
+		MeshAssetCache& meshAssets = MeshAssetCache::Get();
+		ImGui::Text("Resident meshes: %zu (%.2f MB), %zu loads shared", meshAssets.GetResidentMeshes(),
+			meshAssets.GetResidentBytes() / (1024.0 * 1024.0), meshAssets.GetSharedLoads());
+		TextureManager& textures = TextureManager::Get();
+		ImGui::Text("Resident textures: %zu (%.2f MB, %zu unused), %zu loads shared, %zu streaming", textures.GetResidentTextures(),
+			textures.GetResidentBytes() / (1024.0 * 1024.0), textures.GetUnusedTextures(), textures.GetSharedLoads(),
+			TextureStreamer::Get().GetPendingTextures());
+		bool asyncTextures = textures.GetAsyncLoading();
+		if (ImGui::Checkbox("Stream textures in the background", &asyncTextures))
+		{
+			textures.SetAsyncLoading(asyncTextures);
+		}
+		int textureBudget = (int)(textures.GetMemoryBudget() / (1024 * 1024));
+		if (ImGui::SliderInt("Texture budget (MB)", &textureBudget, 0, 2048))
+		{
+			textures.SetMemoryBudget((size_t)textureBudget * 1024 * 1024);
+		}
+
+		// Recording
+		FrameCapture& capture = FrameCapture::Get();
+		ImGui::InputText("Record frames", recordColorPattern, sizeof(recordColorPattern));
+		ImGui::InputText("Record depth (.exr)", recordDepthPattern, sizeof(recordDepthPattern));
+		if (!capture.IsRecording() && ImGui::Button("Start recording"))
+		{
+			capture.ResetStatistics();
+			capture.StartRecording(recordColorPattern, recordDepthPattern);
+		}
+		else if (capture.IsRecording() && ImGui::Button("Stop recording"))
+		{
+			capture.StopRecording();
+		}
+		FrameCaptureStatistics captureStatistics = capture.GetStatistics();
+		ImGui::Text("Captured frames: %zu (%zu dropped, %zu pending), %zu files written, %zu failed", captureStatistics.capturedFrames,
+			captureStatistics.droppedFrames, captureStatistics.pendingFrames, captureStatistics.writtenFiles, captureStatistics.failedFiles);
+		ImGui::Text("Capture latency: %.1f ms (max %.1f ms)", captureStatistics.lastLatency * 1000.0, captureStatistics.maxLatency * 1000.0);
 
 		scene.SetDrawAxis(drawAxis);
 		scene.SetDemoTriangles(demoTriangle);
@@ -101,6 +249,9 @@ void DrawMenus(ImGuiIO& io, Scene& scene)
 		scene.SetToonShading(toonShading);
 		scene.SetToonShadingLevels(toonShadingLevels);
 		scene.SetUseBumpMapping(bumpMapping);
+		scene.SetUseLevelOfDetail(useLevelOfDetail);
+		scene.SetLodPixelError(lodPixelError);
+		scene.SetUseFrustumCulling(useFrustumCulling);
 	}
 
 	if (ImGui::CollapsingHeader("Transformation Matrices"))
@@ -420,6 +571,12 @@ void ShowModelControls(ImGuiIO& io, Scene& scene)
 	ImGui::Text("x: %.2f y: %.2f z: %.2f", activeModelTranslationVector.x, activeModelTranslationVector.y, activeModelTranslationVector.z);
 	activeModel->SetAmbientColor(color);
 	scene.SetActiveModelIndex(selectedModelIndex);
+
+	// Its GPU mesh stays resident while other models still use it
+	if (ImGui::Button("Remove Model"))
+	{
+		scene.RemoveActiveModel();
+	}
 }
 
 void ShowShaderControls(ImGuiIO& io, Scene& scene)
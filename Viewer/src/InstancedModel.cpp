@@ -0,0 +1,92 @@
+#include "InstancedModel.h"
+#include "GLStateCache.h"
+#include <cstddef>
+
+InstancedModel::InstancedModel(MeshModel* mesh) :
+	mesh(mesh),
+	vao(0),
+	instanceBuffer(0)
+{
+	glGenVertexArrays(1, &vao);
+	glGenBuffers(1, &instanceBuffer);
+
+	GLStateCache::Get().BindVertexArray(vao);
+	mesh->AttachBuffers();
+
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	setInstanceAttributes(0);
+	for (GLuint location = INSTANCE_TRANSFORM_LOCATION; location <= INSTANCE_SHININESS_LOCATION; location++)
+	{
+		glEnableVertexAttribArray(location);
+		glVertexAttribDivisor(location, 1);
+	}
+
+	GLStateCache::Get().BindVertexArray(0);
+}
+
+InstancedModel::~InstancedModel()
+{
+	GLStateCache::Get().DeleteVertexArray(vao);
+	glDeleteBuffers(1, &instanceBuffer);
+}
+
+size_t InstancedModel::AddInstance(const glm::mat4& transform, const Material& material)
+{
+	instances.push_back(InstanceData());
+	worldSpheres.Add(BoundingSphere());
+	instanceLods.push_back(0);
+
+	size_t index = instances.size() - 1;
+	SetInstanceTransform(index, transform);
+	SetInstanceMaterial(index, material);
+	return index;
+}
+
+void InstancedModel::SetInstanceTransform(size_t index, const glm::mat4& transform)
+{
+	instances[index].transform = transform;
+
+	BoundingSphere sphere = mesh->GetBoundingSphere().Transformed(transform);
+	worldSpheres.x[index] = sphere.center.x;
+	worldSpheres.y[index] = sphere.center.y;
+	worldSpheres.z[index] = sphere.center.z;
+	worldSpheres.radius[index] = sphere.radius;
+}
+
+void InstancedModel::SetInstanceMaterial(size_t index, const Material& material)
+{
+	InstanceData& instance = instances[index];
+	instance.ambiantColor = material.GetAmbientColor();
+	instance.diffuseColor = material.GetDiffuseColor();
+	instance.specularColor = material.GetSpecularColor();
+	instance.shininess = material.GetShininess();
+}
+
+void InstancedModel::UploadInstances(const InstanceData* data, size_t count)
+{
+	// A new store every time, so the driver doesn't wait for the previous frame's draws to finish reading it
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, count * sizeof(InstanceData), data, GL_STREAM_DRAW);
+}
+
+void InstancedModel::SetFirstInstance(size_t first)
+{
+	// glDrawElementsInstancedBaseInstance needs OpenGL 4.2, moving the attributes works everywhere
+	GLStateCache::Get().BindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+	setInstanceAttributes(first * sizeof(InstanceData));
+}
+
+void InstancedModel::setInstanceAttributes(size_t offset)
+{
+	GLsizei stride = (GLsizei)sizeof(InstanceData);
+	for (GLuint column = 0; column < 4; column++)
+	{
+		glVertexAttribPointer(INSTANCE_TRANSFORM_LOCATION + column, 4, GL_FLOAT, GL_FALSE, stride,
+			(GLvoid*)(offset + offsetof(InstanceData, transform) + column * sizeof(glm::vec4)));
+	}
+	glVertexAttribPointer(INSTANCE_AMBIANT_COLOR_LOCATION, 4, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(offset + offsetof(InstanceData, ambiantColor)));
+	glVertexAttribPointer(INSTANCE_DIFFUSE_COLOR_LOCATION, 4, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(offset + offsetof(InstanceData, diffuseColor)));
+	glVertexAttribPointer(INSTANCE_SPECULAR_COLOR_LOCATION, 4, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(offset + offsetof(InstanceData, specularColor)));
+	glVertexAttribPointer(INSTANCE_SHININESS_LOCATION, 1, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(offset + offsetof(InstanceData, shininess)));
+}
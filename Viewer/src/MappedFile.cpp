@@ -0,0 +1,147 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// An empty file can't be mapped, but it is still a valid (empty) file.
+static const char emptyFileData[1] = { 0 };
+
+MappedFile::MappedFile() :
+	data(nullptr),
+	size(0),
+#ifdef _WIN32
+	fileHandle(INVALID_HANDLE_VALUE),
+	mappingHandle(nullptr)
+#else
+	fileDescriptor(-1)
+#endif
+{ }
+
+MappedFile::MappedFile(const std::string& filePath) : MappedFile()
+{
+	Open(filePath);
+}
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& filePath)
+{
+	Close();
+
+	fileHandle = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		return false;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(fileHandle, &fileSize))
+	{
+		Close();
+		return false;
+	}
+
+	size = (size_t)fileSize.QuadPart;
+	if (size == 0)
+	{
+		data = emptyFileData;
+		return true;
+	}
+
+	mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mappingHandle == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	data = (const char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	if (data == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (data != nullptr && data != emptyFileData) UnmapViewOfFile(data);
+	if (mappingHandle != nullptr) CloseHandle(mappingHandle);
+	if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+
+	data = nullptr;
+	size = 0;
+	mappingHandle = nullptr;
+	fileHandle = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& filePath)
+{
+	Close();
+
+	fileDescriptor = open(filePath.c_str(), O_RDONLY);
+	if (fileDescriptor < 0)
+	{
+		return false;
+	}
+
+	struct stat fileStatus;
+	if (fstat(fileDescriptor, &fileStatus) != 0)
+	{
+		Close();
+		return false;
+	}
+
+	size = (size_t)fileStatus.st_size;
+	if (size == 0)
+	{
+		data = emptyFileData;
+		return true;
+	}
+
+	void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	if (mapping == MAP_FAILED)
+	{
+		Close();
+		return false;
+	}
+
+	// We scan the file front to back exactly once
+	madvise(mapping, size, MADV_SEQUENTIAL);
+	data = (const char*)mapping;
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (data != nullptr && data != emptyFileData) munmap((void*)data, size);
+	if (fileDescriptor >= 0) close(fileDescriptor);
+
+	data = nullptr;
+	size = 0;
+	fileDescriptor = -1;
+}
+
+#endif
+
+bool MappedFile::IsOpen() const
+{
+	return data != nullptr;
+}
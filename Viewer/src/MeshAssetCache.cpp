@@ -0,0 +1,127 @@
+#include "MeshAssetCache.h"
+#include "MappedFile.h"
+#include "Utils.h"
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+#ifndef _WIN32
+#include <climits>
+#endif
+
+MeshAssetCache::MeshAssetCache() :
+	residentMeshes(0),
+	residentBytes(0),
+	sharedLoads(0)
+{
+}
+
+MeshAssetCache& MeshAssetCache::Get()
+{
+	// The meshes still cached when the context is destroyed go with it, they are only released at exit
+	static MeshAssetCache cache;
+	return cache;
+}
+
+std::string MeshAssetCache::getCanonicalPath(const std::string& filePath)
+{
+#ifdef _WIN32
+	char path[_MAX_PATH];
+	if (_fullpath(path, filePath.c_str(), _MAX_PATH) == nullptr)
+	{
+		return std::string();
+	}
+	return path;
+#else
+	char path[PATH_MAX];
+	if (realpath(filePath.c_str(), path) == nullptr)
+	{
+		return std::string();
+	}
+	return path;
+#endif
+}
+
+std::string MeshAssetCache::GetKey(const std::string& filePath, uint64_t buildKey)
+{
+	std::string canonicalPath = getCanonicalPath(filePath);
+	MappedFile file;
+	if (canonicalPath.empty() || !file.Open(canonicalPath))
+	{
+		return std::string();
+	}
+
+	std::ostringstream key;
+	key << canonicalPath << '|' << std::hex << Utils::HashBytes(file.GetData(), file.GetSize()) << '|' << buildKey;
+	return key.str();
+}
+
+std::shared_ptr<const GpuMesh> MeshAssetCache::Find(const std::string& key)
+{
+	auto entry = entries.find(key);
+	if (key.empty() || entry == entries.end())
+	{
+		return nullptr;
+	}
+
+	std::shared_ptr<const GpuMesh> handle = entry->second.handle.lock();
+	if (!handle)
+	{
+		// Released but not deleted yet, it is taken back
+		releasedMeshes.erase(std::remove(releasedMeshes.begin(), releasedMeshes.end(), entry->second.mesh), releasedMeshes.end());
+		handle = makeHandle(entry->second.mesh);
+		entry->second.handle = handle;
+	}
+
+	sharedLoads++;
+	return handle;
+}
+
+std::shared_ptr<const GpuMesh> MeshAssetCache::Add(const std::string& key, const MeshView& mesh)
+{
+	GpuMesh* gpuMesh = new GpuMesh(mesh);
+	residentMeshes++;
+	residentBytes += gpuMesh->GetBufferBytes();
+
+	std::shared_ptr<const GpuMesh> handle = makeHandle(gpuMesh);
+	if (!key.empty())
+	{
+		// A mesh that was already shared under this key (a reload of the same file) stays resident until its
+		// handles are gone, the new one takes its place for the next loads
+		auto entry = entries.find(key);
+		if (entry != entries.end())
+		{
+			entry->second.mesh->cacheKey.clear();
+			entries.erase(entry);
+		}
+
+		gpuMesh->cacheKey = key;
+		entries[key] = Entry{ gpuMesh, handle };
+	}
+	return handle;
+}
+
+std::shared_ptr<const GpuMesh> MeshAssetCache::makeHandle(GpuMesh* mesh)
+{
+	return std::shared_ptr<const GpuMesh>(mesh, [this](const GpuMesh* released) { release(const_cast<GpuMesh*>(released)); });
+}
+
+void MeshAssetCache::release(GpuMesh* mesh)
+{
+	releasedMeshes.push_back(mesh);
+}
+
+void MeshAssetCache::CollectGarbage()
+{
+	for (GpuMesh* mesh : releasedMeshes)
+	{
+		if (!mesh->cacheKey.empty())
+		{
+			entries.erase(mesh->cacheKey);
+		}
+
+		residentMeshes--;
+		residentBytes -= mesh->GetBufferBytes();
+		delete mesh;
+	}
+	releasedMeshes.clear();
+}
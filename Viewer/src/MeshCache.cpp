@@ -0,0 +1,210 @@
+#include "MeshCache.h"
+#include "Utils.h"
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <vector>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+static const char MESH_CACHE_MAGIC[4] = { 'M', 'V', 'B', 'N' };
+
+static_assert(sizeof(MeshCacheHeader) == 96, "MeshCacheHeader must not contain padding");
+static_assert(sizeof(Vertex) == 8 * sizeof(float), "Vertex must be tightly packed to be cached");
+static_assert(sizeof(MeshLod) == 12, "MeshLod must not contain padding");
+
+std::string MeshCache::GetCacheFilePath(const std::string& sourceFilePath)
+{
+	return sourceFilePath + ".mvbin";
+}
+
+bool MeshCache::getSourceFileStatus(const std::string& sourceFilePath, uint64_t& size, int64_t& modifiedTime)
+{
+	struct stat fileStatus;
+	if (stat(sourceFilePath.c_str(), &fileStatus) != 0)
+	{
+		return false;
+	}
+
+	// In nanoseconds, so an edit in the same second that keeps the size still changes the time
+	size = (uint64_t)fileStatus.st_size;
+#if defined(_WIN32)
+	modifiedTime = (int64_t)fileStatus.st_mtime * 1000000000;
+#elif defined(__APPLE__)
+	modifiedTime = (int64_t)fileStatus.st_mtimespec.tv_sec * 1000000000 + fileStatus.st_mtimespec.tv_nsec;
+#else
+	modifiedTime = (int64_t)fileStatus.st_mtim.tv_sec * 1000000000 + fileStatus.st_mtim.tv_nsec;
+#endif
+	return true;
+}
+
+bool MeshCache::hashFile(const std::string& filePath, uint64_t& hash)
+{
+	MappedFile sourceFile;
+	if (!sourceFile.Open(filePath))
+	{
+		return false;
+	}
+
+	hash = Utils::HashBytes(sourceFile.GetData(), sourceFile.GetSize());
+	return true;
+}
+
+bool MeshCache::Load(const std::string& sourceFilePath, uint64_t buildKey)
+{
+	mesh = MeshView();
+	file.Close();
+
+	uint64_t sourceSize;
+	int64_t sourceModifiedTime;
+	if (!getSourceFileStatus(sourceFilePath, sourceSize, sourceModifiedTime))
+	{
+		return false;
+	}
+
+	std::string cacheFilePath = GetCacheFilePath(sourceFilePath);
+	if (!file.Open(cacheFilePath))
+	{
+		// No cache yet
+		return false;
+	}
+
+	const char* reason = nullptr;
+	const MeshCacheHeader* header = (const MeshCacheHeader*)file.GetData();
+	const char* payload = file.GetData() + sizeof(MeshCacheHeader);
+	size_t payloadSize = 0;
+
+	if (file.GetSize() < sizeof(MeshCacheHeader) || std::memcmp(header->magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) != 0)
+	{
+		reason = "not a mesh cache";
+	}
+	else if (header->version != MESH_CACHE_VERSION || header->vertexStride != GetVertexStride((VertexFormat)header->vertexFormat))
+	{
+		reason = "written by another version";
+	}
+	else if ((header->indexSize != sizeof(uint16_t) && header->indexSize != sizeof(uint32_t)) ||
+		header->vertexFormat > (uint32_t)VertexFormat::Quantized8)
+	{
+		reason = "corrupt";
+	}
+	else if (file.GetSize() != sizeof(MeshCacheHeader) + (payloadSize =
+		(size_t)header->lodCount * sizeof(MeshLod) + (size_t)header->vertexCount * header->vertexStride + (size_t)header->indexCount * header->indexSize))
+	{
+		reason = "truncated";
+	}
+	else if (header->buildKey != buildKey)
+	{
+		reason = "built with other options";
+	}
+	else if (header->sourceSize != sourceSize)
+	{
+		reason = "stale";
+	}
+	else if (header->sourceModifiedTime != sourceModifiedTime)
+	{
+		// The file was touched. Only rebuild if its contents really changed.
+		uint64_t sourceHash;
+		if (!hashFile(sourceFilePath, sourceHash) || sourceHash != header->sourceHash)
+		{
+			reason = "stale";
+		}
+	}
+
+	if (reason == nullptr && Utils::HashBytes(payload, payloadSize) != header->payloadHash)
+	{
+		reason = "corrupt";
+	}
+
+	if (reason != nullptr)
+	{
+		std::cout << "Ignoring mesh cache '" << cacheFilePath << "' (" << reason << ")" << std::endl;
+		file.Close();
+		return false;
+	}
+
+	const char* vertices = payload + (size_t)header->lodCount * sizeof(MeshLod);
+	mesh.lods = header->lodCount > 0 ? (const MeshLod*)payload : nullptr;
+	mesh.lodCount = header->lodCount;
+	mesh.vertices = vertices;
+	mesh.vertexCount = header->vertexCount;
+	mesh.vertexFormat = (VertexFormat)header->vertexFormat;
+	mesh.indices = vertices + (size_t)header->vertexCount * header->vertexStride;
+	mesh.indexCount = header->indexCount;
+	mesh.indexSize = header->indexSize;
+	mesh.minimums = glm::vec3(header->minimums[0], header->minimums[1], header->minimums[2]);
+	mesh.maximums = glm::vec3(header->maximums[0], header->maximums[1], header->maximums[2]);
+	return true;
+}
+
+bool MeshCache::Save(const std::string& sourceFilePath, const MeshView& meshToSave, uint64_t buildKey)
+{
+	// Stored exactly as uploaded, so loading can hand the mapping straight to the GPU
+	std::vector<uint16_t> shortIndices;
+	MeshView mesh = meshToSave.WithShortIndices(shortIndices);
+
+	MeshCacheHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+	header.version = MESH_CACHE_VERSION;
+	header.vertexStride = (uint32_t)GetVertexStride(mesh.vertexFormat);
+	header.vertexFormat = (uint32_t)mesh.vertexFormat;
+	header.vertexCount = (uint32_t)mesh.vertexCount;
+	header.indexCount = (uint32_t)mesh.indexCount;
+	header.indexSize = (uint32_t)mesh.indexSize;
+	header.lodCount = (uint32_t)mesh.lodCount;
+	header.buildKey = buildKey;
+	for (int i = 0; i < 3; i++)
+	{
+		header.minimums[i] = mesh.minimums[i];
+		header.maximums[i] = mesh.maximums[i];
+	}
+
+	if (!getSourceFileStatus(sourceFilePath, header.sourceSize, header.sourceModifiedTime) ||
+		!hashFile(sourceFilePath, header.sourceHash))
+	{
+		return false;
+	}
+
+	// The file system only updates the time once per tick (per second on Windows), so a source written just now
+	// could change again without its time changing. Its contents are then checked on every load.
+	if ((int64_t)std::time(nullptr) - header.sourceModifiedTime / 1000000000 < 2)
+	{
+		header.sourceModifiedTime = 0;
+	}
+
+	// The arrays are hashed as one block, the same way Load() sees them in the mapping
+	size_t lodBytes = mesh.lodCount * sizeof(MeshLod);
+	std::vector<char> payload(lodBytes + mesh.GetVertexBytes() + mesh.GetIndexBytes());
+	if (!payload.empty())
+	{
+		if (lodBytes > 0) std::memcpy(payload.data(), mesh.lods, lodBytes);
+		std::memcpy(payload.data() + lodBytes, mesh.vertices, mesh.GetVertexBytes());
+		std::memcpy(payload.data() + lodBytes + mesh.GetVertexBytes(), mesh.indices, mesh.GetIndexBytes());
+	}
+	header.payloadHash = Utils::HashBytes(payload.data(), payload.size());
+
+	// See Utils::GetTemporaryFilePath
+	std::string cacheFilePath = GetCacheFilePath(sourceFilePath);
+	std::string temporaryFilePath = Utils::GetTemporaryFilePath(cacheFilePath);
+
+	FILE* output = std::fopen(temporaryFilePath.c_str(), "wb");
+	if (output == nullptr)
+	{
+		return false;
+	}
+
+	bool written = std::fwrite(&header, sizeof(header), 1, output) == 1;
+	if (!payload.empty())
+	{
+		written = written && std::fwrite(payload.data(), payload.size(), 1, output) == 1;
+	}
+	written = std::fclose(output) == 0 && written;
+
+	if (!written)
+	{
+		std::remove(temporaryFilePath.c_str());
+		return false;
+	}
+	return Utils::ReplaceFile(temporaryFilePath, cacheFilePath);
+}
@@ -1,5 +1,7 @@
 #include "MeshModel.h"
 #include "Utils.h"
+#include "MeshAssetCache.h"
+#include "TextureManager.h"
 #include <vector>
 #include <string>
 #include <iostream>
@@ -8,7 +10,7 @@
 #include <algorithm>
 #include <math.h>
 
-MeshModel::MeshModel(std::vector<Face> faces, std::vector<glm::vec3> vertices, const std::string& modelName) : 
+MeshModel::MeshModel(const std::vector<Face>& faces, const std::vector<glm::vec3>& vertices, const std::string& modelName) : 
 	MeshModel(faces, 
 		vertices, 
 		Utils::CalculateNormals(vertices, faces), 
@@ -16,24 +18,43 @@ MeshModel::MeshModel(std::vector<Face> faces, std::vector<glm::vec3> vertices, c
 		modelName) 
 { }
 
-MeshModel::MeshModel(std::vector<Face> faces, 
-	std::vector<glm::vec3> vertices, 
-	std::vector<glm::vec2> textureCoords, 
+MeshModel::MeshModel(const std::vector<Face>& faces, 
+	const std::vector<glm::vec3>& vertices, 
+	const std::vector<glm::vec2>& textureCoords, 
 	const std::string& modelName, 
 	const std::string& textureFileName) : 
-	MeshModel(faces, 
-	vertices, 
-	Utils::CalculateNormals(vertices, faces), 
-	textureCoords, 
-	modelName) 
+	MeshModel(Utils::BuildMeshData(faces, vertices, Utils::CalculateNormals(vertices, faces), textureCoords).GetView(), 
+	modelName,
+	textureFileName) 
+{ }
+
+MeshModel::MeshModel(const std::vector<Face>& faces, const std::vector<glm::vec3>& vertices, const std::vector<glm::vec3>& normals, const std::vector<glm::vec2>& textureCoords, const std::string& modelName) :
+	MeshModel(Utils::BuildMeshData(faces, vertices, normals, textureCoords).GetView(), modelName)
+{ }
+
+MeshModel::MeshModel(const MeshView& mesh, const std::string& modelName, const std::string& textureFileName) :
+	MeshModel(MeshAssetCache::Get().Upload(mesh), modelName, textureFileName)
+{ }
+
+MeshModel::MeshModel(const MeshView& mesh, const std::string& modelName) :
+	MeshModel(MeshAssetCache::Get().Upload(mesh), modelName)
+{ }
+
+MeshModel::MeshModel(const std::shared_ptr<const GpuMesh>& mesh, const std::string& modelName, const std::string& textureFileName) :
+	MeshModel(mesh, modelName)
 {
-	string normalMapFile = "C:\\Users\\aagami\\Documents\\project-de-west-denya-massiv\\Data\\brickwall_normal.jpg";
-	textureLoaded = texture.loadTexture(textureFileName);
-	bumpMap = new Texture2D(1);
-	bumpMap->loadTexture(normalMapFile);
+	if (!textureFileName.empty())
+	{
+		texture = TextureManager::Get().Load(textureFileName);
+	}
+
+	// Normals aren't colors, their mip levels are averaged as they are
+	TextureLoadOptions normalMapOptions;
+	normalMapOptions.mipFilter = MipFilter::Linear;
+	bumpMap = TextureManager::Get().Load(TextureManager::Get().GetNormalMapFile(), normalMapOptions);
 }
 
-MeshModel::MeshModel(std::vector<Face> faces, std::vector<glm::vec3> vertices, std::vector<glm::vec3> normals, std::vector<glm::vec2> textureCoords, const std::string& modelName) :
+MeshModel::MeshModel(const std::shared_ptr<const GpuMesh>& mesh, const std::string& modelName) :
 	modelTransform(1),
 	worldTransform(1),
 	modelName(modelName),
@@ -45,58 +66,65 @@ MeshModel::MeshModel(std::vector<Face> faces, std::vector<glm::vec3> vertices, s
 	maximums(0),
 	centerPoint(0),
 	color(glm::vec4(0.2f,0.2f,0.2f,1.0f)),
-	uniformMaterial(Material())
+	uniformMaterial(Material()),
+	currentLod(0)
 {
-	modelVertices.reserve(3 * faces.size());
-	for (unsigned int i = 0; i < faces.size(); i++)
-	{
-		Face currentFace = faces.at(i);
-		for (int j = 0; j < 3; j++)
-		{
-			int vertexIndex = currentFace.GetVertexIndex(j) - 1;
-
-			Vertex vertex;
-			vertex.position = vertices[vertexIndex];
-			vertex.normal = normals[vertexIndex];
-
-			if (textureCoords.size() > 0)
-			{
-				int textureCoordsIndex = currentFace.GetTextureIndex(j) - 1;
-				vertex.textureCoords = textureCoords[textureCoordsIndex];
-			}
-
-			modelVertices.push_back(vertex);
-		}
-	}
+	setGpuMesh(mesh);
+}
+
+void MeshModel::uploadMesh(const MeshView& mesh)
+{
+	setGpuMesh(MeshAssetCache::Get().Upload(mesh));
+}
 
-	glGenVertexArrays(1, &vao);
-	glGenBuffers(1, &vbo);
+void MeshModel::setGpuMesh(const std::shared_ptr<const GpuMesh>& mesh)
+{
+	gpuMesh = mesh;
+	minimums = mesh->GetMinimums();
+	maximums = mesh->GetMaximums();
+	centerPoint = (minimums + maximums) * 0.5f;
+	boundingSphere.center = centerPoint;
+	boundingSphere.radius = glm::length(maximums - minimums) * 0.5f;
+	currentLod = 0;
+}
 
-	glBindVertexArray(vao);
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBufferData(GL_ARRAY_BUFFER, modelVertices.size() * sizeof(Vertex), &modelVertices[0], GL_STATIC_DRAW);
+BoundingBox MeshModel::GetBoundingBox() const
+{
+	BoundingBox box;
+	box.minimums = minimums;
+	box.maximums = maximums;
+	return box;
+}
 
-	// Vertex Positions
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)0);
-	glEnableVertexAttribArray(0);
+// projectedSize is the diameter of the bounding sphere on the screen, in pixels. The level errors are relative
+// to the same diameter (the bounding box diagonal), so error * projectedSize is the error in pixels.
+void MeshModel::SelectLod(float projectedSize, float maxPixelError)
+{
+	currentLod = ChooseLod(projectedSize, maxPixelError, currentLod);
+}
 
-	// Normals attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)(3 * sizeof(GLfloat)));
-	glEnableVertexAttribArray(1);
+// The level SelectLod would switch to from currentLevel, for callers that keep the current level themselves
+size_t MeshModel::ChooseLod(float projectedSize, float maxPixelError, size_t currentLevel) const
+{
+	const std::vector<MeshLod>& lods = gpuMesh->GetLods();
+	size_t level = 0;
+	while (level + 1 < lods.size() && lods[level + 1].error * projectedSize <= maxPixelError)
+	{
+		level++;
+	}
 
-	// Vertex Texture Coords
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)(6 * sizeof(GLfloat)));
-	glEnableVertexAttribArray(2);
+	// Going finer happens right away, going coarser only with some margin
+	while (level > currentLevel && lods[level].error * projectedSize > maxPixelError * LOD_HYSTERESIS)
+	{
+		level--;
+	}
 
-	// unbind to make sure other code does not change it somewhere else
-	glBindVertexArray(0);
+	return level;
 }
 
 MeshModel::~MeshModel()
 {
-	glDeleteVertexArrays(1, &vao);
-	glDeleteBuffers(1, &vbo);
-	if (bumpMap != nullptr) delete bumpMap;
+	// Releases the GPU mesh and the textures, MeshAssetCache and TextureManager decide when they are deleted
 }
 
 // AKA translate
@@ -256,3 +284,13 @@ void MeshModel::RotateZ(const float angle)
 	rotateTransformation = GetZRotationMatrix() * rotateTransformation;
 	rotateAngle = glm::vec3(0.0f);
 }
+
+void MeshModel::BindTextures() const
+{
+	GLStateCache& stateCache = GLStateCache::Get();
+	stateCache.BindTexture(0, GetTextureId());
+	if (bumpMap)
+	{
+		stateCache.BindTexture(1, bumpMap->getTexture());
+	}
+}
@@ -0,0 +1,353 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+// Parameters of Forsyth's vertex cache optimization, as published
+static constexpr int FORSYTH_CACHE_SIZE = 32;
+static constexpr float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+static constexpr float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+static constexpr float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+static constexpr float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+static constexpr int FORSYTH_MAX_VALENCE = 64;
+
+// A cluster may end where its own ACMR (starting from a cold cache) is within this factor of the whole mesh's
+static constexpr double OVERDRAW_CLUSTER_THRESHOLD = 1.05;
+static constexpr size_t OVERDRAW_MIN_CLUSTER_TRIANGLES = 32;
+
+namespace
+{
+	// Score of a vertex by its position in the simulated LRU cache and the number of triangles still using it
+	struct ForsythScores
+	{
+		float cache[FORSYTH_CACHE_SIZE];
+		float valence[FORSYTH_MAX_VALENCE];
+
+		ForsythScores()
+		{
+			for (int i = 0; i < FORSYTH_CACHE_SIZE; i++)
+			{
+				// The last triangle's vertices get a fixed score, so the next one doesn't just reuse the same edge
+				cache[i] = i < 3 ? FORSYTH_LAST_TRIANGLE_SCORE :
+					std::pow(1.0f - (float)(i - 3) / (FORSYTH_CACHE_SIZE - 3), FORSYTH_CACHE_DECAY_POWER);
+			}
+
+			// Vertices with few triangles left get a boost, so no lonely triangles are left behind
+			valence[0] = -1.0f;
+			for (int i = 1; i < FORSYTH_MAX_VALENCE; i++)
+			{
+				valence[i] = FORSYTH_VALENCE_BOOST_SCALE * std::pow((float)i, -FORSYTH_VALENCE_BOOST_POWER);
+			}
+		}
+
+		float Get(int cachePosition, uint32_t remainingTriangles) const
+		{
+			if (remainingTriangles == 0) return -1.0f;
+
+			float score = cachePosition >= 0 ? cache[cachePosition] : 0.0f;
+			return score + valence[std::min<uint32_t>(remainingTriangles, FORSYTH_MAX_VALENCE - 1)];
+		}
+	};
+}
+
+VertexCacheStatistics MeshOptimizer::AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, unsigned int cacheSize)
+{
+	// A FIFO cache: a vertex is only evicted by the ones that come after it, not refreshed by hits
+	std::vector<size_t> insertionTimes(vertexCount, 0);
+	size_t misses = 0;
+
+	for (uint32_t index : indices)
+	{
+		if (insertionTimes[index] == 0 || misses - insertionTimes[index] >= cacheSize)
+		{
+			misses++;
+			insertionTimes[index] = misses;
+		}
+	}
+
+	VertexCacheStatistics statistics;
+	size_t triangleCount = indices.size() / 3;
+	statistics.acmr = triangleCount > 0 ? (double)misses / triangleCount : 0.0;
+	statistics.atvr = vertexCount > 0 ? (double)misses / vertexCount : 0.0;
+	return statistics;
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount)
+{
+	static const ForsythScores scores;
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	// The triangles not yet emitted around each vertex, those of vertex i are vertexTriangles[offsets[i]..offsets[i] + remaining[i])
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	std::vector<uint32_t> remaining(vertexCount, 0);
+	for (uint32_t index : indices)
+	{
+		remaining[index]++;
+	}
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		offsets[i + 1] = offsets[i] + remaining[i];
+	}
+
+	std::vector<uint32_t> vertexTriangles(indices.size());
+	{
+		std::vector<uint32_t> cursors(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			vertexTriangles[cursors[indices[i]]++] = (uint32_t)(i / 3);
+		}
+	}
+
+	std::vector<int> cachePositions(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		vertexScores[i] = scores.Get(-1, remaining[i]);
+	}
+
+	std::vector<float> triangleScores(triangleCount);
+	for (size_t i = 0; i < triangleCount; i++)
+	{
+		triangleScores[i] = vertexScores[indices[3 * i]] + vertexScores[indices[3 * i + 1]] + vertexScores[indices[3 * i + 2]];
+	}
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint32_t> optimized;
+	optimized.reserve(indices.size());
+
+	// The cache holds up to FORSYTH_CACHE_SIZE vertices, plus the 3 that are pushed in before the overflow is dropped
+	std::vector<uint32_t> cache, newCache;
+	cache.reserve(FORSYTH_CACHE_SIZE + 3);
+	newCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+	int64_t bestTriangle = -1;
+	size_t nextUnemitted = 0;
+
+	for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++)
+	{
+		if (bestTriangle < 0)
+		{
+			// Nothing around the cache is left, continue with the first triangle not emitted yet
+			while (emitted[nextUnemitted]) nextUnemitted++;
+			bestTriangle = (int64_t)nextUnemitted;
+		}
+
+		uint32_t triangle = (uint32_t)bestTriangle;
+		emitted[triangle] = true;
+
+		newCache.clear();
+		for (int corner = 0; corner < 3; corner++)
+		{
+			uint32_t vertex = indices[3 * triangle + corner];
+			optimized.push_back(vertex);
+			newCache.push_back(vertex);
+
+			// Remove the triangle from the vertex's list of remaining triangles
+			uint32_t* begin = &vertexTriangles[offsets[vertex]];
+			uint32_t* end = begin + remaining[vertex];
+			*std::find(begin, end, triangle) = *(end - 1);
+			remaining[vertex]--;
+		}
+
+		for (uint32_t vertex : cache)
+		{
+			if (vertex != newCache[0] && vertex != newCache[1] && vertex != newCache[2])
+			{
+				newCache.push_back(vertex);
+			}
+		}
+
+		// Vertices pushed out of the cache lose their position score
+		for (size_t i = FORSYTH_CACHE_SIZE; i < newCache.size(); i++)
+		{
+			uint32_t vertex = newCache[i];
+			float score = scores.Get(-1, remaining[vertex]);
+			float scoreChange = score - vertexScores[vertex];
+			cachePositions[vertex] = -1;
+			vertexScores[vertex] = score;
+
+			for (uint32_t k = offsets[vertex]; k < offsets[vertex] + remaining[vertex]; k++)
+			{
+				triangleScores[vertexTriangles[k]] += scoreChange;
+			}
+		}
+		newCache.resize(std::min<size_t>(newCache.size(), FORSYTH_CACHE_SIZE));
+		cache.swap(newCache);
+
+		// Rescore the vertices in the cache and the triangles around them, and pick the best of those triangles
+		for (size_t i = 0; i < cache.size(); i++)
+		{
+			cachePositions[cache[i]] = (int)i;
+		}
+
+		float bestScore = -1.0f;
+		bestTriangle = -1;
+		for (uint32_t vertex : cache)
+		{
+			float score = scores.Get(cachePositions[vertex], remaining[vertex]);
+			float scoreChange = score - vertexScores[vertex];
+			vertexScores[vertex] = score;
+
+			for (uint32_t k = offsets[vertex]; k < offsets[vertex] + remaining[vertex]; k++)
+			{
+				uint32_t neighbour = vertexTriangles[k];
+				triangleScores[neighbour] += scoreChange;
+				if (triangleScores[neighbour] > bestScore)
+				{
+					bestScore = triangleScores[neighbour];
+					bestTriangle = neighbour;
+				}
+			}
+		}
+	}
+
+	indices.swap(optimized);
+}
+
+size_t MeshOptimizer::OptimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices)
+{
+	size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return 0;
+	}
+
+	double targetAcmr = OVERDRAW_CLUSTER_THRESHOLD * AnalyzeVertexCache(indices, vertices.size()).acmr;
+
+	// Cut the triangle order into clusters. Every cluster starts with a cold cache in the simulation,
+	// and ends as soon as it has paid that back, so drawing them in another order costs little.
+	std::vector<size_t> clusterStarts;
+	std::vector<size_t> insertionTimes(vertices.size(), 0);
+	size_t misses = 0;
+	size_t clusterMisses = 0;
+	size_t clusterStart = 0;
+
+	clusterStarts.push_back(0);
+	for (size_t i = 0; i < triangleCount; i++)
+	{
+		for (int corner = 0; corner < 3; corner++)
+		{
+			uint32_t index = indices[3 * i + corner];
+			if (insertionTimes[index] == 0 || misses - insertionTimes[index] >= VERTEX_CACHE_SIMULATION_SIZE)
+			{
+				misses++;
+				clusterMisses++;
+				insertionTimes[index] = misses;
+			}
+		}
+
+		size_t clusterTriangles = i + 1 - clusterStart;
+		if (i + 1 < triangleCount && clusterTriangles >= OVERDRAW_MIN_CLUSTER_TRIANGLES &&
+			(double)clusterMisses / clusterTriangles <= targetAcmr)
+		{
+			clusterStart = i + 1;
+			clusterStarts.push_back(clusterStart);
+			clusterMisses = 0;
+
+			// Make the next cluster start cold
+			misses += VERTEX_CACHE_SIMULATION_SIZE;
+		}
+	}
+	clusterStarts.push_back(triangleCount);
+
+	// Sort the clusters front to back as seen from outside the mesh: the ones far from the center and facing
+	// away from it occlude the others from most view directions
+	size_t clusterCount = clusterStarts.size() - 1;
+	std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3(0.0f));
+	std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3(0.0f));
+	glm::vec3 meshCentroid(0.0f);
+	float meshArea = 0.0f;
+
+	for (size_t cluster = 0; cluster < clusterCount; cluster++)
+	{
+		float clusterArea = 0.0f;
+		for (size_t i = clusterStarts[cluster]; i < clusterStarts[cluster + 1]; i++)
+		{
+			const glm::vec3& v0 = vertices[indices[3 * i]].position;
+			const glm::vec3& v1 = vertices[indices[3 * i + 1]].position;
+			const glm::vec3& v2 = vertices[indices[3 * i + 2]].position;
+
+			// Same orientation as NormalGenerator
+			glm::vec3 normal = -glm::cross(v0 - v1, v2 - v1);
+			float area = 0.5f * std::sqrt(glm::dot(normal, normal));
+			glm::vec3 centroid = (v0 + v1 + v2) / 3.0f;
+
+			clusterNormals[cluster] += normal;
+			clusterCentroids[cluster] += centroid * area;
+			clusterArea += area;
+		}
+
+		meshCentroid += clusterCentroids[cluster];
+		meshArea += clusterArea;
+		if (clusterArea > 0.0f)
+		{
+			clusterCentroids[cluster] /= clusterArea;
+		}
+	}
+
+	if (meshArea > 0.0f)
+	{
+		meshCentroid /= meshArea;
+	}
+
+	std::vector<float> sortKeys(clusterCount);
+	std::vector<size_t> clusterOrder(clusterCount);
+	for (size_t cluster = 0; cluster < clusterCount; cluster++)
+	{
+		glm::vec3 normal = clusterNormals[cluster];
+		float length = std::sqrt(glm::dot(normal, normal));
+		sortKeys[cluster] = length > 0.0f ? glm::dot(clusterCentroids[cluster] - meshCentroid, normal / length) : 0.0f;
+		clusterOrder[cluster] = cluster;
+	}
+
+	std::stable_sort(clusterOrder.begin(), clusterOrder.end(), [&sortKeys](size_t a, size_t b) { return sortKeys[a] > sortKeys[b]; });
+
+	std::vector<uint32_t> sorted;
+	sorted.reserve(indices.size());
+	for (size_t cluster : clusterOrder)
+	{
+		sorted.insert(sorted.end(), indices.begin() + 3 * clusterStarts[cluster], indices.begin() + 3 * clusterStarts[cluster + 1]);
+	}
+
+	indices.swap(sorted);
+	return clusterCount;
+}
+
+void MeshOptimizer::OptimizeVertexFetch(std::vector<uint32_t>& indices, std::vector<Vertex>& vertices)
+{
+	const uint32_t unused = 0xFFFFFFFFu;
+	std::vector<uint32_t> remap(vertices.size(), unused);
+	std::vector<Vertex> reordered;
+	reordered.reserve(vertices.size());
+
+	for (uint32_t& index : indices)
+	{
+		if (remap[index] == unused)
+		{
+			remap[index] = (uint32_t)reordered.size();
+			reordered.push_back(vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	// Vertices no triangle uses are dropped
+	vertices.swap(reordered);
+}
+
+void MeshOptimizer::Optimize(MeshData& mesh, MeshOptimizationStatistics& statistics)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	statistics.before = AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+
+	OptimizeVertexCache(mesh.indices, mesh.vertices.size());
+	statistics.overdrawClusters = OptimizeOverdraw(mesh.indices, mesh.vertices);
+	OptimizeVertexFetch(mesh.indices, mesh.vertices);
+
+	statistics.after = AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+	std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+	statistics.seconds = elapsed.count();
+}
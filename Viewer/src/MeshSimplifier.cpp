@@ -0,0 +1,414 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <numeric>
+
+// Each pass collapses a set of edges that don't touch each other, until the target is reached
+static constexpr int MAX_SIMPLIFY_PASSES = 100;
+// Border planes weigh this much more than the triangle planes, so borders only move along themselves
+static constexpr double BORDER_WEIGHT = 10.0;
+// A collapse may not turn a triangle by more than about 75 degrees (the cosine of that)
+static constexpr double MIN_NORMAL_DOT = 0.25;
+
+void MeshSimplifier::Quadric::AddPlane(const glm::dvec3& normal, double distance, double weight)
+{
+	a00 += weight * normal.x * normal.x;
+	a01 += weight * normal.x * normal.y;
+	a02 += weight * normal.x * normal.z;
+	a11 += weight * normal.y * normal.y;
+	a12 += weight * normal.y * normal.z;
+	a22 += weight * normal.z * normal.z;
+	b0 += weight * normal.x * distance;
+	b1 += weight * normal.y * distance;
+	b2 += weight * normal.z * distance;
+	c += weight * distance * distance;
+}
+
+void MeshSimplifier::Quadric::Add(const Quadric& other)
+{
+	a00 += other.a00; a01 += other.a01; a02 += other.a02;
+	a11 += other.a11; a12 += other.a12; a22 += other.a22;
+	b0 += other.b0; b1 += other.b1; b2 += other.b2;
+	c += other.c;
+	area += other.area;
+}
+
+double MeshSimplifier::Quadric::Evaluate(const glm::dvec3& p) const
+{
+	// p^T A p + 2 b.p + c, the weighted sum of the squared plane distances
+	double error =
+		a00 * p.x * p.x + 2.0 * a01 * p.x * p.y + 2.0 * a02 * p.x * p.z +
+		a11 * p.y * p.y + 2.0 * a12 * p.y * p.z + a22 * p.z * p.z +
+		2.0 * (b0 * p.x + b1 * p.y + b2 * p.z) + c;
+	return std::max(error, 0.0);
+}
+
+void MeshSimplifier::lockSeams(const std::vector<Vertex>& vertices, std::vector<uint8_t>& locked)
+{
+	std::vector<uint32_t> order(vertices.size());
+	std::iota(order.begin(), order.end(), 0u);
+
+	auto positionLess = [&vertices](uint32_t a, uint32_t b)
+	{
+		return std::memcmp(&vertices[a].position, &vertices[b].position, sizeof(glm::vec3)) < 0;
+	};
+	std::sort(order.begin(), order.end(), positionLess);
+
+	for (size_t i = 1; i < order.size(); i++)
+	{
+		if (!positionLess(order[i - 1], order[i]))
+		{
+			locked[order[i - 1]] = locked[order[i]] = 1;
+		}
+	}
+}
+
+void MeshSimplifier::buildAdjacency(const std::vector<uint32_t>& triangles, const std::vector<uint8_t>& removed, size_t vertexCount,
+	std::vector<uint32_t>& offsets, std::vector<uint32_t>& adjacency)
+{
+	offsets.assign(vertexCount + 1, 0);
+	for (size_t t = 0; t < removed.size(); t++)
+	{
+		if (removed[t]) continue;
+		for (int j = 0; j < 3; j++) offsets[triangles[3 * t + j] + 1]++;
+	}
+	for (size_t v = 0; v < vertexCount; v++)
+	{
+		offsets[v + 1] += offsets[v];
+	}
+
+	adjacency.resize(offsets[vertexCount]);
+	std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+	for (size_t t = 0; t < removed.size(); t++)
+	{
+		if (removed[t]) continue;
+		for (int j = 0; j < 3; j++) adjacency[cursor[triangles[3 * t + j]]++] = (uint32_t)t;
+	}
+}
+
+bool MeshSimplifier::flipsTriangles(const std::vector<uint32_t>& triangles, const std::vector<uint8_t>& removed,
+	const uint32_t* adjacent, const uint32_t* adjacentEnd, uint32_t from, uint32_t to, const std::vector<Vertex>& vertices)
+{
+	glm::dvec3 origin = glm::dvec3(vertices[from].position);
+	glm::dvec3 target = glm::dvec3(vertices[to].position);
+
+	for (const uint32_t* triangle = adjacent; triangle != adjacentEnd; triangle++)
+	{
+		if (removed[*triangle]) continue;
+
+		const uint32_t* corners = &triangles[3 * *triangle];
+		if (corners[0] == to || corners[1] == to || corners[2] == to)
+		{
+			// Collapses away
+			continue;
+		}
+
+		int corner = corners[0] == from ? 0 : (corners[1] == from ? 1 : 2);
+		glm::dvec3 second = glm::dvec3(vertices[corners[(corner + 1) % 3]].position);
+		glm::dvec3 third = glm::dvec3(vertices[corners[(corner + 2) % 3]].position);
+
+		glm::dvec3 before = glm::cross(second - origin, third - origin);
+		glm::dvec3 after = glm::cross(second - target, third - target);
+		double afterLength = glm::length(after);
+		if (afterLength == 0.0 || glm::dot(before, after) < MIN_NORMAL_DOT * glm::length(before) * afterLength)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+std::vector<uint32_t> MeshSimplifier::Simplify(const std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices,
+	size_t targetIndexCount, float& error)
+{
+	error = 0.0f;
+	size_t vertexCount = vertices.size();
+	size_t triangleCount = indices.size() / 3;
+	size_t targetTriangleCount = targetIndexCount / 3;
+
+	std::vector<uint32_t> triangles(indices.begin(), indices.begin() + 3 * triangleCount);
+	std::vector<uint8_t> removed(triangleCount, 0);
+	std::vector<uint8_t> locked(vertexCount, 0);
+	lockSeams(vertices, locked);
+
+	std::vector<uint32_t> offsets, adjacency;
+	buildAdjacency(triangles, removed, vertexCount, offsets, adjacency);
+
+	// Neighbours of a vertex, once per live triangle they share with it (so border neighbours appear once)
+	auto collectNeighbours = [&](uint32_t vertex, std::vector<uint32_t>& neighbours)
+	{
+		neighbours.clear();
+		for (uint32_t i = offsets[vertex]; i < offsets[vertex + 1]; i++)
+		{
+			uint32_t triangle = adjacency[i];
+			if (removed[triangle]) continue;
+			for (int j = 0; j < 3; j++)
+			{
+				uint32_t corner = triangles[3 * triangle + j];
+				if (corner != vertex) neighbours.push_back(corner);
+			}
+		}
+		std::sort(neighbours.begin(), neighbours.end());
+	};
+
+	glm::vec3 minimums(0.0f), maximums(0.0f);
+	if (vertexCount > 0) minimums = maximums = vertices[0].position;
+	for (const Vertex& vertex : vertices)
+	{
+		minimums = glm::min(minimums, vertex.position);
+		maximums = glm::max(maximums, vertex.position);
+	}
+	double diagonal = glm::length(maximums - minimums);
+
+	// The planes of the triangles around each vertex
+	std::vector<Quadric> quadrics(vertexCount, Quadric());
+	std::vector<glm::dvec3> triangleNormals(triangleCount);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		glm::dvec3 first = glm::dvec3(vertices[triangles[3 * t]].position);
+		glm::dvec3 normal = glm::cross(glm::dvec3(vertices[triangles[3 * t + 1]].position) - first,
+			glm::dvec3(vertices[triangles[3 * t + 2]].position) - first);
+		double length = glm::length(normal);
+		if (length == 0.0) continue;
+
+		normal = normal / length;
+		triangleNormals[t] = normal;
+		for (int j = 0; j < 3; j++)
+		{
+			Quadric& quadric = quadrics[triangles[3 * t + j]];
+			quadric.AddPlane(normal, -glm::dot(normal, first), 0.5 * length);
+			quadric.area += 0.5 * length;
+		}
+	}
+
+	// Border edges get a plane perpendicular to their triangle. Vertices where more than two triangles meet
+	// at an edge, or where two borders touch, are locked.
+	std::vector<uint32_t> neighbours;
+	for (uint32_t vertex = 0; vertex < vertexCount; vertex++)
+	{
+		collectNeighbours(vertex, neighbours);
+		size_t borderEdges = 0;
+		for (size_t i = 0; i < neighbours.size();)
+		{
+			size_t end = i;
+			while (end < neighbours.size() && neighbours[end] == neighbours[i]) end++;
+			if (end - i > 2) locked[vertex] = 1;
+			if (end - i == 1) borderEdges++;
+			i = end;
+		}
+		if (borderEdges > 2) locked[vertex] = 1;
+	}
+
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		for (int j = 0; j < 3; j++)
+		{
+			uint32_t from = triangles[3 * t + j];
+			uint32_t to = triangles[3 * t + (j + 1) % 3];
+
+			size_t shared = 0;
+			for (uint32_t i = offsets[from]; i < offsets[from + 1]; i++)
+			{
+				const uint32_t* corners = &triangles[3 * adjacency[i]];
+				if (corners[0] == to || corners[1] == to || corners[2] == to) shared++;
+			}
+			if (shared != 1) continue;
+
+			glm::dvec3 start = glm::dvec3(vertices[from].position);
+			glm::dvec3 edge = glm::dvec3(vertices[to].position) - start;
+			glm::dvec3 normal = glm::cross(edge, triangleNormals[t]);
+			double length = glm::length(normal);
+			if (length == 0.0) continue;
+
+			normal = normal / length;
+			double weight = BORDER_WEIGHT * glm::dot(edge, edge);
+			quadrics[from].AddPlane(normal, -glm::dot(normal, start), weight);
+			quadrics[to].AddPlane(normal, -glm::dot(normal, start), weight);
+		}
+	}
+
+	// Distance the surface moves when from collapses onto to
+	auto collapseError = [&](uint32_t from, uint32_t to)
+	{
+		glm::dvec3 target = glm::dvec3(vertices[to].position);
+		double area = quadrics[from].area + quadrics[to].area;
+		double sum = quadrics[from].Evaluate(target) + quadrics[to].Evaluate(target);
+		return area > 0.0 ? std::sqrt(sum / area) : 0.0;
+	};
+
+	size_t liveTriangleCount = triangleCount;
+	double maximumError = 0.0;
+	std::vector<Collapse> collapses;
+	std::vector<uint8_t> touched(vertexCount);
+	std::vector<uint32_t> targetNeighbours, common;
+
+	for (int pass = 0; pass < MAX_SIMPLIFY_PASSES && liveTriangleCount > targetTriangleCount; pass++)
+	{
+		if (pass > 0)
+		{
+			buildAdjacency(triangles, removed, vertexCount, offsets, adjacency);
+		}
+
+		// An interior edge is in two triangles, once in each direction. Take it from the one that has it in
+		// increasing order, border edges from their only triangle. Each one in its cheaper direction.
+		auto isBorderEdge = [&](uint32_t a, uint32_t b)
+		{
+			size_t shared = 0;
+			for (uint32_t i = offsets[a]; i < offsets[a + 1]; i++)
+			{
+				const uint32_t* corners = &triangles[3 * adjacency[i]];
+				if (!removed[adjacency[i]] && (corners[0] == b || corners[1] == b || corners[2] == b)) shared++;
+			}
+			return shared == 1;
+		};
+
+		collapses.clear();
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			if (removed[t]) continue;
+			for (int j = 0; j < 3; j++)
+			{
+				uint32_t a = triangles[3 * t + j];
+				uint32_t b = triangles[3 * t + (j + 1) % 3];
+				if ((locked[a] && locked[b]) || (a > b && !isBorderEdge(a, b))) continue;
+
+				Collapse collapse;
+				collapse.error = locked[a] ? collapseError(b, a) : collapseError(a, b);
+				collapse.from = locked[a] ? b : a;
+				collapse.to = locked[a] ? a : b;
+				if (!locked[a] && !locked[b])
+				{
+					double reverseError = collapseError(b, a);
+					if (reverseError < collapse.error)
+					{
+						collapse.error = reverseError;
+						collapse.from = b;
+						collapse.to = a;
+					}
+				}
+				collapses.push_back(collapse);
+			}
+		}
+		std::sort(collapses.begin(), collapses.end());
+
+		std::fill(touched.begin(), touched.end(), 0);
+		size_t collapsedCount = 0;
+		for (const Collapse& collapse : collapses)
+		{
+			if (liveTriangleCount <= targetTriangleCount) break;
+
+			uint32_t from = collapse.from;
+			uint32_t to = collapse.to;
+			if (touched[from] || touched[to]) continue;
+
+			collectNeighbours(from, neighbours);
+			size_t shared = std::count(neighbours.begin(), neighbours.end(), to);
+			bool borderVertex = false;
+			for (size_t i = 0; i < neighbours.size() && !borderVertex; i++)
+			{
+				borderVertex = (i == 0 || neighbours[i] != neighbours[i - 1]) &&
+					(i + 1 == neighbours.size() || neighbours[i] != neighbours[i + 1]);
+			}
+
+			// Border vertices may only slide along their border, interior edges need exactly two triangles
+			if (shared != (borderVertex ? 1u : 2u)) continue;
+
+			// Link condition: the only neighbours the two vertices have in common are the tips of the
+			// triangles that collapse, anything else would pinch the surface into a non-manifold one
+			collectNeighbours(to, targetNeighbours);
+			neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+			targetNeighbours.erase(std::unique(targetNeighbours.begin(), targetNeighbours.end()), targetNeighbours.end());
+			common.clear();
+			std::set_intersection(neighbours.begin(), neighbours.end(), targetNeighbours.begin(), targetNeighbours.end(), std::back_inserter(common));
+			if (common.size() != shared) continue;
+
+			const uint32_t* adjacent = adjacency.data() + offsets[from];
+			const uint32_t* adjacentEnd = adjacency.data() + offsets[from + 1];
+			if (flipsTriangles(triangles, removed, adjacent, adjacentEnd, from, to, vertices)) continue;
+
+			for (const uint32_t* triangle = adjacent; triangle != adjacentEnd; triangle++)
+			{
+				if (removed[*triangle]) continue;
+
+				uint32_t* corners = &triangles[3 * *triangle];
+				if (corners[0] == to || corners[1] == to || corners[2] == to)
+				{
+					removed[*triangle] = 1;
+					liveTriangleCount--;
+					continue;
+				}
+				for (int j = 0; j < 3; j++)
+				{
+					if (corners[j] == from) corners[j] = to;
+				}
+			}
+
+			// The adjacency of 'to' is stale until the next pass, so neither vertex is used again in this one
+			quadrics[to].Add(quadrics[from]);
+			touched[from] = touched[to] = 1;
+			maximumError = std::max(maximumError, collapse.error);
+			collapsedCount++;
+		}
+
+		if (collapsedCount == 0) break;
+	}
+
+	std::vector<uint32_t> simplified;
+	simplified.reserve(3 * liveTriangleCount);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		if (removed[t]) continue;
+		simplified.insert(simplified.end(), triangles.begin() + 3 * t, triangles.begin() + 3 * t + 3);
+	}
+
+	error = diagonal > 0.0 ? (float)(maximumError / diagonal) : 0.0f;
+	return simplified;
+}
+
+void MeshSimplifier::GenerateLods(MeshData& mesh, unsigned int levelCount, unsigned int threadCount)
+{
+	mesh.lods.clear();
+	size_t triangleCount = mesh.indices.size() / 3;
+	if (levelCount == 0 || triangleCount < MIN_LOD_SOURCE_TRIANGLES)
+	{
+		return;
+	}
+
+	// The levels are independent simplifications of the full mesh, so they can be built at the same time
+	std::vector<std::vector<uint32_t>> levels(levelCount);
+	std::vector<float> errors(levelCount);
+	ThreadPool::GetShared().ParallelFor(levelCount, [&](size_t level)
+	{
+		size_t targetTriangles = (size_t)(triangleCount * std::pow(LOD_REDUCTION, (float)(level + 1)));
+		if (targetTriangles < MIN_LOD_TRIANGLES) return;
+
+		levels[level] = Simplify(mesh.indices, mesh.vertices, 3 * targetTriangles, errors[level]);
+		MeshOptimizer::OptimizeVertexCache(levels[level], mesh.vertices.size());
+	}, threadCount);
+
+	MeshLod fullMesh = { 0, (uint32_t)mesh.indices.size(), 0.0f };
+	mesh.lods.push_back(fullMesh);
+	for (unsigned int level = 0; level < levelCount; level++)
+	{
+		// Skip levels that the seams/borders kept from getting much smaller than the previous one
+		const MeshLod& previous = mesh.lods.back();
+		if (levels[level].empty() || levels[level].size() > previous.indexCount * 3 / 4)
+		{
+			continue;
+		}
+
+		MeshLod lod = { (uint32_t)mesh.indices.size(), (uint32_t)levels[level].size(), std::max(errors[level], previous.error) };
+		mesh.indices.insert(mesh.indices.end(), levels[level].begin(), levels[level].end());
+		mesh.lods.push_back(lod);
+	}
+
+	if (mesh.lods.size() == 1)
+	{
+		mesh.lods.clear();
+	}
+}
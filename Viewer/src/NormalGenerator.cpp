@@ -0,0 +1,309 @@
+#include "NormalGenerator.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+// Faces/vertices handed to a thread at a time
+static constexpr size_t NORMAL_BATCH_SIZE = 16384;
+
+static size_t getBatchCount(size_t count)
+{
+	return (count + NORMAL_BATCH_SIZE - 1) / NORMAL_BATCH_SIZE;
+}
+
+static glm::vec3 normalizeOrZero(const glm::vec3& vector)
+{
+	// Written to select the scale instead of the result, so it compiles without a branch
+	float lengthSquared = glm::dot(vector, vector);
+	float scale = lengthSquared > 0.0f ? 1.0f / std::sqrt(lengthSquared) : 0.0f;
+	return vector * scale;
+}
+
+// Angle between two edges leaving the same corner
+static float getCornerAngle(const glm::vec3& edge0, const glm::vec3& edge1)
+{
+	float cosine = glm::dot(normalizeOrZero(edge0), normalizeOrZero(edge1));
+	return std::acos(std::min(1.0f, std::max(-1.0f, cosine)));
+}
+
+// Adds the weighted normal of every face to the sums of its vertices. The weighting is a template argument
+// so the loop has no branches left in it.
+template <NormalWeighting weighting>
+static void sumFaceNormals(const std::vector<glm::vec3>& vertices, const std::vector<Face>& faces, size_t firstFace, size_t lastFace, glm::vec3* sums, int firstVertex)
+{
+	for (size_t i = firstFace; i < lastFace; i++)
+	{
+		int index0 = faces[i].GetVertexIndex(0) - 1;
+		int index1 = faces[i].GetVertexIndex(1) - 1;
+		int index2 = faces[i].GetVertexIndex(2) - 1;
+		const glm::vec3& v0 = vertices[index0];
+		const glm::vec3& v1 = vertices[index1];
+		const glm::vec3& v2 = vertices[index2];
+
+		// Same orientation as the viewer always used
+		glm::vec3 cross = -glm::cross(v0 - v1, v2 - v1);
+		if (weighting == NormalWeighting::Area)
+		{
+			// The length of the cross product is twice the area, so it's already weighted
+			sums[index0 - firstVertex] += cross;
+			sums[index1 - firstVertex] += cross;
+			sums[index2 - firstVertex] += cross;
+		}
+		else if (weighting == NormalWeighting::Angle)
+		{
+			glm::vec3 faceNormal = normalizeOrZero(cross);
+			sums[index0 - firstVertex] += faceNormal * getCornerAngle(v1 - v0, v2 - v0);
+			sums[index1 - firstVertex] += faceNormal * getCornerAngle(v2 - v1, v0 - v1);
+			sums[index2 - firstVertex] += faceNormal * getCornerAngle(v0 - v2, v1 - v2);
+		}
+		else
+		{
+			glm::vec3 faceNormal = normalizeOrZero(cross);
+			sums[index0 - firstVertex] += faceNormal;
+			sums[index1 - firstVertex] += faceNormal;
+			sums[index2 - firstVertex] += faceNormal;
+		}
+	}
+}
+
+void NormalGenerator::computeFaceNormals(const std::vector<glm::vec3>& vertices, const std::vector<Face>& faces,
+	NormalWeighting weighting, FaceNormals& faceNormals, unsigned int threadCount)
+{
+	faceNormals.normals.resize(faces.size());
+	faceNormals.cornerWeights.resize(weighting == NormalWeighting::Average ? 0 : 3 * faces.size());
+
+	ThreadPool::GetShared().ParallelFor(getBatchCount(faces.size()), [&](size_t batch)
+	{
+		size_t end = std::min(faces.size(), (batch + 1) * NORMAL_BATCH_SIZE);
+		for (size_t i = batch * NORMAL_BATCH_SIZE; i < end; i++)
+		{
+			const Face& face = faces[i];
+			const glm::vec3& v0 = vertices[face.GetVertexIndex(0) - 1];
+			const glm::vec3& v1 = vertices[face.GetVertexIndex(1) - 1];
+			const glm::vec3& v2 = vertices[face.GetVertexIndex(2) - 1];
+
+			// Same orientation as the viewer always used
+			glm::vec3 cross = -glm::cross(v0 - v1, v2 - v1);
+			faceNormals.normals[i] = normalizeOrZero(cross);
+
+			if (weighting == NormalWeighting::Area)
+			{
+				float area = 0.5f * std::sqrt(glm::dot(cross, cross));
+				faceNormals.cornerWeights[3 * i + 0] = area;
+				faceNormals.cornerWeights[3 * i + 1] = area;
+				faceNormals.cornerWeights[3 * i + 2] = area;
+			}
+			else if (weighting == NormalWeighting::Angle)
+			{
+				faceNormals.cornerWeights[3 * i + 0] = getCornerAngle(v1 - v0, v2 - v0);
+				faceNormals.cornerWeights[3 * i + 1] = getCornerAngle(v2 - v1, v0 - v1);
+				faceNormals.cornerWeights[3 * i + 2] = getCornerAngle(v0 - v2, v1 - v2);
+			}
+		}
+	}, threadCount);
+}
+
+void NormalGenerator::collectVertexCorners(size_t vertexCount, const std::vector<Face>& faces, VertexCorners& vertexCorners)
+{
+	std::vector<uint32_t>& offsets = vertexCorners.offsets;
+	offsets.assign(vertexCount + 1, 0);
+
+	// Count the corners of every vertex. This is also the one place the indices are validated.
+	for (const Face& face : faces)
+	{
+		for (int corner = 0; corner < 3; corner++)
+		{
+			int vertexIndex = face.GetVertexIndex(corner) - 1;
+			if (vertexIndex < 0 || (size_t)vertexIndex >= vertexCount)
+			{
+				throw std::out_of_range("Face refers to a vertex that doesn't exist");
+			}
+			offsets[vertexIndex + 1]++;
+		}
+	}
+
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		offsets[i + 1] += offsets[i];
+	}
+
+	// Scatter the corners, using the offsets as write cursors. Afterwards every cursor points at the start
+	// of the next vertex, so shifting them by one restores the offsets.
+	vertexCorners.corners.resize(3 * faces.size());
+	for (uint32_t i = 0; i < (uint32_t)faces.size(); i++)
+	{
+		for (uint32_t corner = 0; corner < 3; corner++)
+		{
+			uint32_t vertexIndex = (uint32_t)faces[i].GetVertexIndex(corner) - 1;
+			vertexCorners.corners[offsets[vertexIndex]++] = 3 * i + corner;
+		}
+	}
+
+	for (size_t i = vertexCount; i > 0; i--)
+	{
+		offsets[i] = offsets[i - 1];
+	}
+	offsets[0] = 0;
+}
+
+std::vector<glm::vec3> NormalGenerator::Generate(const std::vector<glm::vec3>& vertices, const std::vector<Face>& faces,
+	NormalWeighting weighting, unsigned int threadCount)
+{
+	unsigned int concurrency = ThreadPool::GetShared().GetConcurrency();
+	size_t partCount = std::max<size_t>(1, std::min<size_t>(threadCount == 0 ? concurrency : std::min(threadCount, concurrency), getBatchCount(faces.size())));
+
+	// Every part sums the normals of a contiguous range of faces. Faces that are close in the file mostly use
+	// vertices that are close too, so a part only needs sums for the vertex range its faces touch.
+	std::vector<PartialSums> parts(partCount);
+	ThreadPool::GetShared().ParallelFor(partCount, [&](size_t i)
+	{
+		accumulatePart(vertices, faces, faces.size() * i / partCount, faces.size() * (i + 1) / partCount, weighting, parts[i]);
+	}, threadCount);
+
+	std::vector<glm::vec3> normals(vertices.size());
+	ThreadPool::GetShared().ParallelFor(getBatchCount(vertices.size()), [&](size_t batch)
+	{
+		size_t begin = batch * NORMAL_BATCH_SIZE;
+		size_t end = std::min(vertices.size(), begin + NORMAL_BATCH_SIZE);
+
+		std::vector<const PartialSums*> overlappingParts;
+		for (const PartialSums& part : parts)
+		{
+			if (!part.sums.empty() && part.firstVertex < end && part.firstVertex + part.sums.size() > begin)
+			{
+				overlappingParts.push_back(&part);
+			}
+		}
+
+		for (size_t i = begin; i < end; i++)
+		{
+			glm::vec3 sum(0.0f);
+			for (const PartialSums* part : overlappingParts)
+			{
+				if (i >= part->firstVertex && i < part->firstVertex + part->sums.size())
+				{
+					sum += part->sums[i - part->firstVertex];
+				}
+			}
+			normals[i] = normalizeOrZero(sum);
+		}
+	}, threadCount);
+
+	return normals;
+}
+
+void NormalGenerator::accumulatePart(const std::vector<glm::vec3>& vertices, const std::vector<Face>& faces,
+	size_t firstFace, size_t lastFace, NormalWeighting weighting, PartialSums& part)
+{
+	if (firstFace == lastFace)
+	{
+		return;
+	}
+
+	int minimumIndex = faces[firstFace].GetVertexIndex(0);
+	int maximumIndex = minimumIndex;
+	for (size_t i = firstFace; i < lastFace; i++)
+	{
+		for (int corner = 0; corner < 3; corner++)
+		{
+			minimumIndex = std::min(minimumIndex, faces[i].GetVertexIndex(corner));
+			maximumIndex = std::max(maximumIndex, faces[i].GetVertexIndex(corner));
+		}
+	}
+
+	if (minimumIndex < 1 || (size_t)maximumIndex > vertices.size())
+	{
+		// ParallelFor rethrows it in Generate
+		throw std::out_of_range("Face refers to a vertex that doesn't exist");
+	}
+
+	part.firstVertex = (size_t)minimumIndex - 1;
+	part.sums.assign((size_t)(maximumIndex - minimumIndex) + 1, glm::vec3(0.0f));
+
+	switch (weighting)
+	{
+	case NormalWeighting::Area:  sumFaceNormals<NormalWeighting::Area>(vertices, faces, firstFace, lastFace, part.sums.data(), (int)part.firstVertex);    break;
+	case NormalWeighting::Angle: sumFaceNormals<NormalWeighting::Angle>(vertices, faces, firstFace, lastFace, part.sums.data(), (int)part.firstVertex);   break;
+	default:                     sumFaceNormals<NormalWeighting::Average>(vertices, faces, firstFace, lastFace, part.sums.data(), (int)part.firstVertex); break;
+	}
+}
+
+std::vector<glm::vec3> NormalGenerator::GenerateWithCreases(const std::vector<glm::vec3>& vertices, std::vector<Face>& faces,
+	float creaseAngle, NormalWeighting weighting, unsigned int threadCount)
+{
+	VertexCorners vertexCorners;
+	collectVertexCorners(vertices.size(), faces, vertexCorners);
+
+	FaceNormals faceNormals;
+	computeFaceNormals(vertices, faces, weighting, faceNormals, threadCount);
+
+	const float pi = 3.14159265358979f;
+	float minimumCosine = std::cos(std::min(creaseAngle, 180.0f) * pi / 180.0f);
+
+	// Normal of every corner (in vertexCorners order), and its index among the distinct normals of its vertex
+	std::vector<glm::vec3> cornerNormals(vertexCorners.corners.size());
+	std::vector<uint32_t> localIndices(vertexCorners.corners.size());
+	std::vector<uint32_t> normalOffsets(vertices.size() + 1, 0);
+
+	ThreadPool::GetShared().ParallelFor(getBatchCount(vertices.size()), [&](size_t batch)
+	{
+		size_t end = std::min(vertices.size(), (batch + 1) * NORMAL_BATCH_SIZE);
+		for (size_t i = batch * NORMAL_BATCH_SIZE; i < end; i++)
+		{
+			uint32_t begin = vertexCorners.offsets[i];
+			uint32_t finish = vertexCorners.offsets[i + 1];
+			uint32_t distinctNormals = 0;
+
+			for (uint32_t k = begin; k < finish; k++)
+			{
+				// Smooth with every face that isn't across a crease. Degenerate faces have no direction
+				// of their own, so they just take the fully smoothed normal.
+				const glm::vec3& faceNormal = faceNormals.normals[vertexCorners.corners[k] / 3];
+				bool degenerate = glm::dot(faceNormal, faceNormal) == 0.0f;
+
+				glm::vec3 sum(0.0f);
+				for (uint32_t j = begin; j < finish; j++)
+				{
+					uint32_t corner = vertexCorners.corners[j];
+					if (degenerate || glm::dot(faceNormal, faceNormals.normals[corner / 3]) >= minimumCosine)
+					{
+						sum += faceNormals.GetContribution(corner);
+					}
+				}
+				cornerNormals[k] = normalizeOrZero(sum);
+
+				// Corners in the same smoothing group end up with the same normal, share it
+				uint32_t j = begin;
+				while (j < k && cornerNormals[j] != cornerNormals[k]) j++;
+				localIndices[k] = j < k ? localIndices[j] : distinctNormals++;
+			}
+
+			normalOffsets[i + 1] = distinctNormals;
+		}
+	}, threadCount);
+
+	for (size_t i = 0; i < vertices.size(); i++)
+	{
+		normalOffsets[i + 1] += normalOffsets[i];
+	}
+
+	// Every corner belongs to exactly one vertex, so the faces can be rewritten in parallel too
+	std::vector<glm::vec3> normals(normalOffsets[vertices.size()]);
+	ThreadPool::GetShared().ParallelFor(getBatchCount(vertices.size()), [&](size_t batch)
+	{
+		size_t end = std::min(vertices.size(), (batch + 1) * NORMAL_BATCH_SIZE);
+		for (size_t i = batch * NORMAL_BATCH_SIZE; i < end; i++)
+		{
+			for (uint32_t k = vertexCorners.offsets[i]; k < vertexCorners.offsets[i + 1]; k++)
+			{
+				uint32_t normalIndex = normalOffsets[i] + localIndices[k];
+				uint32_t corner = vertexCorners.corners[k];
+				normals[normalIndex] = cornerNormals[k];
+				faces[corner / 3].SetNormalIndex(corner % 3, (int)normalIndex + 1);
+			}
+		}
+	}, threadCount);
+
+	return normals;
+}
@@ -0,0 +1,433 @@
+#include "ObjParser.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+// Every power of ten up to 1e22 is exactly representable as a double
+static const double exactPowersOfTen[] = {
+	1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static constexpr int MAX_EXACT_POWER_OF_TEN = 22;
+static constexpr uint64_t MAX_EXACT_MANTISSA = uint64_t(1) << 53;
+static constexpr int MAX_MANTISSA_DIGITS = 19;
+
+// Chunks smaller than this aren't worth handing to another thread
+static constexpr size_t MIN_CHUNK_BYTES = 256 * 1024;
+
+// Bits of RelativeFace::cornerMask
+static constexpr int VERTEX_INDEX_KIND = 0;
+static constexpr int TEXTURE_INDEX_KIND = 1;
+static constexpr int NORMAL_INDEX_KIND = 2;
+
+static inline bool isSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+}
+
+static inline bool isDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+// Rounding a double to a float is only ambiguous when the double sits exactly halfway
+// between two floats (the 29 bits that get dropped are 1000...0).
+static inline bool isFloatMidpoint(double value)
+{
+	uint64_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	return (bits & 0x1FFFFFFFull) == 0x10000000ull;
+}
+
+bool ObjParser::ParseFile(const std::string& filePath, ObjData& data, ObjParseStatistics& statistics, unsigned int threadCount)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+
+	MappedFile file;
+	if (!file.Open(filePath))
+	{
+		return false;
+	}
+
+	Parse(file.GetData(), file.GetEnd(), data, threadCount);
+
+	auto finish = std::chrono::high_resolution_clock::now();
+	std::chrono::duration<double> elapsed = finish - start;
+	statistics.bytes = file.GetSize();
+	statistics.seconds = elapsed.count();
+	return true;
+}
+
+void ObjParser::Parse(const char* begin, const char* end, ObjData& data, unsigned int threadCount)
+{
+	size_t size = end - begin;
+	size_t chunkCount = threadCount == 0 ? ThreadPool::GetShared().GetConcurrency() : threadCount;
+	chunkCount = std::max<size_t>(1, std::min(chunkCount, size / MIN_CHUNK_BYTES));
+
+	// Split the file into chunks of about the same size that all end right after a newline
+	std::vector<Chunk> chunks(chunkCount);
+	const char* chunkBegin = begin;
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		const char* chunkEnd = end;
+		if (i + 1 < chunkCount)
+		{
+			const char* guess = std::max(chunkBegin, begin + size / chunkCount * (i + 1));
+			const char* newline = (const char*)std::memchr(guess, '\n', end - guess);
+			chunkEnd = newline != nullptr ? newline + 1 : end;
+		}
+
+		chunks[i].begin = chunkBegin;
+		chunks[i].end = chunkEnd;
+		chunkBegin = chunkEnd;
+	}
+
+	ThreadPool::GetShared().ParallelFor(chunkCount, [&chunks](size_t i) { parseChunk(chunks[i]); }, (unsigned int)chunkCount);
+	mergeChunks(chunks, data, (unsigned int)chunkCount);
+}
+
+void ObjParser::parseChunk(Chunk& chunk)
+{
+	const char* cursor = chunk.begin;
+	while (cursor < chunk.end)
+	{
+		const char* lineEnd = (const char*)std::memchr(cursor, '\n', chunk.end - cursor);
+		if (lineEnd == nullptr)
+		{
+			lineEnd = chunk.end;
+		}
+
+		cursor = skipSpaces(cursor, lineEnd);
+		if (cursor != lineEnd)
+		{
+			parseLine(cursor, lineEnd, chunk);
+		}
+
+		cursor = lineEnd + 1;
+	}
+}
+
+void ObjParser::mergeChunks(std::vector<Chunk>& chunks, ObjData& data, unsigned int threadCount)
+{
+	// Prefix sums over the element counts: where each chunk's elements start in the merged arrays.
+	// Those are also the offsets that turn the chunk relative indices into global ones.
+	size_t chunkCount = chunks.size();
+	std::vector<size_t> vertexOffsets(chunkCount + 1, 0);
+	std::vector<size_t> normalOffsets(chunkCount + 1, 0);
+	std::vector<size_t> textureOffsets(chunkCount + 1, 0);
+	std::vector<size_t> faceOffsets(chunkCount + 1, 0);
+	size_t unknownLines = 0;
+
+	for (size_t i = 0; i < chunkCount; i++)
+	{
+		vertexOffsets[i + 1]  = vertexOffsets[i]  + chunks[i].data.vertices.size();
+		normalOffsets[i + 1]  = normalOffsets[i]  + chunks[i].data.normals.size();
+		textureOffsets[i + 1] = textureOffsets[i] + chunks[i].data.textureCoords.size();
+		faceOffsets[i + 1]    = faceOffsets[i]    + chunks[i].data.faces.size();
+		unknownLines += chunks[i].data.unknownLines;
+	}
+
+	auto resolveRelativeFaces = [&](size_t i)
+	{
+		int offsets[3];
+		offsets[VERTEX_INDEX_KIND]  = (int)vertexOffsets[i];
+		offsets[TEXTURE_INDEX_KIND] = (int)textureOffsets[i];
+		offsets[NORMAL_INDEX_KIND]  = (int)normalOffsets[i];
+
+		for (const RelativeFace& relativeFace : chunks[i].relativeFaces)
+		{
+			Face& face = chunks[i].data.faces[relativeFace.faceIndex];
+			for (int corner = 0; corner < 3; corner++)
+			{
+				if (relativeFace.cornerMask & (1u << (3 * VERTEX_INDEX_KIND + corner)))
+					face.SetVertexIndex(corner, face.GetVertexIndex(corner) + offsets[VERTEX_INDEX_KIND]);
+				if (relativeFace.cornerMask & (1u << (3 * TEXTURE_INDEX_KIND + corner)))
+					face.SetTextureIndex(corner, face.GetTextureIndex(corner) + offsets[TEXTURE_INDEX_KIND]);
+				if (relativeFace.cornerMask & (1u << (3 * NORMAL_INDEX_KIND + corner)))
+					face.SetNormalIndex(corner, face.GetNormalIndex(corner) + offsets[NORMAL_INDEX_KIND]);
+			}
+		}
+	};
+
+	if (chunkCount == 1)
+	{
+		resolveRelativeFaces(0);
+		data = std::move(chunks[0].data);
+		return;
+	}
+
+	data.vertices.resize(vertexOffsets[chunkCount]);
+	data.normals.resize(normalOffsets[chunkCount]);
+	data.textureCoords.resize(textureOffsets[chunkCount]);
+	data.faces.resize(faceOffsets[chunkCount]);
+	data.unknownLines = unknownLines;
+
+	ThreadPool::GetShared().ParallelFor(chunkCount, [&](size_t i)
+	{
+		ObjData& chunkData = chunks[i].data;
+		resolveRelativeFaces(i);
+		std::copy(chunkData.vertices.begin(), chunkData.vertices.end(), data.vertices.begin() + vertexOffsets[i]);
+		std::copy(chunkData.normals.begin(), chunkData.normals.end(), data.normals.begin() + normalOffsets[i]);
+		std::copy(chunkData.textureCoords.begin(), chunkData.textureCoords.end(), data.textureCoords.begin() + textureOffsets[i]);
+		std::copy(chunkData.faces.begin(), chunkData.faces.end(), data.faces.begin() + faceOffsets[i]);
+	}, threadCount);
+}
+
+void ObjParser::parseLine(const char* cursor, const char* lineEnd, Chunk& chunk)
+{
+	// read the type of the line
+	const char* typeEnd = cursor;
+	while (typeEnd != lineEnd && !isSpace(*typeEnd))
+	{
+		typeEnd++;
+	}
+	size_t typeLength = typeEnd - cursor;
+
+	// based on the type parse data
+	if (typeLength == 1 && cursor[0] == 'v')
+	{
+		float x, y, z;
+		typeEnd = parseFloat(typeEnd, lineEnd, x);
+		typeEnd = parseFloat(typeEnd, lineEnd, y);
+		parseFloat(typeEnd, lineEnd, z);
+		chunk.data.vertices.push_back(glm::vec3(x, y, z));
+	}
+	else if (typeLength == 2 && cursor[0] == 'v' && cursor[1] == 'n')
+	{
+		float x, y, z;
+		typeEnd = parseFloat(typeEnd, lineEnd, x);
+		typeEnd = parseFloat(typeEnd, lineEnd, y);
+		parseFloat(typeEnd, lineEnd, z);
+		chunk.data.normals.push_back(glm::vec3(x, y, z));
+	}
+	else if (typeLength == 2 && cursor[0] == 'v' && cursor[1] == 't')
+	{
+		float x, y;
+		typeEnd = parseFloat(typeEnd, lineEnd, x);
+		parseFloat(typeEnd, lineEnd, y);
+		chunk.data.textureCoords.push_back(glm::vec2(x, y));
+	}
+	else if (typeLength == 1 && cursor[0] == 'f')
+	{
+		parseFace(typeEnd, lineEnd, chunk);
+	}
+	else if (cursor[0] == '#')
+	{
+		// comment
+	}
+	else
+	{
+		chunk.data.unknownLines++;
+	}
+}
+
+// Accepts the "v", "v/t", "v//n" and "v/t/n" forms and reads the first three corners of the face
+const char* ObjParser::parseFace(const char* cursor, const char* lineEnd, Chunk& chunk)
+{
+	int vertexIndices[3]  = { 0, 0, 0 };
+	int normalIndices[3]  = { 0, 0, 0 };
+	int textureIndices[3] = { 0, 0, 0 };
+
+	for (int i = 0; i < 3; i++)
+	{
+		cursor = parseInt(cursor, lineEnd, vertexIndices[i]);
+		cursor = skipSpaces(cursor, lineEnd);
+
+		if (cursor == lineEnd || *cursor != '/')
+		{
+			continue;
+		}
+
+		cursor = skipSpaces(cursor + 1, lineEnd);
+
+		if (cursor != lineEnd && *cursor == '/')
+		{
+			cursor = parseInt(cursor + 1, lineEnd, normalIndices[i]);
+			continue;
+		}
+		else
+		{
+			cursor = parseInt(cursor, lineEnd, textureIndices[i]);
+		}
+
+		if (cursor == lineEnd || *cursor != '/')
+		{
+			continue;
+		}
+
+		cursor = parseInt(cursor + 1, lineEnd, normalIndices[i]);
+	}
+
+	// Negative indices count back from the last element parsed so far (-1 is the last one).
+	// Turn them into 1-based indices within this chunk; mergeChunks adds the chunk's offset.
+	int* indices[3];
+	size_t counts[3];
+	indices[VERTEX_INDEX_KIND]  = vertexIndices;
+	indices[TEXTURE_INDEX_KIND] = textureIndices;
+	indices[NORMAL_INDEX_KIND]  = normalIndices;
+	counts[VERTEX_INDEX_KIND]  = chunk.data.vertices.size();
+	counts[TEXTURE_INDEX_KIND] = chunk.data.textureCoords.size();
+	counts[NORMAL_INDEX_KIND]  = chunk.data.normals.size();
+
+	unsigned int cornerMask = 0;
+	for (int kind = 0; kind < 3; kind++)
+	{
+		for (int corner = 0; corner < 3; corner++)
+		{
+			if (indices[kind][corner] < 0)
+			{
+				indices[kind][corner] += (int)counts[kind] + 1;
+				cornerMask |= 1u << (3 * kind + corner);
+			}
+		}
+	}
+
+	if (cornerMask != 0)
+	{
+		chunk.relativeFaces.push_back({ chunk.data.faces.size(), cornerMask });
+	}
+
+	chunk.data.faces.emplace_back(vertexIndices, normalIndices, textureIndices);
+	return cursor;
+}
+
+const char* ObjParser::parseInt(const char* cursor, const char* lineEnd, int& value)
+{
+	cursor = skipSpaces(cursor, lineEnd);
+
+	bool negative = false;
+	if (cursor != lineEnd && (*cursor == '-' || *cursor == '+'))
+	{
+		negative = *cursor == '-';
+		cursor++;
+	}
+
+	int result = 0;
+	while (cursor != lineEnd && isDigit(*cursor))
+	{
+		result = result * 10 + (*cursor - '0');
+		cursor++;
+	}
+
+	value = negative ? -result : result;
+	return cursor;
+}
+
+const char* ObjParser::parseFloat(const char* cursor, const char* lineEnd, float& value)
+{
+	cursor = skipSpaces(cursor, lineEnd);
+	const char* start = cursor;
+
+	bool negative = false;
+	if (cursor != lineEnd && (*cursor == '-' || *cursor == '+'))
+	{
+		negative = *cursor == '-';
+		cursor++;
+	}
+
+	// Collect the decimal digits as an integer mantissa and a power of ten
+	uint64_t mantissa = 0;
+	int significantDigits = 0;
+	int exponent = 0;
+	bool anyDigits = false;
+	bool truncated = false;
+
+	while (cursor != lineEnd && isDigit(*cursor))
+	{
+		if (significantDigits < MAX_MANTISSA_DIGITS)
+		{
+			mantissa = mantissa * 10 + (*cursor - '0');
+			if (mantissa != 0) significantDigits++;
+		}
+		else
+		{
+			truncated = true;
+		}
+		anyDigits = true;
+		cursor++;
+	}
+
+	if (cursor != lineEnd && *cursor == '.')
+	{
+		cursor++;
+		while (cursor != lineEnd && isDigit(*cursor))
+		{
+			if (significantDigits < MAX_MANTISSA_DIGITS)
+			{
+				mantissa = mantissa * 10 + (*cursor - '0');
+				if (mantissa != 0) significantDigits++;
+				exponent--;
+			}
+			else
+			{
+				truncated = true;
+			}
+			anyDigits = true;
+			cursor++;
+		}
+	}
+
+	// The exponent is only part of the number if at least one digit follows the 'e'
+	if (anyDigits && cursor != lineEnd && (*cursor == 'e' || *cursor == 'E'))
+	{
+		const char* exponentCursor = cursor + 1;
+		bool negativeExponent = false;
+		if (exponentCursor != lineEnd && (*exponentCursor == '-' || *exponentCursor == '+'))
+		{
+			negativeExponent = *exponentCursor == '-';
+			exponentCursor++;
+		}
+
+		if (exponentCursor != lineEnd && isDigit(*exponentCursor))
+		{
+			int explicitExponent = 0;
+			while (exponentCursor != lineEnd && isDigit(*exponentCursor))
+			{
+				if (explicitExponent < 100000) explicitExponent = explicitExponent * 10 + (*exponentCursor - '0');
+				exponentCursor++;
+			}
+			exponent += negativeExponent ? -explicitExponent : explicitExponent;
+			cursor = exponentCursor;
+		}
+	}
+
+	// Fast path: both the mantissa and the power of ten are exact doubles, so a single
+	// multiplication/division is correctly rounded. Converting that double to a float is
+	// correctly rounded too, unless the double landed exactly on a float midpoint.
+	if (anyDigits && !truncated && mantissa <= MAX_EXACT_MANTISSA &&
+		exponent >= -MAX_EXACT_POWER_OF_TEN && exponent <= MAX_EXACT_POWER_OF_TEN)
+	{
+		double result = (double)mantissa;
+		result = exponent < 0 ? result / exactPowersOfTen[-exponent] : result * exactPowersOfTen[exponent];
+
+		if (!isFloatMidpoint(result))
+		{
+			value = negative ? -(float)result : (float)result;
+			return cursor;
+		}
+	}
+
+	// Slow path: let the C library do the rounding on a null terminated copy of the token
+	char buffer[128];
+	size_t length = std::min(size_t(lineEnd - start), sizeof(buffer) - 1);
+	std::memcpy(buffer, start, length);
+	buffer[length] = '\0';
+
+	char* parsedEnd = nullptr;
+	value = std::strtof(buffer, &parsedEnd);
+	return start + (parsedEnd - buffer);
+}
+
+const char* ObjParser::skipSpaces(const char* cursor, const char* lineEnd)
+{
+	while (cursor != lineEnd && isSpace(*cursor))
+	{
+		cursor++;
+	}
+	return cursor;
+}
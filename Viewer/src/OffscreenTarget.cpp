@@ -0,0 +1,100 @@
+#include "OffscreenTarget.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+//-----------------------------------------------------------------------------
+// Constructor
+//-----------------------------------------------------------------------------
+OffscreenTarget::OffscreenTarget()
+	: framebuffer(0), colorBuffer(0), depthBuffer(0), width(0), height(0)
+{
+}
+
+//-----------------------------------------------------------------------------
+// Destructor
+//-----------------------------------------------------------------------------
+OffscreenTarget::~OffscreenTarget()
+{
+	glDeleteFramebuffers(1, &framebuffer);
+	glDeleteRenderbuffers(1, &colorBuffer);
+	glDeleteRenderbuffers(1, &depthBuffer);
+}
+
+//-----------------------------------------------------------------------------
+// Allocates the renderbuffers and attaches them
+//-----------------------------------------------------------------------------
+bool OffscreenTarget::Create(int width, int height)
+{
+	this->width = width;
+	this->height = height;
+
+	if (framebuffer == 0)
+	{
+		glGenFramebuffers(1, &framebuffer);
+		glGenRenderbuffers(1, &colorBuffer);
+		glGenRenderbuffers(1, &depthBuffer);
+	}
+
+	glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cerr << "Offscreen framebuffer of " << width << "x" << height << " is incomplete (status 0x" << std::hex << status << std::dec << ")" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+//-----------------------------------------------------------------------------
+// Makes it the target of the draws
+//-----------------------------------------------------------------------------
+void OffscreenTarget::Bind() const
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, width, height);
+}
+
+//-----------------------------------------------------------------------------
+// Reads the color buffer back, waiting for the frame to finish
+//-----------------------------------------------------------------------------
+void OffscreenTarget::ReadPixels(std::vector<unsigned char>& rgba) const
+{
+	size_t rowBytes = (size_t)width * 4;
+	rgba.resize(rowBytes * height);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+
+	// OpenGL returns the bottom row first, swap the rows in place
+	std::vector<unsigned char> row(rowBytes);
+	for (int top = 0, bottom = height - 1; top < bottom; top++, bottom--)
+	{
+		std::memcpy(row.data(), rgba.data() + top * rowBytes, rowBytes);
+		std::memcpy(rgba.data() + top * rowBytes, rgba.data() + bottom * rowBytes, rowBytes);
+		std::memcpy(rgba.data() + bottom * rowBytes, row.data(), rowBytes);
+	}
+}
+
+void OffscreenTarget::ReadDepth(std::vector<float>& depth) const
+{
+	depth.resize((size_t)width * height);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_DEPTH_COMPONENT, GL_FLOAT, depth.data());
+
+	for (int top = 0, bottom = height - 1; top < bottom; top++, bottom--)
+	{
+		std::swap_ranges(depth.begin() + (size_t)top * width, depth.begin() + (size_t)(top + 1) * width, depth.begin() + (size_t)bottom * width);
+	}
+}
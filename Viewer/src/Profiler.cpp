@@ -0,0 +1,383 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+
+Profiler::Profiler() :
+	enabled(true),
+	startTime(0),
+	inFrame(false),
+	frameStart(0),
+	frameFirstEvent(0),
+	gpuTimer(false),
+	gpuQueriesCreated(false),
+	gpuFrames{},
+	gpuFrameIndex(0),
+	gpuDepth(0),
+	gpuEventsWritten(0)
+{
+	startTime = Now();
+}
+
+Profiler& Profiler::Get()
+{
+	// Shared by every thread, only the render thread (the one with the context) measures GPU zones
+	static Profiler profiler;
+	return profiler;
+}
+
+int64_t Profiler::Now() const
+{
+	// The steady clock, so the GPU clock offsets stay valid
+	int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	return now - startTime;
+}
+
+Profiler::ThreadBuffer& Profiler::getThreadBuffer()
+{
+	static thread_local ThreadBuffer* threadBuffer = nullptr;
+	if (threadBuffer == nullptr)
+	{
+		std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer());
+		buffer->events.reset(new ProfilerEvent[PROFILER_EVENTS_PER_THREAD]);
+		buffer->written = 0;
+		buffer->depth = 0;
+
+		std::lock_guard<std::mutex> lock(threadsMutex);
+		buffer->thread = (uint32_t)threads.size() + 1;
+		buffer->name = "Thread " + std::to_string(buffer->thread);
+		threadBuffer = buffer.get();
+		threads.push_back(std::move(buffer));
+	}
+	return *threadBuffer;
+}
+
+void Profiler::SetThreadName(const std::string& name)
+{
+	ThreadBuffer& buffer = getThreadBuffer();
+	std::lock_guard<std::mutex> lock(threadsMutex);
+	buffer.name = name;
+}
+
+void Profiler::record(ThreadBuffer& buffer, const char* name, int64_t start, int64_t end, uint32_t depth)
+{
+	// Only this thread writes the ring, publishing the count is enough for the readers
+	uint64_t index = buffer.written.load(std::memory_order_relaxed);
+	buffer.events[index % PROFILER_EVENTS_PER_THREAD] = ProfilerEvent{ name, start, end, depth, buffer.thread };
+	buffer.written.store(index + 1, std::memory_order_release);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Frames
+//---------------------------------------------------------------------------------------------------------------------
+
+void Profiler::BeginFrame()
+{
+	if (!IsEnabled())
+	{
+		return;
+	}
+
+	ThreadBuffer& buffer = getThreadBuffer();
+	if (buffer.name.compare(0, 7, "Thread ") == 0)
+	{
+		SetThreadName("Render");
+	}
+
+	inFrame = true;
+	frameStart = Now();
+	frameFirstEvent = buffer.written.load(std::memory_order_relaxed);
+	buffer.depth++;
+
+	if (!gpuQueriesCreated)
+	{
+		createGpuQueries();
+	}
+	if (!gpuTimer)
+	{
+		return;
+	}
+
+	// The frame using these queries ended PROFILER_GPU_LATENCY frames ago
+	GpuFrame& frame = gpuFrames[gpuFrameIndex];
+	if (frame.zones > 0)
+	{
+		resolveGpuFrame(frame);
+	}
+
+	GLint64 gpuTime;
+	glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+	frame.clockOffset = Now() - gpuTime;
+
+	// The frame zone is the first, its end query is written by EndFrame
+	frame.names[0] = "Frame";
+	frame.depths[0] = 0;
+	frame.zones = 1;
+	gpuDepth = 1;
+	glQueryCounter(frame.queries[0], GL_TIMESTAMP);
+}
+
+void Profiler::EndFrame()
+{
+	if (!inFrame)
+	{
+		return;
+	}
+	inFrame = false;
+
+	ThreadBuffer& buffer = getThreadBuffer();
+	buffer.depth--;
+	record(buffer, "Frame", frameStart, Now(), 0);
+
+	if (gpuTimer)
+	{
+		GpuFrame& frame = gpuFrames[gpuFrameIndex];
+		glQueryCounter(frame.queries[1], GL_TIMESTAMP);
+		gpuFrameIndex = (gpuFrameIndex + 1) % (PROFILER_GPU_LATENCY + 1);
+		gpuDepth = 0;
+	}
+
+	// The zones this thread closed during the frame, the frame's own included
+	uint64_t written = buffer.written.load(std::memory_order_relaxed);
+	uint64_t first = std::max(frameFirstEvent, written > PROFILER_EVENTS_PER_THREAD ? written - PROFILER_EVENTS_PER_THREAD : 0);
+	std::vector<ProfilerEvent> events;
+	events.reserve((size_t)(written - first));
+	for (uint64_t i = first; i < written; i++)
+	{
+		events.push_back(buffer.events[i % PROFILER_EVENTS_PER_THREAD]);
+	}
+	sumZones(events, cpuFrame);
+}
+
+void Profiler::sumZones(std::vector<ProfilerEvent>& events, std::vector<ProfilerZoneTime>& zones)
+{
+	// Zones are recorded as they end, the menus list them as they start, parents first
+	std::sort(events.begin(), events.end(), [](const ProfilerEvent& a, const ProfilerEvent& b)
+	{
+		return a.start != b.start ? a.start < b.start : a.depth < b.depth;
+	});
+
+	zones.clear();
+	for (const ProfilerEvent& event : events)
+	{
+		auto zone = std::find_if(zones.begin(), zones.end(), [&event](const ProfilerZoneTime& zone)
+		{
+			return zone.depth == event.depth && std::strcmp(zone.name, event.name) == 0;
+		});
+		if (zone == zones.end())
+		{
+			zones.push_back(ProfilerZoneTime{ event.name, event.depth, 0, 0.0 });
+			zone = zones.end() - 1;
+		}
+		zone->calls++;
+		zone->seconds += (event.end - event.start) / 1e9;
+	}
+}
+
+double Profiler::getSeconds(const std::vector<ProfilerZoneTime>& zones, const char* name)
+{
+	double seconds = 0.0;
+	for (const ProfilerZoneTime& zone : zones)
+	{
+		if (std::strcmp(zone.name, name) == 0)
+		{
+			seconds += zone.seconds;
+		}
+	}
+	return seconds;
+}
+
+double Profiler::GetCpuSeconds(const char* name) const
+{
+	return getSeconds(cpuFrame, name);
+}
+
+double Profiler::GetGpuSeconds(const char* name) const
+{
+	return getSeconds(gpuFrame, name);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// GPU queries
+//---------------------------------------------------------------------------------------------------------------------
+
+void Profiler::createGpuQueries()
+{
+	gpuQueriesCreated = true;
+
+	// Timestamp queries are core since OpenGL 3.3
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	gpuTimer = major > 3 || (major == 3 && minor >= 3);
+	if (!gpuTimer)
+	{
+		return;
+	}
+
+	for (GpuFrame& frame : gpuFrames)
+	{
+		glGenQueries(PROFILER_GPU_ZONES_PER_FRAME * 2, frame.queries);
+		frame.zones = 0;
+	}
+	gpuEvents.resize(PROFILER_EVENTS_PER_THREAD);
+}
+
+void Profiler::resolveGpuFrame(GpuFrame& frame)
+{
+	// The frame zone ends last, if its timestamp is there all of them are. If the GPU is that far behind,
+	// the frame is dropped rather than waited for.
+	GLuint available = GL_FALSE;
+	glGetQueryObjectuiv(frame.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (!available)
+	{
+		frame.zones = 0;
+		return;
+	}
+
+	std::vector<ProfilerEvent> events;
+	events.reserve(frame.zones);
+	for (int i = 0; i < frame.zones; i++)
+	{
+		GLuint64 start, end;
+		glGetQueryObjectui64v(frame.queries[2 * i], GL_QUERY_RESULT, &start);
+		glGetQueryObjectui64v(frame.queries[2 * i + 1], GL_QUERY_RESULT, &end);
+		ProfilerEvent event = { frame.names[i], (int64_t)start + frame.clockOffset, (int64_t)end + frame.clockOffset, frame.depths[i], PROFILER_GPU_THREAD };
+		events.push_back(event);
+		gpuEvents[gpuEventsWritten++ % PROFILER_EVENTS_PER_THREAD] = event;
+	}
+	frame.zones = 0;
+	sumZones(events, gpuFrame);
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Chrome trace
+//---------------------------------------------------------------------------------------------------------------------
+
+static void writeTraceEvent(std::ofstream& file, const ProfilerEvent& event, bool& first)
+{
+	// Zone names are literals in the code, they need no escaping
+	file << (first ? "\n" : ",\n") << "{\"name\":\"" << event.name << "\",\"cat\":\"" << (event.thread == PROFILER_GPU_THREAD ? "GPU" : "CPU")
+		<< "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread << ",\"ts\":" << event.start / 1000.0
+		<< ",\"dur\":" << (event.end - event.start) / 1000.0 << "}";
+	first = false;
+}
+
+static void writeThreadName(std::ofstream& file, uint32_t thread, const std::string& name, bool& first)
+{
+	file << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread
+		<< ",\"args\":{\"name\":\"" << name << "\"}}";
+	first = false;
+}
+
+bool Profiler::ExportChromeTrace(const std::string& filePath)
+{
+	std::ofstream file(filePath);
+	if (!file)
+	{
+		return false;
+	}
+
+	// Microseconds, with the nanoseconds as decimals
+	file << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+	bool first = true;
+
+	if (gpuTimer)
+	{
+		writeThreadName(file, PROFILER_GPU_THREAD, "GPU", first);
+		uint64_t firstEvent = gpuEventsWritten > PROFILER_EVENTS_PER_THREAD ? gpuEventsWritten - PROFILER_EVENTS_PER_THREAD : 0;
+		for (uint64_t i = firstEvent; i < gpuEventsWritten; i++)
+		{
+			writeTraceEvent(file, gpuEvents[i % PROFILER_EVENTS_PER_THREAD], first);
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(threadsMutex);
+	std::vector<ProfilerEvent> events;
+	for (const std::unique_ptr<ThreadBuffer>& buffer : threads)
+	{
+		writeThreadName(file, buffer->thread, buffer->name, first);
+
+		// The other threads keep writing: copy their ring, then keep only what they can't have overwritten meanwhile.
+		// Once the ring is full the oldest slot is also the one being written.
+		uint64_t written = buffer->written.load(std::memory_order_acquire);
+		uint64_t firstEvent = written > PROFILER_EVENTS_PER_THREAD ? written - PROFILER_EVENTS_PER_THREAD : 0;
+		events.clear();
+		for (uint64_t i = firstEvent; i < written; i++)
+		{
+			events.push_back(buffer->events[i % PROFILER_EVENTS_PER_THREAD]);
+		}
+		uint64_t writtenAfter = buffer->written.load(std::memory_order_acquire);
+		uint64_t unsafe = writtenAfter - written + (written >= PROFILER_EVENTS_PER_THREAD ? 1 : 0);
+		size_t overwritten = (size_t)std::min<uint64_t>(events.size(), unsafe);
+		for (size_t i = overwritten; i < events.size(); i++)
+		{
+			writeTraceEvent(file, events[i], first);
+		}
+	}
+
+	file << "\n]}\n";
+	return (bool)file;
+}
+
+//---------------------------------------------------------------------------------------------------------------------
+// Zones
+//---------------------------------------------------------------------------------------------------------------------
+
+ProfileZone::ProfileZone(const char* name) :
+	name(name),
+	start(0),
+	active(Profiler::Get().IsEnabled())
+{
+	if (active)
+	{
+		Profiler::Get().getThreadBuffer().depth++;
+		start = Profiler::Get().Now();
+	}
+}
+
+ProfileZone::~ProfileZone()
+{
+	if (active)
+	{
+		Profiler& profiler = Profiler::Get();
+		int64_t end = profiler.Now();
+		Profiler::ThreadBuffer& buffer = profiler.getThreadBuffer();
+		buffer.depth--;
+		profiler.record(buffer, name, start, end, buffer.depth);
+	}
+}
+
+GpuProfileZone::GpuProfileZone(const char* name) :
+	zone(-1)
+{
+	Profiler& profiler = Profiler::Get();
+	if (!profiler.inFrame || !profiler.gpuTimer)
+	{
+		return;
+	}
+
+	Profiler::GpuFrame& frame = profiler.gpuFrames[profiler.gpuFrameIndex];
+	if (frame.zones == PROFILER_GPU_ZONES_PER_FRAME)
+	{
+		return;
+	}
+
+	zone = frame.zones++;
+	frame.names[zone] = name;
+	frame.depths[zone] = profiler.gpuDepth++;
+	glQueryCounter(frame.queries[2 * zone], GL_TIMESTAMP);
+}
+
+GpuProfileZone::~GpuProfileZone()
+{
+	Profiler& profiler = Profiler::Get();
+	if (zone >= 0 && profiler.inFrame)
+	{
+		Profiler::GpuFrame& frame = profiler.gpuFrames[profiler.gpuFrameIndex];
+		glQueryCounter(frame.queries[2 * zone + 1], GL_TIMESTAMP);
+		profiler.gpuDepth--;
+	}
+}
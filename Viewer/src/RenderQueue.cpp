@@ -0,0 +1,75 @@
+#include "RenderQueue.h"
+#include <algorithm>
+#include <cstring>
+
+uint64_t RenderQueue::MakeKey(unsigned int pass, unsigned int shader, unsigned int texture, unsigned int material, float depth)
+{
+	// Non-negative floats compare like their bit patterns, so the top bits (after the sign) keep the order
+	uint32_t depthBits;
+	depth = std::max(depth, 0.0f);
+	std::memcpy(&depthBits, &depth, sizeof(depthBits));
+	depthBits >>= 31 - SORT_KEY_DEPTH_BITS;
+
+	uint64_t key = pass & ((1u << SORT_KEY_PASS_BITS) - 1);
+	key = (key << SORT_KEY_SHADER_BITS) | (shader & ((1u << SORT_KEY_SHADER_BITS) - 1));
+	key = (key << SORT_KEY_TEXTURE_BITS) | (texture & ((1u << SORT_KEY_TEXTURE_BITS) - 1));
+	key = (key << SORT_KEY_MATERIAL_BITS) | (material & ((1u << SORT_KEY_MATERIAL_BITS) - 1));
+	key = (key << SORT_KEY_DEPTH_BITS) | depthBits;
+	return key;
+}
+
+void RenderQueue::Begin(FrameArena& arena, size_t newCapacity)
+{
+	// The radix sort ping-pongs between two arrays
+	commands = arena.AllocateArray<RenderCommand>(std::max<size_t>(newCapacity, 1));
+	scratch = arena.AllocateArray<RenderCommand>(std::max<size_t>(newCapacity, 1));
+	capacity = newCapacity;
+	count = 0;
+}
+
+void RenderQueue::Add(uint64_t key, uint32_t item)
+{
+	if (count == capacity) return;
+
+	commands[count].key = key;
+	commands[count].item = item;
+	count++;
+}
+
+void RenderQueue::Sort()
+{
+	if (count < 2) return;
+
+	// The histograms of all 8 bytes in one pass over the keys
+	size_t histograms[8][256] = {};
+	for (size_t i = 0; i < count; i++)
+	{
+		uint64_t key = commands[i].key;
+		for (int byte = 0; byte < 8; byte++)
+		{
+			histograms[byte][(key >> (byte * 8)) & 0xFF]++;
+		}
+	}
+
+	for (int byte = 0; byte < 8; byte++)
+	{
+		size_t* histogram = histograms[byte];
+		int shift = byte * 8;
+		if (histogram[(commands[0].key >> shift) & 0xFF] == count) continue;
+
+		// Bucket offsets, then a stable scatter into the other array
+		size_t offset = 0;
+		for (int bucket = 0; bucket < 256; bucket++)
+		{
+			size_t bucketSize = histogram[bucket];
+			histogram[bucket] = offset;
+			offset += bucketSize;
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			scratch[histogram[(commands[i].key >> shift) & 0xFF]++] = commands[i];
+		}
+		std::swap(commands, scratch);
+	}
+}
@@ -4,19 +4,26 @@
 #include "InitShader.h"
 #include "MeshModel.h"
 #include "Utils.h"
+#include "UniformBlocks.h"
+#include "GLStateCache.h"
+#include "MeshAssetCache.h"
+#include "TextureManager.h"
+#include "TextureStreamer.h"
+#include "Profiler.h"
 #include "Vertex.h"
 #include <imgui/imgui.h>
 #include <vector>
 #include <cmath>
 #include <algorithm>
 #include <iostream>
+#include <limits>
 #include <glad/glad.h>
 
-Renderer::Renderer(Scene& scene) : scene(scene), activeCamera(scene.GetActiveCamera()), triangleDrawer(TriangleDrawer()), fogger(Fogger()) 
+Renderer::Renderer(Scene& scene) : scene(scene), activeCamera(scene.GetActiveCamera()), triangleDrawer(TriangleDrawer()), fogger(Fogger()),
+	shaders("vshader_color.glsl", "fshader_color.glsl"), activeVariant(nullptr), frameShaderFeatures(0), frameLightCount(0)
 { 
-	colorShader.loadShaders("vshader_color.glsl", "fshader_color.glsl"); 
-	normalMappingShader.loadShaders("vshader_normal.glsl", "fshader_normal.glsl");
-	activeShader = &colorShader;
+	cameraData.Create(CAMERA_DATA_BINDING, sizeof(CameraData));
+	lightingData.Create(LIGHTING_DATA_BINDING, sizeof(LightingData));
 }
 
 Renderer::~Renderer()
@@ -32,80 +39,298 @@ void Renderer::ClearBuffers()
 
 void Renderer::Render()
 {
-	// Start counting runtime
-	auto start = std::chrono::high_resolution_clock::now();
+	ProfileZone zone("Renderer::Render");
+	GpuProfileZone gpuZone("Renderer::Render");
 
+	// Meshes whose last model went away since the last frame, and unused textures over the budget
+	{
+		ProfileZone assetsZone("Asset upkeep");
+		GpuProfileZone gpuAssetsZone("Asset upkeep");
+		MeshAssetCache::Get().CollectGarbage();
+		TextureManager::Get().Trim();
+		TextureStreamer::Get().Update();
+	}
+
+	GLStateCache& stateCache = GLStateCache::Get();
+	stateCache.BeginFrame();
+	stateCache.SetDepthTest(true);
+	stateCache.SetDepthMask(true);
+
+	// The draw methods allocate their per-frame data from the arena, and add their models and triangles to the counts
+	frameArena.Reset();
+	scene.SetTriangleCounts(0, 0);
+	scene.SetModelCounts(0, 0);
+
+	updateFrameData();
 	drawModels();
+	drawInstancedModels();
 	drawLights();
 	drawFloor();
 
-	// Stop counting runtime
-	auto finish = std::chrono::high_resolution_clock::now();
-	std::chrono::duration<double> elapsed = finish - start;
-	scene.SetRenderExecutionTime(elapsed.count());
-	return;
+	// After the first frame a variant is used in, every uniform the renderer uses has been set once
+	shaders.ReportUnsetUniforms();
+
+	const GLStateStatistics& stateChanges = stateCache.GetFrameStatistics();
+	scene.SetStateChangeCounts(stateChanges.issued, stateChanges.skipped);
+}
+
+// Everything that is the same for all the draws of a frame, uploaded once to the uniform buffers
+void Renderer::updateFrameData()
+{
+	ProfileZone zone("Update frame data");
+	GpuProfileZone gpuZone("Update frame data");
+
+	activeCamera.RenderProjectionMatrix();
+
+	CameraData camera;
+	camera.view = activeCamera.GetViewMatrix();
+	camera.projection = activeCamera.GetProjectionMatrix();
+	camera.cameraLocation = glm::vec4(activeCamera.GetCameraLocation(), 1.0f);
+	cameraData.Update(camera);
+
+	// The light count and toon shading pick the shader variants of the whole frame
+	const std::vector<LightSource*>& lights = scene.GetLightsVector();
+	frameLightCount = (unsigned int)std::min(lights.size(), (size_t)MAX_LIGHTS_NUMBER);
+	frameShaderFeatures = scene.GetToonShading() ? SHADER_TOON_SHADING : 0;
+
+	LightingData lighting = {};
+	lighting.ambiantLighting = scene.GetAmbientLight();
+	lighting.toonShadingLevels = scene.GetToonShadingLevels();
+	for (GLint i = 0; i < (GLint)frameLightCount; i++)
+	{
+		lighting.lightsPositions[i] = glm::vec4(Utils::Vec3FromVec4(lights[i]->GetLocation()), 1.0f);
+		lighting.lightColors[i] = lights[i]->GetColor();
+	}
+	lightingData.Update(lighting);
 }
 
 void Renderer::drawModels()
 {
 	if (scene.GetModelCount() == 0) return;
+	ProfileZone zone("Draw models");
+	GpuProfileZone gpuZone("Draw models");
+
+	// The viewport height turns projected sizes into pixels
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	size_t drawnTriangles = 0;
+	size_t lodSavedTriangles = 0;
+
+	// Every model's bounding sphere in world space, tested against the camera frustum in one batch
+	const std::vector<MeshModel*>& models = scene.GetModelsVector();
+	worldSpheres.Clear();
+	for (std::vector<MeshModel*>::const_iterator iterator = models.cbegin(); iterator != models.cend(); ++iterator)
+	{
+		worldSpheres.Add((*iterator)->GetWorldBoundingSphere());
+	}
+
+	size_t visibleModels = models.size();
+	if (scene.GetUseFrustumCulling())
+	{
+		Frustum frustum(activeCamera.GetProjectionMatrix() * activeCamera.GetViewMatrix());
+		visibleModels = frustum.Cull(worldSpheres, modelVisibility);
+	}
+	else
+	{
+		modelVisibility.assign(models.size(), 1);
+	}
 
-	std::vector<MeshModel*> models = scene.GetModelsVector();
-	for (std::vector<MeshModel*>::const_iterator iterator = models.cbegin(); iterator!= models.cend(); ++iterator)
+	// The visible models go into the render queue, which sorts them by state and then front to back
+	renderQueue.Begin(frameArena, visibleModels);
+	for (size_t i = 0; i < models.size(); i++)
 	{
-		auto& model = **iterator; // Dereferences to MeshModel
+		if (!modelVisibility[i]) continue;
+
+		auto& model = *models[i];
+		BoundingSphere worldSphere;
+		worldSphere.center = glm::vec3(worldSpheres.x[i], worldSpheres.y[i], worldSpheres.z[i]);
+		worldSphere.radius = worldSpheres.radius[i];
+		if (scene.GetUseLevelOfDetail())
+		{
+			model.SelectLod(getProjectedSize(worldSphere, (float)viewport[3]), scene.GetLodPixelError());
+		}
+		else
+		{
+			model.SetLod(0);
+		}
+
+		renderQueue.Add(getSortKey(model, worldSphere), (uint32_t)i);
+	}
+	renderQueue.Sort();
+
+	for (const RenderCommand& command : renderQueue)
+	{
+		auto& model = *models[command.item];
 		drawMeshModel(model);
+		if (model.GetLodCount() > 0)
+		{
+			drawnTriangles += model.GetNumberOfIndices() / 3;
+			lodSavedTriangles += (model.GetLod(0).indexCount - model.GetNumberOfIndices()) / 3;
+		}
 	}
+
+	scene.SetTriangleCounts(scene.GetDrawnTriangles() + drawnTriangles, scene.GetLodSavedTriangles() + lodSavedTriangles);
+	scene.SetModelCounts(scene.GetVisibleModels() + visibleModels, scene.GetCulledModels() + models.size() - visibleModels);
 }
 
-void Renderer::drawMeshModel(const MeshModel & model)
+void Renderer::drawInstancedModels()
 {
-	auto& lights = scene.GetLightsVector();
-	auto& activeLight = lights[0];
-	auto modelToWorld = model.GetWorldTransformation();
-	auto worldToView = activeCamera.GetViewMatrix();
-	activeCamera.RenderProjectionMatrix();
-	auto projectionMatrix = activeCamera.GetProjectionMatrix();
-	int numberOfLights = (int)lights.size();
-	Texture2D* bumpMap = nullptr;
+	const std::vector<InstancedModel*>& instancedModels = scene.GetInstancedModelsVector();
+	if (instancedModels.empty()) return;
+	ProfileZone zone("Draw instanced models");
+	GpuProfileZone gpuZone("Draw instanced models");
 
-	// Vertex shader params
-	activeShader->use();
-	activeShader->setUniform("model", modelToWorld);
-	activeShader->setUniform("view", worldToView);
-	activeShader->setUniform("projection", projectionMatrix);
-	activeShader->setUniform("numberOfLights", numberOfLights);
-	if (scene.GetUseBumpMapping())
+	GLint viewport[4];
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	for (InstancedModel* instancedModel : instancedModels)
 	{
-		bumpMap = model.GetBumpMap();
-		activeShader->setUniformSampler("bumpMap", 1);
+		drawInstancedModel(*instancedModel, viewport[3]);
 	}
+}
+
+// Culls the instances, uploads the visible ones grouped by level of detail and draws each group with one call
+void Renderer::drawInstancedModel(InstancedModel& instancedModel, GLint viewportHeight)
+{
+	MeshModel& mesh = instancedModel.GetMesh();
+	size_t instanceCount = instancedModel.GetInstanceCount();
+	if (instanceCount == 0 || mesh.GetLodCount() == 0) return;
 
-	// Fragment shader params
-	for (int i = 0; i != numberOfLights; i++)
+	const SphereBatch& worldSpheres = instancedModel.GetWorldSpheres();
+	size_t visibleInstances = instanceCount;
+	if (scene.GetUseFrustumCulling())
+	{
+		Frustum frustum(activeCamera.GetProjectionMatrix() * activeCamera.GetViewMatrix());
+		visibleInstances = frustum.Cull(worldSpheres, instanceVisibility);
+	}
+	else
 	{
-		string lightsColorArrayString = std::string("lightColors[" + std::to_string(i) + ']').c_str();
-		string lightsLocationArrayString = std::string("lightsPositions[" + std::to_string(i) + ']').c_str();
-		activeShader->setUniform(lightsColorArrayString.c_str(), lights[i]->GetColor());
-		activeShader->setUniform(lightsLocationArrayString.c_str(), Utils::Vec3FromVec4(lights[i]->GetLocation()));
+		instanceVisibility.assign(instanceCount, 1);
 	}
 
-	activeShader->setUniform("ambiantColor", model.GetAmbientColor());
-	activeShader->setUniform("ambiantLighting", scene.GetAmbientLight());
-	activeShader->setUniform("diffuseColor", model.GetDiffuseColor());
-	activeShader->setUniform("specularColor", model.GetSpecularColor());
-	activeShader->setUniform("shininess", model.GetShininess());
-	activeShader->setUniform("cameraLocation", activeCamera.GetCameraLocation());
-	activeShader->setUniform("useTextures", model.TextureLoaded());
-	activeShader->setUniform("useToonShading", scene.GetToonShading());
-	activeShader->setUniform("toonShadingLevels", scene.GetToonShadingLevels());
+	// Level of each visible instance, and how many instances every level has
+	std::vector<uint8_t>& instanceLods = instancedModel.GetInstanceLods();
+	instancesPerLod.assign(mesh.GetLodCount(), 0);
+	for (size_t i = 0; i < instanceCount; i++)
+	{
+		if (!instanceVisibility[i]) continue;
+
+		if (scene.GetUseLevelOfDetail())
+		{
+			BoundingSphere worldSphere;
+			worldSphere.center = glm::vec3(worldSpheres.x[i], worldSpheres.y[i], worldSpheres.z[i]);
+			worldSphere.radius = worldSpheres.radius[i];
+			instanceLods[i] = (uint8_t)mesh.ChooseLod(getProjectedSize(worldSphere, (float)viewportHeight), scene.GetLodPixelError(), instanceLods[i]);
+		}
+		else
+		{
+			instanceLods[i] = 0;
+		}
+		instancesPerLod[instanceLods[i]]++;
+	}
+
+	// Visible instances sorted by level (a counting sort), so each level is one range of the instance buffer
+	InstanceData* visibleData = frameArena.AllocateArray<InstanceData>(std::max<size_t>(visibleInstances, 1));
+	size_t* nextSlot = frameArena.AllocateArray<size_t>(instancesPerLod.size());
+	size_t offset = 0;
+	for (size_t level = 0; level < instancesPerLod.size(); level++)
+	{
+		nextSlot[level] = offset;
+		offset += instancesPerLod[level];
+	}
+	for (size_t i = 0; i < instanceCount; i++)
+	{
+		if (!instanceVisibility[i]) continue;
+		visibleData[nextSlot[instanceLods[i]]++] = instancedModel.GetInstance(i);
+	}
+	instancedModel.UploadInstances(visibleData, visibleInstances);
+
+	// The material comes with the instances, the rest is shared by all of them
+	useShader(getShaderFeatures(mesh));
+	ShaderProgram& shader = activeVariant->program;
+	shader.setUniform(activeVariant->uniforms.instanced, (GLint)true);
+	setVertexDecoding(instancedModel);
+	if (scene.GetFillTriangles())
+	{
+		mesh.BindTextures();
+	}
+
+	size_t drawnTriangles = 0;
+	size_t lodSavedTriangles = 0;
+	size_t firstInstance = 0;
+	for (size_t level = 0; level < instancesPerLod.size(); level++)
+	{
+		size_t levelInstances = instancesPerLod[level];
+		if (levelInstances == 0) continue;
+
+		mesh.SetLod(level);
+		instancedModel.SetFirstInstance(firstInstance);
+		triangleDrawer.SetModel(&instancedModel);
+		if (scene.GetFillTriangles()) triangleDrawer.FillTrianglesInstanced((GLsizei)levelInstances);
+		else triangleDrawer.DrawTrianglesInstanced((GLsizei)levelInstances);
+
+		drawnTriangles += levelInstances * mesh.GetNumberOfIndices() / 3;
+		lodSavedTriangles += levelInstances * (mesh.GetLod(0).indexCount - mesh.GetNumberOfIndices()) / 3;
+		firstInstance += levelInstances;
+	}
+	shader.setUniform(activeVariant->uniforms.instanced, (GLint)false);
+
+	scene.SetTriangleCounts(scene.GetDrawnTriangles() + drawnTriangles, scene.GetLodSavedTriangles() + lodSavedTriangles);
+	scene.SetModelCounts(scene.GetVisibleModels() + visibleInstances, scene.GetCulledModels() + instanceCount - visibleInstances);
+}
+
+uint64_t Renderer::getSortKey(const MeshModel& model, const BoundingSphere& worldSphere) const
+{
+	// Models with the same colors get the same material bits, so their draws end up next to each other
+	struct
+	{
+		glm::vec4 ambient, diffuse, specular;
+		float shininess;
+	} material = { model.GetAmbientColor(), model.GetDiffuseColor(), model.GetSpecularColor(), model.GetShininess() };
+	uint64_t materialHash = Utils::HashBytes(&material, sizeof(material));
+
+	// The features that differ between models are the low bits, the ones of the whole frame don't matter here
+	unsigned int shader = getShaderFeatures(model);
+	float depth = glm::length(worldSphere.center - activeCamera.GetCameraLocation()) - worldSphere.radius;
+	return RenderQueue::MakeKey(RENDER_PASS_OPAQUE, shader, model.GetTextureId(), (unsigned int)materialHash, depth);
+}
+
+// Diameter of a world space bounding sphere on the screen, in pixels (infinite when the camera is inside it)
+float Renderer::getProjectedSize(const BoundingSphere& worldSphere, float viewportHeight) const
+{
+	glm::mat4 projection = activeCamera.GetProjectionMatrix();
+	glm::vec4 center = activeCamera.GetViewMatrix() * glm::vec4(worldSphere.center, 1.0f);
+	float radius = worldSphere.radius;
+
+	// Clip space w of the center: its depth for perspective projections, 1 for orthographic ones
+	float w = projection[0][3] * center.x + projection[1][3] * center.y + projection[2][3] * center.z + projection[3][3] * center.w;
+	if (w <= radius * std::abs(projection[2][3]))
+	{
+		return std::numeric_limits<float>::infinity();
+	}
+
+	return radius * projection[1][1] / w * viewportHeight;
+}
+
+void Renderer::drawMeshModel(const MeshModel & model)
+{
+	// The camera and the lights are in the uniform buffers, only the model and its material change per draw
+	useShader(getShaderFeatures(model));
+	ShaderProgram& shader = activeVariant->program;
+	const DrawUniforms& uniforms = activeVariant->uniforms;
+	shader.setUniform(uniforms.model, model.GetWorldTransformation());
+	setVertexDecoding(model);
+
+	shader.setUniform(uniforms.ambiantColor, model.GetAmbientColor());
+	shader.setUniform(uniforms.diffuseColor, model.GetDiffuseColor());
+	shader.setUniform(uniforms.specularColor, model.GetSpecularColor());
+	shader.setUniform(uniforms.shininess, model.GetShininess());
 
 	triangleDrawer.SetModel(&model);
+	// Models without a texture bind texture 0, so there is nothing to unbind after the draw
 	if (scene.GetFillTriangles()) 
 	{
 		model.BindTextures();
 		triangleDrawer.FillTriangles();
-		model.UnbindTextures();
 	}
 	else triangleDrawer.DrawTriangles();
 }
@@ -113,6 +338,8 @@ void Renderer::drawMeshModel(const MeshModel & model)
 void Renderer::drawLights()
 {
 	if (!scene.GetDrawLights()) return;
+	ProfileZone zone("Draw lights");
+	GpuProfileZone gpuZone("Draw lights");
 
 	std::vector<LightSource*> lights = scene.GetLightsVector();
 	int numberOfLights = (int)lights.size();
@@ -121,29 +348,52 @@ void Renderer::drawLights()
 	for (std::vector<LightSource*>::const_iterator iterator = lights.cbegin(); iterator != lights.cend(); ++iterator)
 	{
 		auto& lightSource = **iterator; // Dereferences to LightSource
-		auto& lightColor = lightSource.GetColor();
-		auto modelToWorld = lightSource.GetWorldTransformation();
-		auto worldToView = activeCamera.GetViewMatrix();
-		activeCamera.RenderProjectionMatrix();
-		auto projectionMatrix = activeCamera.GetProjectionMatrix();
-
-		// Vertex shader params
-		activeShader->use();
-		activeShader->setUniform("model", modelToWorld);
-		activeShader->setUniform("view", worldToView);
-		activeShader->setUniform("projection", projectionMatrix);
-		activeShader->setUniform("numberOfLights", 0);
-		activeShader->setUniform("ambiantColor", lightColor);
-		activeShader->setUniform("ambiantLighting", lightColor);
-		activeShader->setUniform("cameraLocation", activeCamera.GetCameraLocation());
+
+		// Light sources are drawn in their own color, without lighting
+		useShader(SHADER_EMISSIVE);
+		activeVariant->program.setUniform(activeVariant->uniforms.model, lightSource.GetWorldTransformation());
+		setVertexDecoding(lightSource);
+		activeVariant->program.setUniform(activeVariant->uniforms.ambiantColor, lightSource.GetColor());
 		triangleDrawer.SetModel(&lightSource);
 		triangleDrawer.DrawTriangles();
 		triangleDrawer.FillTriangles();
 	}
 }
 
+// Switches to the variant with these features (and the frame's), compiling it the first time
+void Renderer::useShader(uint32_t features)
+{
+	uint32_t key = ShaderVariantCache::MakeKey(features | frameShaderFeatures, frameLightCount);
+	if (activeVariant == nullptr || activeVariant->key != key)
+	{
+		activeVariant = &shaders.Get(key);
+	}
+	activeVariant->program.use();
+}
+
+uint32_t Renderer::getShaderFeatures(const MeshModel& model) const
+{
+	uint32_t features = model.TextureLoaded() ? SHADER_TEXTURES : 0;
+	if (scene.GetUseBumpMapping() && model.GetBumpMap() != nullptr)
+	{
+		features |= SHADER_BUMP_MAPPING;
+	}
+	return features;
+}
+
+void Renderer::setVertexDecoding(const IMeshObject& meshObject)
+{
+	const VertexDecoding& decoding = meshObject.GetVertexDecoding();
+	ShaderProgram& shader = activeVariant->program;
+	shader.setUniform(activeVariant->uniforms.positionOffset, decoding.positionOffset);
+	shader.setUniform(activeVariant->uniforms.positionScale, decoding.positionScale);
+	shader.setUniform(activeVariant->uniforms.octahedralNormals, (GLint)decoding.octahedralNormals);
+}
+
 void Renderer::drawFloor()
 {
 	if (!scene.GetShowFloor()) return;
+	ProfileZone zone("Draw floor");
+	GpuProfileZone gpuZone("Draw floor");
 	drawMeshModel(*scene.GetFloor());
 }
@@ -1,6 +1,8 @@
 #include "Scene.h"
 #include "MeshModel.h"
 #include <string>
+#include <cmath>
+#include <algorithm>
 
 Scene::Scene() :
 	activeCameraIndex(0),
@@ -29,15 +31,92 @@ Scene::Scene() :
 Scene::~Scene()
 {
 	cameras.clear(); // This calls the destructor on every camera
-	lights.clear();
-	models.clear();
+	RemoveAllLights();
+	RemoveAllModels();
 }
 
 void Scene::AddModel(MeshModel* const model)
 {
+	if (model == nullptr) return;
 	models.push_back(model);
 }
 
+void Scene::RemoveActiveModel()
+{
+	if (models.empty()) return;
+
+	delete models[activeModelIndex];
+	models.erase(models.begin() + activeModelIndex);
+	activeModelIndex = std::max(0, std::min(activeModelIndex, (int)models.size() - 1));
+}
+
+void Scene::RemoveAllModels()
+{
+	for (MeshModel* model : models)
+	{
+		delete model;
+	}
+	models.clear();
+	activeModelIndex = 0;
+
+	for (InstancedModel* instancedModel : instancedModels)
+	{
+		delete instancedModel;
+	}
+	instancedModels.clear();
+}
+
+// Thousands of cheap models spread around the camera, most of them outside its view at any time
+void Scene::AddCullingBenchmark()
+{
+	float halfSize = (CULLING_BENCHMARK_SIDE - 1) * CULLING_BENCHMARK_SPACING * 0.5f;
+	for (int row = 0; row < CULLING_BENCHMARK_SIDE; row++)
+	{
+		for (int column = 0; column < CULLING_BENCHMARK_SIDE; column++)
+		{
+			glm::vec4 location(column * CULLING_BENCHMARK_SPACING - halfSize, 0.0f, row * CULLING_BENCHMARK_SPACING - halfSize, 1.0f);
+			Cube* cube = new Cube(location, CULLING_BENCHMARK_SPACING * 0.2f);
+			cube->SetDiffuseColor(glm::vec4((float)column / CULLING_BENCHMARK_SIDE, 0.5f, (float)row / CULLING_BENCHMARK_SIDE, 1.0f));
+			AddModel(cube);
+		}
+	}
+}
+
+InstancedModel* Scene::AddInstancedModel(MeshModel* const mesh)
+{
+	if (mesh == nullptr) return nullptr;
+	instancedModels.push_back(new InstancedModel(mesh));
+	return instancedModels.back();
+}
+
+// Lots of copies of one mesh, all scaled to the same size and each with its own color
+InstancedModel* Scene::AddInstancingBenchmark(MeshModel* const mesh)
+{
+	InstancedModel* instancedModel = AddInstancedModel(mesh);
+	if (instancedModel == nullptr) return nullptr;
+
+	int side = (int)std::ceil(std::sqrt((float)INSTANCING_BENCHMARK_COUNT));
+	float halfSize = (side - 1) * INSTANCING_BENCHMARK_SPACING * 0.5f;
+	const BoundingSphere& sphere = mesh->GetBoundingSphere();
+	float scale = sphere.radius > 0.0f ? INSTANCING_BENCHMARK_SPACING * 0.4f / sphere.radius : 1.0f;
+
+	Material material;
+	for (int i = 0; i < INSTANCING_BENCHMARK_COUNT; i++)
+	{
+		int row = i / side;
+		int column = i % side;
+		glm::vec3 location(column * INSTANCING_BENCHMARK_SPACING - halfSize, 0.0f, row * INSTANCING_BENCHMARK_SPACING - halfSize);
+
+		// Centers the mesh on location
+		glm::mat4 transform(scale);
+		transform[3] = glm::vec4(location - sphere.center * scale, 1.0f);
+
+		material.SetDiffuseColor(glm::vec4((float)column / side, 0.5f, (float)row / side, 1.0f));
+		instancedModel->AddInstance(transform, material);
+	}
+	return instancedModel;
+}
+
 MeshModel* Scene::GetActiveModel() const
 {
 	if (models.empty())
@@ -98,6 +177,16 @@ void Scene::AddLight(LightSourceType type)
 	}
 }
 
+void Scene::RemoveAllLights()
+{
+	for (LightSource* light : lights)
+	{
+		delete light;
+	}
+	lights.clear();
+	activeLightsIndex = 0;
+}
+
 void Scene::SetActiveModelIndex(const int pIndex)
 {
 	unsigned int index = (unsigned int)pIndex;
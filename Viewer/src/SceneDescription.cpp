@@ -0,0 +1,306 @@
+#include "SceneDescription.h"
+#include "Scene.h"
+#include "Utils.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+static bool isOptionName(const std::string& token)
+{
+	return token.size() > 2 && token[0] == '-' && token[1] == '-';
+}
+
+static bool parseFloat(const std::string& text, float& value)
+{
+	char* end;
+	value = std::strtof(text.c_str(), &end);
+	return end != text.c_str() && *end == '\0';
+}
+
+// Reads count numbers, or none (and returns false) if they aren't all there
+static bool readFloats(const std::vector<std::string>& arguments, size_t& next, float* values, int count)
+{
+	if (next + count > arguments.size()) return false;
+	for (int i = 0; i < count; i++)
+	{
+		if (!parseFloat(arguments[next + i], values[i])) return false;
+	}
+	next += count;
+	return true;
+}
+
+static bool readString(const std::vector<std::string>& arguments, size_t& next, std::string& value)
+{
+	if (next >= arguments.size() || isOptionName(arguments[next])) return false;
+	value = arguments[next++];
+	return true;
+}
+
+static bool readColor(const std::vector<std::string>& arguments, size_t& next, glm::vec4& color)
+{
+	float values[3];
+	if (!readFloats(arguments, next, values, 3)) return false;
+	color = glm::vec4(values[0], values[1], values[2], 1.0f);
+	return true;
+}
+
+bool SceneDescription::Parse(const std::vector<std::string>& arguments)
+{
+	size_t next = 0;
+	while (next < arguments.size())
+	{
+		const std::string& token = arguments[next++];
+		if (!isOptionName(token))
+		{
+			std::cerr << "Unexpected argument '" << token << "'" << std::endl;
+			return false;
+		}
+		if (!parseOption(token.substr(2), arguments, next))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool SceneDescription::ParseFile(const std::string& filePath)
+{
+	std::ifstream file(filePath);
+	if (!file)
+	{
+		std::cerr << "Could not open scene description '" << filePath << "'" << std::endl;
+		return false;
+	}
+
+	// Every line is one option, its name without the dashes
+	std::string line;
+	for (int lineNumber = 1; std::getline(file, line); lineNumber++)
+	{
+		std::istringstream tokens(line.substr(0, line.find('#')));
+		std::vector<std::string> arguments;
+		std::string token;
+		while (tokens >> token)
+		{
+			arguments.push_back(arguments.empty() ? "--" + token : token);
+		}
+
+		if (!arguments.empty() && !Parse(arguments))
+		{
+			std::cerr << "  in " << filePath << ", line " << lineNumber << std::endl;
+			return false;
+		}
+	}
+	return true;
+}
+
+bool SceneDescription::parseOption(const std::string& name, const std::vector<std::string>& arguments, size_t& next)
+{
+	float values[3];
+	bool valid = true;
+
+	// Image
+	if (name == "size")
+	{
+		std::string size;
+		valid = readString(arguments, next, size) && std::sscanf(size.c_str(), "%dx%d", &width, &height) == 2 && width > 0 && height > 0;
+	}
+	else if (name == "output") valid = readString(arguments, next, outputFile);
+	else if (name == "depth-output") valid = readString(arguments, next, depthOutputFile);
+	else if (name == "scene")
+	{
+		std::string filePath;
+		if (!readString(arguments, next, filePath))
+		{
+			valid = false;
+		}
+		else
+		{
+			return ParseFile(filePath);
+		}
+	}
+
+	// Camera
+	else if (name == "eye" || name == "at" || name == "up")
+	{
+		valid = readFloats(arguments, next, values, 3);
+		if (valid) (name == "eye" ? eye : name == "at" ? at : up) = glm::vec3(values[0], values[1], values[2]);
+	}
+	else if (name == "fov")            valid = readFloats(arguments, next, &fov, 1);
+	else if (name == "near")           valid = readFloats(arguments, next, &zNear, 1);
+	else if (name == "far")            valid = readFloats(arguments, next, &zFar, 1);
+	else if (name == "orthographic")
+	{
+		projection = Ortographic;
+		valid = readFloats(arguments, next, &orthographicHeight, 1);
+	}
+	else if (name == "perspective")    projection = Perspective;
+
+	// Lights
+	else if (name == "light")
+	{
+		LightDescription light;
+		std::string type;
+		valid = readString(arguments, next, type) && (type == "point" || type == "parallel") && readFloats(arguments, next, values, 3);
+		if (valid)
+		{
+			light.type = type == "point" ? PointSource : Parallel;
+			light.vector = glm::vec3(values[0], values[1], values[2]);
+
+			// The color is optional
+			light.hasColor = readColor(arguments, next, light.color);
+			lights.push_back(light);
+		}
+	}
+	else if (name == "ambient")        valid = readColor(arguments, next, ambientLight);
+	else if (name == "background")     valid = readColor(arguments, next, clearColor);
+
+	// Models
+	else if (name == "model")
+	{
+		ModelDescription model;
+		valid = readString(arguments, next, model.filePath);
+		if (valid) models.push_back(model);
+	}
+	else if (name == "position" || name == "rotation" || name == "scale" || name == "color")
+	{
+		if (models.empty())
+		{
+			std::cerr << "--" << name << " must follow a --model" << std::endl;
+			return false;
+		}
+
+		ModelDescription& model = models.back();
+		if (name == "scale")          valid = readFloats(arguments, next, &model.scale, 1);
+		else if (name == "color")     valid = model.hasColor = readColor(arguments, next, model.color);
+		else if ((valid = readFloats(arguments, next, values, 3)))
+		{
+			(name == "position" ? model.position : model.rotation) = glm::vec3(values[0], values[1], values[2]);
+		}
+	}
+	else if (name == "culling-benchmark")    cullingBenchmark = true;
+	else if (name == "instancing-benchmark") valid = readString(arguments, next, instancingBenchmarkMesh);
+
+	// Rendering
+	else if (name == "toon")
+	{
+		valid = next < arguments.size() && (toonShadingLevels = std::atoi(arguments[next++].c_str())) > 0;
+	}
+	else if (name == "bump-mapping")   bumpMapping = true;
+	else if (name == "floor")          showFloor = true;
+	else if (name == "no-light-cubes") drawLights = false;
+	else if (name == "no-lod")         levelOfDetail = false;
+	else if (name == "no-culling")     frustumCulling = false;
+	else
+	{
+		std::cerr << "Unknown option --" << name << std::endl;
+		return false;
+	}
+
+	if (!valid)
+	{
+		std::cerr << "Bad or missing value for --" << name << std::endl;
+	}
+	return valid;
+}
+
+bool SceneDescription::Apply(Scene& scene) const
+{
+	scene.SetClearColor(clearColor);
+	scene.SetAmbientLight(ambientLight);
+	scene.SetToonShading(toonShadingLevels > 0);
+	scene.SetToonShadingLevels(std::max(1, toonShadingLevels));
+	scene.SetUseBumpMapping(bumpMapping);
+	scene.SetShowFloor(showFloor);
+	scene.SetDrawLights(drawLights);
+	scene.SetUseLevelOfDetail(levelOfDetail);
+	scene.SetUseFrustumCulling(frustumCulling);
+
+	// The projections keep the image's aspect ratio
+	float aspect = (float)width / (float)height;
+	float halfHeight = orthographicHeight * 0.5f;
+	Camera& camera = scene.GetActiveCamera();
+	camera.SetCameraLookAt(eye, at, up);
+	camera.SelectProjectionType(projection);
+	camera.SetPerspectiveProjectionParameters({ fov, aspect, zNear, zFar });
+	camera.SetOrthographicProjectionParameters({ -halfHeight * aspect, halfHeight * aspect, -halfHeight, halfHeight, zNear, zFar });
+
+	scene.RemoveAllLights();
+	if (lights.empty())
+	{
+		scene.AddLight(PointSource);
+	}
+	for (const LightDescription& description : lights)
+	{
+		scene.AddLight(description.type);
+		LightSource* light = scene.GetLightsVector().back();
+		if (description.hasColor)
+		{
+			light->SetColor(description.color);
+		}
+
+		if (PointLightSource* pointLight = dynamic_cast<PointLightSource*>(light))
+		{
+			pointLight->Move(description.vector - Utils::Vec3FromVec4(pointLight->GetLocation()));
+		}
+		else if (ParallelLightSource* parallelLight = dynamic_cast<ParallelLightSource*>(light))
+		{
+			parallelLight->SetDirection(description.vector);
+		}
+	}
+
+	bool loaded = true;
+	for (const ModelDescription& description : models)
+	{
+		MeshModel* model = Utils::LoadMeshModel(description.filePath);
+		if (model == nullptr)
+		{
+			loaded = false;
+			continue;
+		}
+
+		model->SetTranslation(description.position);
+		if (description.rotation.x != 0.0f) model->RotateX(description.rotation.x);
+		if (description.rotation.y != 0.0f) model->RotateY(description.rotation.y);
+		if (description.rotation.z != 0.0f) model->RotateZ(description.rotation.z);
+		model->Scale(description.scale);
+		if (description.hasColor)
+		{
+			model->SetDiffuseColor(description.color);
+		}
+		scene.AddModel(model);
+	}
+
+	if (cullingBenchmark)
+	{
+		scene.AddCullingBenchmark();
+	}
+	if (!instancingBenchmarkMesh.empty())
+	{
+		MeshModel* mesh = Utils::LoadMeshModel(instancingBenchmarkMesh);
+		loaded = loaded && mesh != nullptr;
+		scene.AddInstancingBenchmark(mesh);
+	}
+	return loaded;
+}
+
+void SceneDescription::PrintOptions()
+{
+	std::cout << "Scene options (in a --scene file: one per line, without the dashes):" << std::endl;
+	std::cout << "  --size <width>x<height>           image size (default " << SCENE_DESCRIPTION_DEFAULT_WIDTH << "x" << SCENE_DESCRIPTION_DEFAULT_HEIGHT << ")" << std::endl;
+	std::cout << "  --output <file.png|file.ppm>      image to write" << std::endl;
+	std::cout << "  --depth-output <file.exr>         depth buffer to write" << std::endl;
+	std::cout << "  --scene <file>                    reads more options from a file" << std::endl;
+	std::cout << "  --eye/--at/--up <x> <y> <z>       camera" << std::endl;
+	std::cout << "  --fov <degrees> --near <z> --far <z>" << std::endl;
+	std::cout << "  --orthographic <height>           orthographic projection of that height (--perspective is the default)" << std::endl;
+	std::cout << "  --light point|parallel <x> <y> <z> [<r> <g> <b>]  location/direction, replaces the default light" << std::endl;
+	std::cout << "  --ambient/--background <r> <g> <b>" << std::endl;
+	std::cout << "  --model <file.obj>                adds a model, then for it:" << std::endl;
+	std::cout << "    --position <x> <y> <z> --rotation <x> <y> <z> (degrees) --scale <s> --color <r> <g> <b>" << std::endl;
+	std::cout << "  --culling-benchmark               the grid of cubes of the culling benchmark" << std::endl;
+	std::cout << "  --instancing-benchmark <file.obj> the instanced copies of the instancing benchmark" << std::endl;
+	std::cout << "  --toon <levels> --bump-mapping --floor --no-light-cubes --no-lod --no-culling" << std::endl;
+}
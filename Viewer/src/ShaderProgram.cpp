@@ -1,8 +1,11 @@
 #include "ShaderProgram.h"
 #include "Scene.h"  // For LIGHTS_NUM_LIMIT 
+#include "UniformBlocks.h"
+#include "GLStateCache.h"
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <algorithm>
 
 #include <glm/gtc/type_ptr.hpp>
 
@@ -20,13 +23,13 @@ ShaderProgram::ShaderProgram()
 ShaderProgram::~ShaderProgram()
 {
 	// Delete the program
-	glDeleteProgram(programHandle);
+	GLStateCache::Get().DeleteProgram(programHandle);
 }
 
 //-----------------------------------------------------------------------------
 // Loads vertex and fragment shaders
 //-----------------------------------------------------------------------------
-bool ShaderProgram::loadShaders(const char* vsFilename, const char* fsFilename)
+bool ShaderProgram::loadShaders(const char* vsFilename, const char* fsFilename, const std::vector<string>& defines)
 {
 	string vsString;
 	string fsString;
@@ -37,9 +40,17 @@ bool ShaderProgram::loadShaders(const char* vsFilename, const char* fsFilename)
 	maxLightsConstant += std::to_string(MAX_LIGHTS_NUMBER);
 	maxLightsConstant += "\n";
 
+	string defineLines;
+	for (const string& define : defines)
+	{
+		defineLines += "#define " + define + "\n";
+	}
+
 	vsString += fileToString(vsFilename);
 	fsString += fileToString(fsFilename);
 	fsString.insert(fsString.find_first_of('\n'),maxLightsConstant.c_str());
+	vsString.insert(vsString.find_first_of('\n') + 1, defineLines);
+	fsString.insert(fsString.find_first_of('\n') + 1, defineLines);
 
 	const GLchar* vsSourcePtr = vsString.c_str();
 	const GLchar* fsSourcePtr = fsString.c_str();
@@ -73,7 +84,16 @@ bool ShaderProgram::loadShaders(const char* vsFilename, const char* fsFilename)
 	glDeleteShader(vs);
 	glDeleteShader(fs);
 
-	uniformLocations.clear();
+	name = string(vsFilename) + "/" + fsFilename;
+	for (size_t i = 0; i < defines.size(); i++)
+	{
+		name += (i == 0 ? " (" : ", ") + defines[i] + (i + 1 == defines.size() ? ")" : "");
+	}
+	reflectUniforms();
+
+	// The per-frame data is shared by all the programs through uniform buffers
+	bindUniformBlock("CameraData", CAMERA_DATA_BINDING);
+	bindUniformBlock("LightingData", LIGHTING_DATA_BINDING);
 
 	return true;
 }
@@ -116,7 +136,7 @@ void ShaderProgram::use()
 {
 	if (programHandle > 0)
 	{
-		glUseProgram(programHandle);
+		GLStateCache::Get().UseProgram(programHandle);
 	}
 }
 
@@ -167,90 +187,127 @@ GLuint ShaderProgram::getProgram() const
 }
 
 //-----------------------------------------------------------------------------
-// Sets a glm::vec2 shader uniform
+// Connects a uniform block to a binding point. Blocks the shaders don't use
+// are skipped.
 //-----------------------------------------------------------------------------
-void ShaderProgram::setUniform(const GLchar* name, const glm::vec2& v)
+void ShaderProgram::bindUniformBlock(const GLchar* name, GLuint bindingPoint)
 {
-	GLint loc = getUniformLocation(name);
-	glUniform2f(loc, v.x, v.y);
+	GLuint blockIndex = glGetUniformBlockIndex(programHandle, name);
+	if (blockIndex != GL_INVALID_INDEX)
+	{
+		glUniformBlockBinding(programHandle, blockIndex, bindingPoint);
+	}
 }
 
 //-----------------------------------------------------------------------------
-// Sets a glm::vec3 shader uniform
+// Sets uniforms through handles from getUniform
 //-----------------------------------------------------------------------------
-void ShaderProgram::setUniform(const GLchar* name, const glm::vec3& v)
+void ShaderProgram::setUniform(UniformHandle<glm::vec2> uniform, const glm::vec2& v)
 {
-	GLint loc = getUniformLocation(name);
-	glUniform3f(loc, v.x, v.y, v.z);
+	glUniform2f(setLocation(uniform.index), v.x, v.y);
 }
 
-//-----------------------------------------------------------------------------
-// Sets a glm::vec4 shader uniform
-//-----------------------------------------------------------------------------
-void ShaderProgram::setUniform(const GLchar* name, const glm::vec4& v)
+void ShaderProgram::setUniform(UniformHandle<glm::vec3> uniform, const glm::vec3& v)
 {
-	GLint loc = getUniformLocation(name);
-	glUniform4f(loc, v.x, v.y, v.z, v.w);
+	glUniform3f(setLocation(uniform.index), v.x, v.y, v.z);
 }
 
-//-----------------------------------------------------------------------------
-// Sets a glm::mat4 shader uniform
-//-----------------------------------------------------------------------------
-void ShaderProgram::setUniform(const GLchar* name, const glm::mat4& m)
+void ShaderProgram::setUniform(UniformHandle<glm::vec4> uniform, const glm::vec4& v)
 {
-	GLint loc = getUniformLocation(name);
+	glUniform4f(setLocation(uniform.index), v.x, v.y, v.z, v.w);
+}
 
-	// loc = location of uniform in shader
-	// count = how many matrices (1 if not an array of mats)
-	// transpose = False for opengl because column major
-	// value = the matrix to set for the uniform
-	glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(m));
+void ShaderProgram::setUniform(UniformHandle<glm::mat4> uniform, const glm::mat4& m)
+{
+	glUniformMatrix4fv(setLocation(uniform.index), 1, GL_FALSE, glm::value_ptr(m));
 }
 
-//-----------------------------------------------------------------------------
-// Sets a GLfloat shader uniform
-//-----------------------------------------------------------------------------
-void ShaderProgram::setUniform(const GLchar* name, const GLfloat f)
+void ShaderProgram::setUniform(UniformHandle<GLfloat> uniform, const GLfloat f)
 {
-	GLint loc = getUniformLocation(name);
-	glUniform1f(loc, f);
+	glUniform1f(setLocation(uniform.index), f);
 }
 
-//-----------------------------------------------------------------------------
-// Sets a GLint shader uniform
-//-----------------------------------------------------------------------------
-void ShaderProgram::setUniform(const GLchar* name, const GLint v)
+void ShaderProgram::setUniform(UniformHandle<GLint> uniform, const GLint v)
 {
-	GLint loc = getUniformLocation(name);
-	glUniform1i(loc, v);
+	glUniform1i(setLocation(uniform.index), v);
 }
 
 //-----------------------------------------------------------------------------
-// Sets a GLint shader uniform that is specific to a texture unit
+// Builds the table of active uniforms (the ones in uniform blocks are set
+// through uniform buffers and left out)
 //-----------------------------------------------------------------------------
-void ShaderProgram::setUniformSampler(const GLchar* name, const GLint& slot)
+void ShaderProgram::reflectUniforms()
 {
-	glActiveTexture(GL_TEXTURE0 + slot);
+	uniforms.clear();
+
+	GLint count = 0;
+	GLint maxNameLength = 0;
+	glGetProgramiv(programHandle, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(programHandle, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
 
-	GLint loc = getUniformLocation(name);
-	glUniform1i(loc, slot);
+	std::vector<GLchar> nameBuffer(std::max(maxNameLength, 1));
+	for (GLint i = 0; i < count; i++)
+	{
+		GLuint index = (GLuint)i;
+		GLint blockIndex = -1;
+		glGetActiveUniformsiv(programHandle, 1, &index, GL_UNIFORM_BLOCK_INDEX, &blockIndex);
+		if (blockIndex != -1) continue;
+
+		GLsizei length = 0;
+		GLint size = 0;
+		ActiveUniform uniform;
+		glGetActiveUniform(programHandle, index, (GLsizei)nameBuffer.size(), &length, &size, &uniform.type, nameBuffer.data());
+		uniform.name.assign(nameBuffer.data(), length);
+
+		// Arrays are reported as "name[0]"
+		if (uniform.name.size() > 3 && uniform.name.compare(uniform.name.size() - 3, 3, "[0]") == 0)
+		{
+			uniform.name.resize(uniform.name.size() - 3);
+		}
+
+		uniform.location = glGetUniformLocation(programHandle, uniform.name.c_str());
+		uniform.set = false;
+		uniforms.push_back(uniform);
+	}
 }
 
 //-----------------------------------------------------------------------------
-// Returns the uniform identifier given it's string name.
-// NOTE: Shader must be currently active first.
+// Resolves a uniform handle: the index of the active uniform, or -1 (with a
+// warning if it is required) when the program doesn't have it. GLSL compilers remove the
+// uniforms a shader declares but doesn't use, so those are reported here as well.
 //-----------------------------------------------------------------------------
-GLint ShaderProgram::getUniformLocation(const GLchar* name)
+int ShaderProgram::resolveUniform(const GLchar* uniformName, GLenum expectedType, bool required)
 {
-	std::map<string, GLint>::iterator it = uniformLocations.find(name);
+	for (size_t i = 0; i < uniforms.size(); i++)
+	{
+		if (uniforms[i].name != uniformName) continue;
+
+		GLenum type = uniforms[i].type;
+		bool setWithInt = type == GL_BOOL || type == GL_SAMPLER_2D || type == GL_SAMPLER_CUBE;
+		if (type != expectedType && !(expectedType == GL_INT && setWithInt))
+		{
+			std::cerr << "Warning: uniform '" << uniformName << "' of shader program " << name << " is set with the wrong type" << std::endl;
+		}
+		return (int)i;
+	}
 
-	// Only need to query the shader program IF it doesn't already exist.
-	if (it == uniformLocations.end())
+	if (required)
 	{
-		// Find it and add it to the map
-		uniformLocations[name] = glGetUniformLocation(programHandle, name);
+		std::cerr << "Warning: shader program " << name << " has no active uniform '" << uniformName << "'" << std::endl;
 	}
+	return -1;
+}
 
-	// Return it
-	return uniformLocations[name];
-}
\ No newline at end of file
+//-----------------------------------------------------------------------------
+// Lists the active uniforms nothing has set (they keep their default value)
+//-----------------------------------------------------------------------------
+void ShaderProgram::reportUnsetUniforms() const
+{
+	for (const ActiveUniform& uniform : uniforms)
+	{
+		if (!uniform.set)
+		{
+			std::cerr << "Warning: uniform '" << uniform.name << "' of shader program " << name << " is never set" << std::endl;
+		}
+	}
+}
@@ -0,0 +1,89 @@
+#include "ShaderVariantCache.h"
+#include "Profiler.h"
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+// Whether the variant shades with its lights, emissive variants and variants without lights don't
+static bool isLit(uint32_t key)
+{
+	return (key & SHADER_EMISSIVE) == 0 && (key >> SHADER_FEATURE_BITS) > 0;
+}
+
+void DrawUniforms::Resolve(ShaderProgram& program, uint32_t key)
+{
+	// A variant's compiler removes what its features don't use, so only what they read is required (and
+	// reported when it is missing, a misspelled name for one). Emissive variants only read the ambiant color,
+	// textured ones take the diffuse color from the texture, and without lights neither the normals nor the rest of
+	// the material are read.
+	bool lit = isLit(key);
+	bool untextured = (key & SHADER_TEXTURES) == 0;
+	model = program.getUniform<glm::mat4>("model");
+	positionOffset = program.getUniform<glm::vec3>("positionOffset");
+	positionScale = program.getUniform<glm::vec3>("positionScale");
+	octahedralNormals = program.getUniform<GLint>("octahedralNormals", lit);
+	ambiantColor = program.getUniform<glm::vec4>("ambiantColor");
+	diffuseColor = program.getUniform<glm::vec4>("diffuseColor", lit && untextured);
+	specularColor = program.getUniform<glm::vec4>("specularColor", lit);
+	shininess = program.getUniform<GLfloat>("shininess", lit);
+	instanced = program.getUniform<GLint>("instanced");
+}
+
+ShaderVariantCache::ShaderVariantCache(const char* vertexShaderFile, const char* fragmentShaderFile) :
+	vertexShaderFile(vertexShaderFile),
+	fragmentShaderFile(fragmentShaderFile)
+{
+}
+
+ShaderVariant& ShaderVariantCache::Get(uint32_t key)
+{
+	auto found = variants.find(key);
+	if (found != variants.end())
+	{
+		return *found->second;
+	}
+
+	ProfileZone zone("Compile shader variant");
+	auto start = std::chrono::high_resolution_clock::now();
+
+	std::vector<std::string> defines;
+	if (key & SHADER_TEXTURES) defines.push_back("TEXTURES");
+	if (key & SHADER_BUMP_MAPPING) defines.push_back("BUMP_MAPPING");
+	if (key & SHADER_TOON_SHADING) defines.push_back("TOON_SHADING");
+	if (key & SHADER_EMISSIVE) defines.push_back("EMISSIVE");
+	defines.push_back("LIGHT_COUNT " + std::to_string(key >> SHADER_FEATURE_BITS));
+
+	std::unique_ptr<ShaderVariant> variant(new ShaderVariant());
+	variant->key = key;
+	variant->reportedUnsetUniforms = false;
+	variant->program.loadShaders(vertexShaderFile.c_str(), fragmentShaderFile.c_str(), defines);
+	variant->uniforms.Resolve(variant->program, key);
+
+	// The texture units never change, and only the instanced draws turn on instancing (for their draws only)
+	ShaderProgram& program = variant->program;
+	program.use();
+	bool lit = isLit(key);
+	program.setUniform(program.getUniform<GLint>("textureMap", lit && (key & SHADER_TEXTURES) != 0), 0);
+	program.setUniform(program.getUniform<GLint>("bumpMap", false), 1);
+	program.setUniform(variant->uniforms.instanced, (GLint)false);
+
+	std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+	std::cout << "Compiled shader variant " << program.getName() << " in " << elapsed.count() * 1000.0 << " ms" << std::endl;
+
+	ShaderVariant& result = *variant;
+	variants[key] = std::move(variant);
+	return result;
+}
+
+void ShaderVariantCache::ReportUnsetUniforms()
+{
+	for (auto& entry : variants)
+	{
+		ShaderVariant& variant = *entry.second;
+		if (!variant.reportedUnsetUniforms)
+		{
+			variant.program.reportUnsetUniforms();
+			variant.reportedUnsetUniforms = true;
+		}
+	}
+}
@@ -1,6 +1,9 @@
 #include "Texture2D.h"
+#include "GLStateCache.h"
 #include <iostream>
 #include <cassert>
+#include <cstring>
+#include <vector>
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
@@ -8,12 +11,12 @@
 // Constructor
 //-----------------------------------------------------------------------------
 Texture2D::Texture2D()
-	: mTexture(0)
+	: mTexture(0), mWidth(0), mHeight(0), mGpuBytes(0), mPending(false), mFailed(false)
 {
 }
 
 Texture2D::Texture2D(GLuint textureNumber)
-	: mTexture(textureNumber)
+	: mTexture(textureNumber), mWidth(0), mHeight(0), mGpuBytes(0), mPending(false), mFailed(false)
 {
 }
 
@@ -22,7 +25,11 @@ Texture2D::Texture2D(GLuint textureNumber)
 //-----------------------------------------------------------------------------
 Texture2D::~Texture2D()
 {
-	glDeleteTextures(1, &mTexture);
+	// A pending texture only refers to the shared placeholder
+	if (!mPending)
+	{
+		GLStateCache::Get().DeleteTexture(mTexture);
+	}
 }
 
 //-----------------------------------------------------------------------------
@@ -36,35 +43,31 @@ bool Texture2D::loadTexture(const string& fileName, bool generateMipMaps)
 
 	// Use stbi image library to load our image
 	unsigned char* imageData = stbi_load(fileName.c_str(), &width, &height, &components, STBI_rgb_alpha);
+	return upload(imageData, width, height, fileName, generateMipMaps);
+}
+
+bool Texture2D::loadTexture(const unsigned char* fileData, size_t fileSize, const string& fileName, bool generateMipMaps)
+{
+	int width, height, components;
+	unsigned char* imageData = stbi_load_from_memory(fileData, (int)fileSize, &width, &height, &components, STBI_rgb_alpha);
+	return upload(imageData, width, height, fileName, generateMipMaps);
+}
 
+//-----------------------------------------------------------------------------
+// Creates the texture object from decoded RGBA pixels, and frees them
+//-----------------------------------------------------------------------------
+bool Texture2D::upload(unsigned char* imageData, int width, int height, const string& fileName, bool generateMipMaps)
+{
 	if (imageData == NULL)
 	{
 		std::cerr << "Error loading texture '" << fileName << "'" << std::endl;
 		return false;
 	}
 
-	// Invert image
-	int widthInBytes = width * 4;
-	unsigned char *top = NULL;
-	unsigned char *bottom = NULL;
-	unsigned char temp = 0;
-	int halfHeight = height / 2;
-	for (int row = 0; row < halfHeight; row++)
-	{
-		top = imageData + row * widthInBytes;
-		bottom = imageData + (height - row - 1) * widthInBytes;
-		for (int col = 0; col < widthInBytes; col++)
-		{
-			temp = *top;
-			*top = *bottom;
-			*bottom = temp;
-			top++;
-			bottom++;
-		}
-	}
+	flipVertically(imageData, width, height);
 
 	glGenTextures(1, &mTexture);
-	glBindTexture(GL_TEXTURE_2D, mTexture); // all upcoming GL_TEXTURE_2D operations will affect our texture object (mTexture)
+	GLStateCache::Get().BindTexture(mTexture); // all upcoming GL_TEXTURE_2D operations will affect our texture object (mTexture)
 
 	// Set the texture wrapping/filtering options (on the currently bound texture object)
 	// GL_CLAMP_TO_EDGE
@@ -75,7 +78,7 @@ bool Texture2D::loadTexture(const string& fileName, bool generateMipMaps)
 	// GL_NEAREST
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, generateMipMaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, imageData);
@@ -83,21 +86,91 @@ bool Texture2D::loadTexture(const string& fileName, bool generateMipMaps)
 	if (generateMipMaps)
 		glGenerateMipmap(GL_TEXTURE_2D);
 
+	mWidth = width;
+	mHeight = height;
+	mGpuBytes = mipChainBytes(width, height, generateMipMaps);
+
 	stbi_image_free(imageData);
-	glBindTexture(GL_TEXTURE_2D, 0); // unbind texture when done so we don't accidentally mess up our mTexture
+	GLStateCache::Get().BindTexture(0); // unbind texture when done so we don't accidentally mess up our mTexture
 
 	return true;
 }
 
+//-----------------------------------------------------------------------------
+// Creates the texture object from levels that are already flipped, with their own mip maps
+//-----------------------------------------------------------------------------
+void Texture2D::loadLevels(const TextureLevel* levels, size_t levelCount)
+{
+	glGenTextures(1, &mTexture);
+	GLStateCache::Get().BindTexture(mTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	setFilter(levelCount);
+
+	mWidth = levels[0].width;
+	mHeight = levels[0].height;
+	mGpuBytes = 0;
+	for (size_t i = 0; i < levelCount; i++)
+	{
+		glTexImage2D(GL_TEXTURE_2D, (GLint)i, GL_RGBA, levels[i].width, levels[i].height, 0, GL_RGBA, GL_UNSIGNED_BYTE, levels[i].pixels);
+		mGpuBytes += (size_t)levels[i].width * levels[i].height * 4;
+	}
+
+	GLStateCache::Get().BindTexture(0);
+}
+
+//-----------------------------------------------------------------------------
+// Filtering of the bound texture: trilinear when it has its mip levels, so minified textures sample the
+// level that fits instead of aliasing level 0
+//-----------------------------------------------------------------------------
+void Texture2D::setFilter(size_t levelCount)
+{
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)levelCount - 1);
+}
+
+//-----------------------------------------------------------------------------
+// Invert image, swapping whole rows through a temporary row
+//-----------------------------------------------------------------------------
+void Texture2D::flipVertically(unsigned char* imageData, int width, int height)
+{
+	size_t widthInBytes = (size_t)width * 4;
+	std::vector<unsigned char> temp(widthInBytes);
+	int halfHeight = height / 2;
+	for (int row = 0; row < halfHeight; row++)
+	{
+		unsigned char* top = imageData + row * widthInBytes;
+		unsigned char* bottom = imageData + (height - row - 1) * widthInBytes;
+		memcpy(temp.data(), top, widthInBytes);
+		memcpy(top, bottom, widthInBytes);
+		memcpy(bottom, temp.data(), widthInBytes);
+	}
+}
+
+//-----------------------------------------------------------------------------
+// RGBA8 bytes of the texture, every mip level halves both sides (rounding down, but never below 1) until 1x1
+//-----------------------------------------------------------------------------
+size_t Texture2D::mipChainBytes(int width, int height, bool generateMipMaps)
+{
+	size_t bytes = (size_t)width * height * 4;
+	for (int levelWidth = width, levelHeight = height; generateMipMaps && (levelWidth > 1 || levelHeight > 1);)
+	{
+		levelWidth = levelWidth > 1 ? levelWidth / 2 : 1;
+		levelHeight = levelHeight > 1 ? levelHeight / 2 : 1;
+		bytes += (size_t)levelWidth * levelHeight * 4;
+	}
+	return bytes;
+}
+
 //-----------------------------------------------------------------------------
 // Bind the texture unit passed in as the active texture in the shader
 //-----------------------------------------------------------------------------
 void Texture2D::bind(GLuint texUnit) const
 {
-	assert(texUnit >= 0 && texUnit < 32);
+	assert(texUnit >= 0 && texUnit < STATE_CACHE_TEXTURE_UNITS);
 
-	glActiveTexture(GL_TEXTURE0 + texUnit);
-	glBindTexture(GL_TEXTURE_2D, mTexture);
+	GLStateCache::Get().BindTexture(texUnit, mTexture);
 }
 
 //-----------------------------------------------------------------------------
@@ -105,6 +178,5 @@ void Texture2D::bind(GLuint texUnit) const
 //-----------------------------------------------------------------------------
 void Texture2D::unbind(GLuint texUnit) const
 {
-	glActiveTexture(GL_TEXTURE0 + texUnit);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	GLStateCache::Get().BindTexture(texUnit, 0);
 }
@@ -0,0 +1,265 @@
+#include "TextureCache.h"
+#include "ThreadPool.h"
+#include "Utils.h"
+#include "stb_image.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+static const char TEXTURE_CACHE_MAGIC[4] = { 'M', 'V', 'T', 'X' };
+
+// Resolution of the linear light -> sRGB table, fine enough that near black rounds to the right byte
+static constexpr int LINEAR_TO_SRGB_STEPS = 16384;
+
+static_assert(sizeof(TextureCacheHeader) == 48, "TextureCacheHeader must not contain padding");
+
+std::string TextureCache::GetCacheFilePath(const std::string& sourceFilePath)
+{
+	return sourceFilePath + ".mvtex";
+}
+
+std::vector<TextureLevel> TextureCache::getLevelSizes(int width, int height)
+{
+	// Every level halves both sides (rounding down, but never below 1) until 1x1, like glGenerateMipmap
+	std::vector<TextureLevel> sizes(1, TextureLevel{ nullptr, width, height });
+	while (width > 1 || height > 1)
+	{
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+		sizes.push_back(TextureLevel{ nullptr, width, height });
+	}
+	return sizes;
+}
+
+void TextureCache::buildMipLevel(const TextureLevel& source, unsigned char* destination, const TextureLevel& level, MipFilter filter)
+{
+	struct SrgbTables
+	{
+		float toLinear[256];
+		unsigned char fromLinear[LINEAR_TO_SRGB_STEPS + 1];
+
+		SrgbTables()
+		{
+			for (int i = 0; i < 256; i++)
+			{
+				float value = i / 255.0f;
+				toLinear[i] = value <= 0.04045f ? value / 12.92f : std::pow((value + 0.055f) / 1.055f, 2.4f);
+			}
+			for (int i = 0; i <= LINEAR_TO_SRGB_STEPS; i++)
+			{
+				float value = (float)i / LINEAR_TO_SRGB_STEPS;
+				float srgb = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+				fromLinear[i] = (unsigned char)(srgb * 255.0f + 0.5f);
+			}
+		}
+	};
+	static const SrgbTables tables;
+
+	// Rows are independent, so they are split between the threads
+	ThreadPool::GetShared().ParallelFor((size_t)level.height, [&](size_t y)
+	{
+		// Average of the 2x2 source pixels, the last row/column is repeated where a side is already 1
+		const unsigned char* row0 = source.pixels + (size_t)std::min(2 * (int)y, source.height - 1) * source.width * 4;
+		const unsigned char* row1 = source.pixels + (size_t)std::min(2 * (int)y + 1, source.height - 1) * source.width * 4;
+		unsigned char* output = destination + y * level.width * 4;
+		for (int x = 0; x < level.width; x++)
+		{
+			int x0 = std::min(2 * x, source.width - 1) * 4;
+			int x1 = std::min(2 * x + 1, source.width - 1) * 4;
+			for (int c = 0; c < 4; c++)
+			{
+				// Alpha is never gamma encoded
+				if (filter == MipFilter::Srgb && c < 3)
+				{
+					float linear = (tables.toLinear[row0[x0 + c]] + tables.toLinear[row0[x1 + c]] +
+						tables.toLinear[row1[x0 + c]] + tables.toLinear[row1[x1 + c]]) * 0.25f;
+					output[c] = tables.fromLinear[(int)(linear * LINEAR_TO_SRGB_STEPS + 0.5f)];
+				}
+				else
+				{
+					output[c] = (unsigned char)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+				}
+			}
+			output += 4;
+		}
+	});
+}
+
+bool TextureCache::Decode(const unsigned char* fileData, size_t fileSize, MipFilter filter)
+{
+	file.Close();
+	levels.clear();
+
+	int width, height, components;
+	unsigned char* imageData = stbi_load_from_memory(fileData, (int)fileSize, &width, &height, &components, STBI_rgb_alpha);
+	if (imageData == nullptr)
+	{
+		return false;
+	}
+
+	levels = getLevelSizes(width, height);
+	size_t totalBytes = 0;
+	for (const TextureLevel& level : levels)
+	{
+		totalBytes += (size_t)level.width * level.height * 4;
+	}
+	pixels.resize(totalBytes);
+
+	// Invert image while copying it, OpenGL wants the bottom row first
+	size_t widthInBytes = (size_t)width * 4;
+	for (int row = 0; row < height; row++)
+	{
+		std::memcpy(pixels.data() + row * widthInBytes, imageData + (height - row - 1) * widthInBytes, widthInBytes);
+	}
+	stbi_image_free(imageData);
+
+	unsigned char* next = pixels.data();
+	for (size_t i = 0; i < levels.size(); i++)
+	{
+		levels[i].pixels = next;
+		if (i > 0)
+		{
+			buildMipLevel(levels[i - 1], next, levels[i], filter);
+		}
+		next += (size_t)levels[i].width * levels[i].height * 4;
+	}
+	return true;
+}
+
+bool TextureCache::Load(const std::string& sourceFilePath, uint64_t sourceSize, uint64_t sourceHash, MipFilter filter)
+{
+	pixels.clear();
+	levels.clear();
+	file.Close();
+
+	std::string cacheFilePath = GetCacheFilePath(sourceFilePath);
+	if (!file.Open(cacheFilePath))
+	{
+		// No cache yet
+		return false;
+	}
+
+	const char* reason = nullptr;
+	const TextureCacheHeader* header = (const TextureCacheHeader*)file.GetData();
+	const char* payload = file.GetData() + sizeof(TextureCacheHeader);
+	size_t payloadSize = 0;
+	std::vector<TextureLevel> sizes;
+
+	if (file.GetSize() < sizeof(TextureCacheHeader) || std::memcmp(header->magic, TEXTURE_CACHE_MAGIC, sizeof(TEXTURE_CACHE_MAGIC)) != 0)
+	{
+		reason = "not a texture cache";
+	}
+	else if (header->version != TEXTURE_CACHE_VERSION)
+	{
+		reason = "written by another version";
+	}
+	else if (header->width == 0 || header->height == 0 || header->width > 65536 || header->height > 65536 ||
+		(sizes = getLevelSizes((int)header->width, (int)header->height)).size() != header->levelCount)
+	{
+		reason = "corrupt";
+	}
+	else if (header->mipFilter != (uint32_t)filter)
+	{
+		reason = "built with another filter";
+	}
+	else if (header->sourceSize != sourceSize || header->sourceHash != sourceHash)
+	{
+		reason = "stale";
+	}
+	else
+	{
+		for (const TextureLevel& level : sizes)
+		{
+			payloadSize += (size_t)level.width * level.height * 4;
+		}
+		if (file.GetSize() != sizeof(TextureCacheHeader) + payloadSize)
+		{
+			reason = "truncated";
+		}
+		else if (Utils::HashBytes(payload, payloadSize) != header->payloadHash)
+		{
+			reason = "corrupt";
+		}
+	}
+
+	if (reason != nullptr)
+	{
+		std::cout << "Ignoring texture cache '" << cacheFilePath << "' (" << reason << ")" << std::endl;
+		file.Close();
+		return false;
+	}
+
+	levels = sizes;
+	const unsigned char* next = (const unsigned char*)payload;
+	for (TextureLevel& level : levels)
+	{
+		level.pixels = next;
+		next += (size_t)level.width * level.height * 4;
+	}
+	return true;
+}
+
+bool TextureCache::LoadOrDecode(const std::string& sourceFilePath, const MappedFile& source, uint64_t sourceHash, MipFilter filter, bool useCache)
+{
+	if (useCache && Load(sourceFilePath, source.GetSize(), sourceHash, filter))
+	{
+		return true;
+	}
+
+	if (!Decode((const unsigned char*)source.GetData(), source.GetSize(), filter))
+	{
+		std::cerr << "Error loading texture '" << sourceFilePath << "'" << std::endl;
+		return false;
+	}
+
+	if (useCache && !Save(sourceFilePath, source.GetSize(), sourceHash, filter))
+	{
+		std::cout << "Could not write the texture cache of '" << sourceFilePath << "'" << std::endl;
+	}
+	return true;
+}
+
+bool TextureCache::Save(const std::string& sourceFilePath, uint64_t sourceSize, uint64_t sourceHash, MipFilter filter) const
+{
+	if (pixels.empty())
+	{
+		return false;
+	}
+
+	TextureCacheHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, TEXTURE_CACHE_MAGIC, sizeof(TEXTURE_CACHE_MAGIC));
+	header.version = TEXTURE_CACHE_VERSION;
+	header.width = (uint32_t)levels[0].width;
+	header.height = (uint32_t)levels[0].height;
+	header.levelCount = (uint32_t)levels.size();
+	header.mipFilter = (uint32_t)filter;
+	header.sourceSize = sourceSize;
+	header.sourceHash = sourceHash;
+
+	// Decode keeps the levels in one block, laid out the way Load() sees them in the mapping
+	header.payloadHash = Utils::HashBytes(pixels.data(), pixels.size());
+
+	// See Utils::GetTemporaryFilePath
+	std::string cacheFilePath = GetCacheFilePath(sourceFilePath);
+	std::string temporaryFilePath = Utils::GetTemporaryFilePath(cacheFilePath);
+
+	FILE* output = std::fopen(temporaryFilePath.c_str(), "wb");
+	if (output == nullptr)
+	{
+		return false;
+	}
+
+	bool written = std::fwrite(&header, sizeof(header), 1, output) == 1;
+	written = written && std::fwrite(pixels.data(), pixels.size(), 1, output) == 1;
+	written = std::fclose(output) == 0 && written;
+
+	if (!written)
+	{
+		std::remove(temporaryFilePath.c_str());
+		return false;
+	}
+	return Utils::ReplaceFile(temporaryFilePath, cacheFilePath);
+}
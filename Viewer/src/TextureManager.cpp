@@ -0,0 +1,129 @@
+#include "TextureManager.h"
+#include "MappedFile.h"
+#include "TextureCache.h"
+#include "TextureStreamer.h"
+#include "Utils.h"
+#include <iostream>
+#include <iterator>
+#include <sstream>
+
+TextureManager::TextureManager() :
+	normalMapFile(Utils::GetDataFilePath(DEFAULT_NORMAL_MAP_FILE)),
+	memoryBudget(TEXTURE_MEMORY_BUDGET),
+	asyncLoading(true),
+	sharedLoads(0),
+	loadCount(0)
+{
+}
+
+TextureManager& TextureManager::Get()
+{
+	// Textures are kept until exit, so the ones still kept when the context is destroyed go with it
+	static TextureManager manager;
+	return manager;
+}
+
+std::shared_ptr<const Texture2D> TextureManager::Load(const std::string& filePath, const TextureLoadOptions& options)
+{
+	if (missingFiles.count(filePath) != 0)
+	{
+		return nullptr;
+	}
+
+	// Shared with the decoding job when the texture is streamed in
+	std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+	if (!file->Open(filePath))
+	{
+		std::cerr << "Error loading texture '" << filePath << "'" << std::endl;
+		missingFiles.insert(filePath);
+		return nullptr;
+	}
+
+	uint64_t sourceHash = Utils::HashBytes(file->GetData(), file->GetSize());
+	std::ostringstream key;
+	key << std::hex << sourceHash << (options.generateMipMaps ? "|mipmapped" : "") << (options.mipFilter == MipFilter::Linear ? "|linear" : "");
+	loadCount++;
+
+	auto entry = entries.find(key.str());
+	if (entry != entries.end() && entry->second.texture->hasFailed())
+	{
+		// Its decoding failed on a worker, the same as a synchronous load that fails
+		entries.erase(entry);
+		return nullptr;
+	}
+	if (entry != entries.end())
+	{
+		entry->second.lastLoad = loadCount;
+		sharedLoads++;
+		return entry->second.texture;
+	}
+
+	std::shared_ptr<Texture2D> texture = std::make_shared<Texture2D>();
+	if (asyncLoading)
+	{
+		TextureStreamer::Get().Load(texture, file, filePath, sourceHash, options);
+	}
+	else
+	{
+		TextureCache image;
+		if (!image.LoadOrDecode(filePath, *file, sourceHash, options.mipFilter, options.useTextureCache))
+		{
+			return nullptr;
+		}
+		texture->loadLevels(image.GetLevels().data(), options.generateMipMaps ? image.GetLevels().size() : 1);
+	}
+
+	entries[key.str()] = Entry{ texture, loadCount };
+	Trim();
+	return texture;
+}
+
+void TextureManager::Trim()
+{
+	// Textures whose decoding failed are never uploaded, the models that have them draw untextured
+	for (auto entry = entries.begin(); entry != entries.end();)
+	{
+		entry = entry->second.texture->hasFailed() ? entries.erase(entry) : std::next(entry);
+	}
+
+	// Streamed textures only take memory once they are uploaded, so the total is counted each time
+	size_t residentBytes = GetResidentBytes();
+	while (residentBytes > memoryBudget)
+	{
+		// The unused texture that was loaded the longest time ago
+		auto oldest = entries.end();
+		for (auto entry = entries.begin(); entry != entries.end(); ++entry)
+		{
+			// Textures still streaming in take no memory yet
+			bool unused = entry->second.texture.use_count() == 1 && entry->second.texture->isReady();
+			if (unused && (oldest == entries.end() || entry->second.lastLoad < oldest->second.lastLoad))
+			{
+				oldest = entry;
+			}
+		}
+		if (oldest == entries.end()) return;
+
+		residentBytes -= oldest->second.texture->getGpuBytes();
+		entries.erase(oldest);
+	}
+}
+
+size_t TextureManager::GetUnusedTextures() const
+{
+	size_t unused = 0;
+	for (const auto& entry : entries)
+	{
+		unused += entry.second.texture.use_count() == 1 ? 1 : 0;
+	}
+	return unused;
+}
+
+size_t TextureManager::GetResidentBytes() const
+{
+	size_t bytes = 0;
+	for (const auto& entry : entries)
+	{
+		bytes += entry.second.texture->getGpuBytes();
+	}
+	return bytes;
+}
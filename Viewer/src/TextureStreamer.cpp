@@ -0,0 +1,212 @@
+#include "TextureStreamer.h"
+#include "GLStateCache.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+TextureStreamer::TextureStreamer() :
+	upload{ std::weak_ptr<Texture2D>(), nullptr, 0 },
+	uploadTexture(0),
+	uploadLevel(0),
+	uploadRow(0),
+	placeholder(0),
+	pixelBuffers{},
+	nextPixelBuffer(0),
+	pendingTextures(0)
+{
+}
+
+TextureStreamer& TextureStreamer::Get()
+{
+	static TextureStreamer streamer;
+	return streamer;
+}
+
+void TextureStreamer::createBuffers()
+{
+	// Mid gray, so an untextured looking model doesn't flash white or black while its texture loads
+	const unsigned char gray[4] = { 128, 128, 128, 255 };
+	glGenTextures(1, &placeholder);
+	GLStateCache::Get().BindTexture(placeholder);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, gray);
+	GLStateCache::Get().BindTexture(0);
+
+	glGenBuffers(TEXTURE_STREAM_BUFFERS, pixelBuffers);
+}
+
+void TextureStreamer::Load(const std::shared_ptr<Texture2D>& texture, const std::shared_ptr<MappedFile>& file,
+	const std::string& fileName, uint64_t sourceHash, const TextureLoadOptions& options)
+{
+	if (placeholder == 0)
+	{
+		createBuffers();
+	}
+
+	texture->mTexture = placeholder;
+	texture->mPending = true;
+	pendingTextures++;
+
+	// The job only holds a weak handle, a texture that is released while it decodes is dropped
+	std::weak_ptr<Texture2D> weakTexture = texture;
+	ThreadPool::GetShared().Enqueue([this, weakTexture, file, fileName, sourceHash, options]()
+	{
+		ProfileZone zone("Prepare texture");
+		std::shared_ptr<TextureCache> image = std::make_shared<TextureCache>();
+		if (!image->LoadOrDecode(fileName, *file, sourceHash, options.mipFilter, options.useTextureCache))
+		{
+			// The render thread marks the texture failed, it is the only one that touches textures
+			image.reset();
+		}
+
+		size_t levelCount = image == nullptr ? 0 : options.generateMipMaps ? image->GetLevels().size() : 1;
+		std::lock_guard<std::mutex> lock(preparedMutex);
+		preparedImages.push_back(PreparedImage{ weakTexture, image, levelCount });
+	});
+}
+
+void TextureStreamer::Update()
+{
+	size_t budget = TEXTURE_STREAM_BYTES_PER_FRAME;
+	bool uploaded = false;
+	while (budget > 0)
+	{
+		if (upload.image == nullptr)
+		{
+			PreparedImage prepared;
+			{
+				std::lock_guard<std::mutex> lock(preparedMutex);
+				if (preparedImages.empty()) break;
+				prepared = preparedImages.front();
+				preparedImages.pop_front();
+			}
+			if (prepared.image == nullptr)
+			{
+				failTexture(prepared.texture);
+				continue;
+			}
+			upload = prepared;
+			beginUpload();
+			continue;
+		}
+
+		// Whole rows, at least one even if a row is over the budget
+		const TextureLevel& level = upload.image->GetLevels()[uploadLevel];
+		size_t rowBytes = (size_t)level.width * 4;
+		int rows = (int)std::min<size_t>(level.height - uploadRow, std::max<size_t>(1, budget / rowBytes));
+		size_t bytes = rows * rowBytes;
+		const unsigned char* source = level.pixels + uploadRow * rowBytes;
+
+		// The invalidated buffer gets fresh storage, the driver may still be reading the old one
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelBuffers[nextPixelBuffer]);
+		nextPixelBuffer = (nextPixelBuffer + 1) % TEXTURE_STREAM_BUFFERS;
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+		void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+
+		GLStateCache::Get().BindTexture(uploadTexture);
+		if (mapped != nullptr)
+		{
+			memcpy(mapped, source, bytes);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			glTexSubImage2D(GL_TEXTURE_2D, (GLint)uploadLevel, 0, uploadRow, level.width, rows, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		}
+		else
+		{
+			// Couldn't map the buffer, upload from the decoded pixels instead
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			glTexSubImage2D(GL_TEXTURE_2D, (GLint)uploadLevel, 0, uploadRow, level.width, rows, GL_RGBA, GL_UNSIGNED_BYTE, source);
+		}
+		uploaded = true;
+
+		uploadRow += rows;
+		budget -= std::min(budget, bytes);
+		if (uploadRow == level.height)
+		{
+			uploadLevel++;
+			uploadRow = 0;
+			if (uploadLevel == upload.levelCount)
+			{
+				finishUpload();
+			}
+		}
+	}
+
+	if (uploaded)
+	{
+		GLStateCache::Get().BindTexture(0);
+	}
+}
+
+void TextureStreamer::beginUpload()
+{
+	if (upload.texture.expired())
+	{
+		releaseUpload();
+		return;
+	}
+
+	// Storage of every level only, the pixels follow row by row
+	glGenTextures(1, &uploadTexture);
+	GLStateCache::Get().BindTexture(uploadTexture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	Texture2D::setFilter(upload.levelCount);
+	for (size_t i = 0; i < upload.levelCount; i++)
+	{
+		const TextureLevel& level = upload.image->GetLevels()[i];
+		glTexImage2D(GL_TEXTURE_2D, (GLint)i, GL_RGBA, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	}
+	GLStateCache::Get().BindTexture(0);
+	uploadLevel = 0;
+	uploadRow = 0;
+}
+
+void TextureStreamer::finishUpload()
+{
+	std::shared_ptr<Texture2D> texture = upload.texture.lock();
+	if (texture)
+	{
+		const std::vector<TextureLevel>& levels = upload.image->GetLevels();
+		texture->mTexture = uploadTexture;
+		texture->mWidth = levels[0].width;
+		texture->mHeight = levels[0].height;
+		texture->mGpuBytes = 0;
+		for (size_t i = 0; i < upload.levelCount; i++)
+		{
+			texture->mGpuBytes += (size_t)levels[i].width * levels[i].height * 4;
+		}
+		texture->mPending = false;
+	}
+	else
+	{
+		GLStateCache::Get().DeleteTexture(uploadTexture);
+	}
+
+	uploadTexture = 0;
+	releaseUpload();
+}
+
+void TextureStreamer::releaseUpload()
+{
+	upload.image.reset();
+	pendingTextures--;
+}
+
+void TextureStreamer::failTexture(const std::weak_ptr<Texture2D>& texture)
+{
+	// Not the placeholder any more, so a model that has it is drawn untextured and TextureManager drops it
+	std::shared_ptr<Texture2D> failed = texture.lock();
+	if (failed)
+	{
+		failed->mTexture = 0;
+		failed->mPending = false;
+		failed->mFailed = true;
+	}
+	pendingTextures--;
+}
@@ -0,0 +1,142 @@
+#include "ThreadPool.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <exception>
+#include <memory>
+
+ThreadPool::ThreadPool(unsigned int workerCount) : stopping(false)
+{
+	for (unsigned int i = 0; i < workerCount; i++)
+	{
+		workers.emplace_back(&ThreadPool::workerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(tasksMutex);
+		stopping = true;
+	}
+	taskAvailable.notify_all();
+
+	for (auto& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+ThreadPool& ThreadPool::GetShared()
+{
+	// The calling thread also works in ParallelFor, so leave one core for it, but always have a worker
+	// for the tasks that run in the background
+	static ThreadPool sharedPool(std::max(2u, std::thread::hardware_concurrency()) - 1);
+	return sharedPool;
+}
+
+void ThreadPool::workerLoop()
+{
+	Profiler::Get().SetThreadName("Worker");
+
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(tasksMutex);
+			taskAvailable.wait(lock, [this] { return stopping || !tasks.empty(); });
+
+			if (stopping && tasks.empty())
+			{
+				return;
+			}
+
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+
+		task();
+	}
+}
+
+void ThreadPool::Enqueue(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(tasksMutex);
+		tasks.push_back(std::move(task));
+	}
+	taskAvailable.notify_one();
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& body, unsigned int maxThreads)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	unsigned int threads = maxThreads == 0 ? GetConcurrency() : std::min(maxThreads, GetConcurrency());
+	size_t helpers = std::min<size_t>(threads, count) - 1;
+	if (helpers == 0)
+	{
+		for (size_t i = 0; i < count; i++) body(i);
+		return;
+	}
+
+	// Helpers may only get scheduled after the caller is done with the whole range,
+	// so the shared state must outlive this function.
+	struct SharedState
+	{
+		std::atomic<size_t> next{ 0 };
+		std::atomic<size_t> done{ 0 };
+		std::mutex doneMutex;
+		std::condition_variable allDone;
+		std::exception_ptr exception;       // The first one body threw, guarded by doneMutex
+	};
+	auto state = std::make_shared<SharedState>();
+
+	auto work = [state, count, &body]()
+	{
+		size_t finished = 0;
+		for (size_t i = state->next++; i < count; i = state->next++)
+		{
+			try
+			{
+				body(i);
+			}
+			catch (...)
+			{
+				// No more indices are handed out, the ones nobody claimed yet count as done
+				size_t claimed = state->next.exchange(count);
+				finished += claimed < count ? count - claimed : 0;
+
+				std::lock_guard<std::mutex> lock(state->doneMutex);
+				if (!state->exception)
+				{
+					state->exception = std::current_exception();
+				}
+			}
+			finished++;
+		}
+
+		if (finished > 0 && state->done.fetch_add(finished) + finished == count)
+		{
+			std::lock_guard<std::mutex> lock(state->doneMutex);
+			state->allDone.notify_all();
+		}
+	};
+
+	for (size_t i = 0; i < helpers; i++)
+	{
+		// A helper that starts late finds no indices left and never touches body
+		Enqueue(work);
+	}
+	work();
+
+	// Even after a throw, body stays in use until the calls already running return
+	std::unique_lock<std::mutex> lock(state->doneMutex);
+	state->allDone.wait(lock, [&state, count] { return state->done.load() == count; });
+	if (state->exception)
+	{
+		std::rethrow_exception(state->exception);
+	}
+}
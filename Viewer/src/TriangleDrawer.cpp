@@ -1,4 +1,6 @@
 #include "TriangleDrawer.h"
+#include "GLStateCache.h"
+#include "FrameStatistics.h"
 
 #pragma region Constructors
 
@@ -10,22 +12,40 @@
 void TriangleDrawer::SetModel(const IMeshObject * model)
 {
 	vao = model->GetVao();
-	verticesNumber = model->GetNumberOfVertices();
+	indicesNumber = model->GetNumberOfIndices();
+	indexType = model->GetIndexType();
+	indicesOffset = model->GetFirstIndex() * (indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint));
 }
 
 void TriangleDrawer::DrawTriangles() const
 {
-	glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-	glBindVertexArray(vao);
-	glDrawArrays(GL_TRIANGLES, 0, verticesNumber);
-	glBindVertexArray(0);
+	GLStateCache::Get().PolygonMode(GL_LINE);
+	GLStateCache::Get().BindVertexArray(vao);
+	glDrawElements(GL_TRIANGLES, indicesNumber, indexType, (GLvoid*)indicesOffset);
+	FrameStatistics::Get().CountDraw(indicesNumber / NUM_VERTICES);
 }
 
 void TriangleDrawer::FillTriangles() const
 {
-	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-	glBindVertexArray(vao);
-	glDrawArrays(GL_TRIANGLES, 0, verticesNumber);
-	glBindVertexArray(0);
+	GLStateCache::Get().PolygonMode(GL_FILL);
+	GLStateCache::Get().BindVertexArray(vao);
+	glDrawElements(GL_TRIANGLES, indicesNumber, indexType, (GLvoid*)indicesOffset);
+	FrameStatistics::Get().CountDraw(indicesNumber / NUM_VERTICES);
+}
+
+void TriangleDrawer::DrawTrianglesInstanced(GLsizei instanceCount) const
+{
+	GLStateCache::Get().PolygonMode(GL_LINE);
+	GLStateCache::Get().BindVertexArray(vao);
+	glDrawElementsInstanced(GL_TRIANGLES, indicesNumber, indexType, (GLvoid*)indicesOffset, instanceCount);
+	FrameStatistics::Get().CountDraw((size_t)(indicesNumber / NUM_VERTICES) * instanceCount);
+}
+
+void TriangleDrawer::FillTrianglesInstanced(GLsizei instanceCount) const
+{
+	GLStateCache::Get().PolygonMode(GL_FILL);
+	GLStateCache::Get().BindVertexArray(vao);
+	glDrawElementsInstanced(GL_TRIANGLES, indicesNumber, indexType, (GLvoid*)indicesOffset, instanceCount);
+	FrameStatistics::Get().CountDraw((size_t)(indicesNumber / NUM_VERTICES) * instanceCount);
 }
 #pragma endregion PublicMethods
\ No newline at end of file
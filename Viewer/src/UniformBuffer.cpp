@@ -0,0 +1,49 @@
+#include "UniformBuffer.h"
+
+//-----------------------------------------------------------------------------
+// Constructor
+//-----------------------------------------------------------------------------
+UniformBuffer::UniformBuffer()
+	: buffer(0), bindingPoint(0), size(0)
+{
+}
+
+//-----------------------------------------------------------------------------
+// Destructor
+//-----------------------------------------------------------------------------
+UniformBuffer::~UniformBuffer()
+{
+	glDeleteBuffers(1, &buffer);
+}
+
+//-----------------------------------------------------------------------------
+// Creates the buffer and attaches it to its binding point
+//-----------------------------------------------------------------------------
+void UniformBuffer::Create(GLuint bindingPoint, size_t size)
+{
+	this->bindingPoint = bindingPoint;
+	this->size = size;
+
+	if (buffer == 0)
+	{
+		glGenBuffers(1, &buffer);
+	}
+
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+//-----------------------------------------------------------------------------
+// Uploads new contents
+//-----------------------------------------------------------------------------
+void UniformBuffer::Update(const void* data, size_t dataSize)
+{
+	if (buffer == 0 || dataSize > size) return;
+
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, dataSize, data);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
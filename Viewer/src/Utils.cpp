@@ -1,9 +1,28 @@
 #include "Utils.h"
+#include "ObjParser.h"
+#include "MeshCache.h"
+#include "MeshAssetCache.h"
+#include "VertexWelder.h"
+#include "NormalGenerator.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "VertexQuantizer.h"
+#include <atomic>
 #include <cmath>
+#include <cstdio>
 #include <string>
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <stdexcept>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
 
 glm::vec3 Utils::Vec3fFromStream(std::istream& issLine)
 {
@@ -97,57 +116,186 @@ glm::vec3 Utils::ScreenVec3FromWorldPoint(const glm::vec4& _worldPoint, int _vie
 	return screenPoint;
 }
 
-MeshModel* Utils::LoadMeshModel(const std::string& filePath)
+MeshModel* Utils::LoadMeshModel(const std::string& filePath, const MeshLoadOptions& options)
 {
-	std::vector<Face> faces;
-	std::vector<glm::vec3> vertices;
-	std::vector<glm::vec3> normals;
-	std::vector<glm::vec2> textureCoords;
-	std::ifstream ifile(filePath.c_str());
+	auto start = std::chrono::high_resolution_clock::now();
+	std::string modelName = Utils::GetFileName(filePath);
+	std::string textureFilePath = Utils::GetTextureFileName(filePath);
 
-	// while not end of file
-	while (!ifile.eof())
+	// Fastest path: the file is already on the GPU
+	MeshAssetCache& assetCache = MeshAssetCache::Get();
+	std::string assetKey = options.shareGpuMeshes ? MeshAssetCache::GetKey(filePath, options.GetBuildKey()) : std::string();
+	std::shared_ptr<const GpuMesh> gpuMesh = assetCache.Find(assetKey);
+	if (gpuMesh)
 	{
-		// get line
-		std::string curLine;
-		std::getline(ifile, curLine);
-
-		// read the type of the line
-		std::istringstream issLine(curLine);
-		std::string lineType;
-
-		issLine >> std::ws >> lineType;
+		MeshModel* model = new MeshModel(gpuMesh, modelName, textureFilePath);
+		std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+		std::cout << "Loaded '" << modelName << "' from the resident meshes in " << elapsed.count() * 1000.0 << " ms" << std::endl;
+		return model;
+	}
 
-		// based on the type parse data
-		if (lineType == "v")
-		{
-			vertices.push_back(Utils::Vec3fFromStream(issLine));
-		}
-		else if (lineType == "vn")
-		{
-			normals.push_back(Utils::Vec3fFromStream(issLine));
-		}
-		else if (lineType == "vt")
-		{
-			textureCoords.push_back(Utils::Vec2fFromStream(issLine));
-		}
-		else if (lineType == "f")
+	// Fast path: the vertex buffer goes straight from the mapped cache file to the GPU
+	if (options.useMeshCache)
+	{
+		MeshCache cache;
+		if (cache.Load(filePath, options.GetBuildKey()))
 		{
-			faces.push_back(Face(issLine));
+			MeshModel* model = new MeshModel(assetCache.Add(assetKey, cache.GetMesh()), modelName, textureFilePath);
+			std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+			std::cout << "Loaded '" << modelName << "' from its mesh cache in " << elapsed.count() * 1000.0 << " ms" << std::endl;
+			return model;
 		}
-		else if (lineType == "#" || lineType == "")
+	}
+
+	ObjData objData;
+	ObjParseStatistics statistics;
+
+	if (!ObjParser::ParseFile(filePath, objData, statistics, options.parserThreads))
+	{
+		std::cerr << "Error loading model '" << filePath << "'" << std::endl;
+		return nullptr;
+	}
+
+	std::cout << "Parsed '" << modelName << "': "
+		<< statistics.bytes / (1024.0 * 1024.0) << " MB in " << statistics.seconds * 1000.0 << " ms ("
+		<< statistics.GetMegabytesPerSecond() << " MB/s)" << std::endl;
+
+	if (objData.unknownLines > 0)
+	{
+		std::cout << "Skipped " << objData.unknownLines << " lines of unknown type" << std::endl;
+	}
+
+	// The normals in the file (if any) are ignored, they are always generated. This is also where faces that
+	// refer to vertices the file doesn't have are found.
+	bool splitCreases = options.creaseAngle < 180.0f;
+	std::vector<glm::vec3> normals;
+	try
+	{
+		normals = splitCreases ?
+			NormalGenerator::GenerateWithCreases(objData.vertices, objData.faces, options.creaseAngle, options.normalWeighting) :
+			NormalGenerator::Generate(objData.vertices, objData.faces, options.normalWeighting);
+	}
+	catch (const std::out_of_range& error)
+	{
+		std::cerr << "Error loading model '" << filePath << "': " << error.what() << std::endl;
+		return nullptr;
+	}
+	MeshData meshData = Utils::BuildMeshData(objData.faces, objData.vertices, normals, objData.textureCoords, splitCreases);
+	if (options.optimizeMesh)
+	{
+		MeshOptimizationStatistics optimization;
+		MeshOptimizer::Optimize(meshData, optimization);
+		meshData.CalculateBounds();
+		std::cout << "Optimized '" << modelName << "' in " << optimization.seconds * 1000.0 << " ms: ACMR "
+			<< optimization.before.acmr << " -> " << optimization.after.acmr << ", ATVR "
+			<< optimization.before.atvr << " -> " << optimization.after.atvr << std::endl;
+	}
+
+	if (options.lodLevels > 0)
+	{
+		auto lodStart = std::chrono::high_resolution_clock::now();
+		MeshSimplifier::GenerateLods(meshData, options.lodLevels);
+		std::chrono::duration<double> lodElapsed = std::chrono::high_resolution_clock::now() - lodStart;
+
+		if (!meshData.lods.empty())
 		{
-			// comment / empty line
+			std::cout << "Levels of detail of '" << modelName << "' (" << lodElapsed.count() * 1000.0 << " ms):";
+			for (const MeshLod& lod : meshData.lods)
+			{
+				std::cout << " " << lod.indexCount / 3 << " triangles (error " << lod.error << ")";
+			}
+			std::cout << std::endl;
 		}
-		else
+	}
+
+	QuantizationError quantizationError;
+	VertexFormat vertexFormat = VertexQuantizer::ChooseFormat(meshData.GetView(), options.vertexFormat, quantizationError);
+	std::vector<uint8_t> quantizedVertices;
+	MeshView mesh = VertexQuantizer::Quantize(meshData.GetView(), vertexFormat, quantizedVertices);
+	std::cout << "Vertex format of '" << modelName << "': " << VertexQuantizer::GetFormatName(vertexFormat)
+		<< ", max errors: position " << quantizationError.position << " of the bounding box diagonal, normal "
+		<< quantizationError.normalDegrees << " degrees, texture coordinates " << quantizationError.textureCoords << std::endl;
+	Utils::PrintMeshMemory(modelName, mesh);
+
+	if (options.useMeshCache && !MeshCache::Save(filePath, mesh, options.GetBuildKey()))
+	{
+		std::cout << "Could not write the mesh cache of '" << modelName << "'" << std::endl;
+	}
+
+	MeshModel* model = new MeshModel(assetCache.Add(assetKey, mesh), modelName, textureFilePath);
+	std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+	std::cout << "Loaded '" << modelName << "' in " << elapsed.count() * 1000.0 << " ms" << std::endl;
+	return model;
+}
+
+// Builds the indexed vertex layout the GPU buffers use. Corners that end up with the same position,
+// normal and texture coordinates are welded into a single vertex.
+// Normals are looked up by vertex index, or by the faces' normal indices when useNormalIndices is set.
+MeshData Utils::BuildMeshData(const std::vector<Face>& faces, const std::vector<glm::vec3>& vertices, const std::vector<glm::vec3>& normals, const std::vector<glm::vec2>& textureCoords, bool useNormalIndices)
+{
+	MeshData meshData;
+	VertexWelder welder(meshData, 3 * faces.size());
+	for (unsigned int i = 0; i < faces.size(); i++)
+	{
+		const Face& currentFace = faces[i];
+		for (int j = 0; j < 3; j++)
 		{
-			std::cout << "Found unknown line Type \"" << lineType << "\"";
+			int vertexIndex = currentFace.GetVertexIndex(j) - 1;
+
+			Vertex vertex;
+			vertex.position = vertices[vertexIndex];
+			vertex.normal = normals[useNormalIndices ? currentFace.GetNormalIndex(j) - 1 : vertexIndex];
+
+			if (textureCoords.size() > 0)
+			{
+				int textureCoordsIndex = currentFace.GetTextureIndex(j) - 1;
+				vertex.textureCoords = textureCoords[textureCoordsIndex];
+			}
+
+			welder.AddCorner(vertex);
 		}
 	}
 
-	//return MeshModel(faces, vertices, normals, Utils::GetFileName(filePath));
-	std::string textureFilePath = Utils::GetTextureFileName(filePath);
-	return new MeshModel(faces, vertices, textureCoords, Utils::GetFileName(filePath), textureFilePath);
+	meshData.CalculateBounds();
+	return meshData;
+}
+
+void Utils::PrintMeshMemory(const std::string& modelName, const MeshView& mesh)
+{
+	// Sizes as uploaded, and what the same mesh took as one vertex per corner drawn with glDrawArrays
+	std::vector<uint16_t> shortIndices;
+	MeshView uploaded = mesh.WithShortIndices(shortIndices);
+	size_t corners = mesh.GetLod(0).indexCount;
+	size_t deindexedBytes = corners * sizeof(Vertex);
+	size_t indexedBytes = uploaded.GetVertexBytes() + uploaded.GetIndexBytes();
+
+	std::cout << "'" << modelName << "': " << mesh.vertexCount << " vertices for " << corners << " corners, "
+		<< deindexedBytes / 1024.0 << " KB -> " << indexedBytes / 1024.0 << " KB ("
+		<< GetVertexStride(uploaded.vertexFormat) << " byte vertices, " << 8 * uploaded.indexSize << " bit indices)" << std::endl;
+}
+
+uint64_t Utils::HashBytes(const void* data, size_t size)
+{
+	// FNV-1a, but on 8 bytes at a time with an extra shift to mix the high bits down
+	const uint64_t prime = 0x100000001b3ull;
+	const unsigned char* bytes = (const unsigned char*)data;
+	uint64_t hash = 0xcbf29ce484222325ull ^ size;
+
+	size_t i = 0;
+	for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t))
+	{
+		uint64_t word;
+		std::memcpy(&word, bytes + i, sizeof(word));
+		hash = (hash ^ word) * prime;
+		hash ^= hash >> 29;
+	}
+
+	for (; i < size; i++)
+	{
+		hash = (hash ^ bytes[i]) * prime;
+	}
+
+	return hash;
 }
 
 std::string Utils::GetFileName(const std::string& filePath)
@@ -186,6 +334,43 @@ std::string Utils::GetFileName(const std::string& filePath)
 	return filePath.substr(index + 1, len - index);
 }
 
+std::string Utils::GetTemporaryFilePath(const std::string& filePath)
+{
+	static std::atomic<unsigned int> counter(0);
+#ifdef _WIN32
+	int process = _getpid();
+#else
+	int process = (int)getpid();
+#endif
+	return filePath + "." + std::to_string(process) + "." + std::to_string(counter++) + ".tmp";
+}
+
+bool Utils::ReplaceFile(const std::string& temporaryFilePath, const std::string& filePath)
+{
+#ifdef _WIN32
+	// rename() doesn't replace existing files on Windows
+	std::remove(filePath.c_str());
+#endif
+	// Elsewhere rename() replaces the file at once, readers see the old file or the new one
+	if (std::rename(temporaryFilePath.c_str(), filePath.c_str()) != 0)
+	{
+		std::remove(temporaryFilePath.c_str());
+		return false;
+	}
+	return true;
+}
+
+#ifndef MESHVIEWER_DATA_DIR
+// Relative to the working directory when the build doesn't say where the repository is
+#define MESHVIEWER_DATA_DIR "Data"
+#endif
+
+std::string Utils::GetDataFilePath(const std::string& fileName)
+{
+	const char* directory = std::getenv("MESHVIEWER_DATA_DIR");
+	return std::string(directory != nullptr && *directory != '\0' ? directory : MESHVIEWER_DATA_DIR) + "/" + fileName;
+}
+
 std::string Utils::GetTextureFileName(std::string filePath)
 {
 	size_t index = filePath.find_last_of(".");
@@ -228,48 +413,9 @@ glm::mat4 Utils::zRotationMatrix(float rotationAngle)
 	return rotationMatrix;
 }
 
-std::vector<glm::vec3> Utils::CalculateNormals(std::vector<glm::vec3> vertices, std::vector<Face> faces)
+std::vector<glm::vec3> Utils::CalculateNormals(const std::vector<glm::vec3>& vertices, const std::vector<Face>& faces)
 {
-	std::vector<glm::vec3> normals(vertices.size());
-	std::vector<int> adjacent_faces_count(vertices.size());
-
-	for (unsigned int i = 0; i < adjacent_faces_count.size(); i++)
-	{
-		adjacent_faces_count[i] = 0;
-	}
-
-	for (unsigned int i = 0; i < faces.size(); i++)
-	{
-		Face currentFace = faces.at(i);
-
-		int index0 = currentFace.GetVertexIndex(0) - 1;
-		int index1 = currentFace.GetVertexIndex(1) - 1;
-		int index2 = currentFace.GetVertexIndex(2) - 1;
-
-		glm::vec3 v0 = vertices.at(index0);
-		glm::vec3 v1 = vertices.at(index1);
-		glm::vec3 v2 = vertices.at(index2);
-
-		glm::vec3 u = v0 - v1;
-		glm::vec3 v = v2 - v1;
-		glm::vec3 face_normal = glm::normalize(-glm::cross(u, v));
-
-		normals.at(index0) += face_normal;
-		normals.at(index1) += face_normal;
-		normals.at(index2) += face_normal;
-
-		adjacent_faces_count.at(index0) += 1;
-		adjacent_faces_count.at(index1) += 1;
-		adjacent_faces_count.at(index2) += 1;
-	}
-
-	for (unsigned int i = 0; i < normals.size(); i++)
-	{
-		normals[i] /= adjacent_faces_count[i];
-		normals[i] = glm::normalize(normals[i]);
-	}
-
-	return normals;
+	return NormalGenerator::Generate(vertices, faces, NormalWeighting::Average);
 }
 
 float Utils::degreesToRadians(float degrees)
@@ -0,0 +1,350 @@
+#include "VertexQuantizer.h"
+#include "ThreadPool.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static_assert(sizeof(Vertex) == 32, "GetVertexStride(VertexFormat::Float) must be sizeof(Vertex)");
+
+static constexpr size_t QUANTIZER_BATCH_SIZE = 16384;
+
+// Byte offsets of the attributes inside the quantized layouts
+static constexpr size_t QUANTIZED_POSITION_OFFSET = 0;       // 3x uint16
+static constexpr size_t QUANTIZED16_NORMAL_OFFSET = 8;       // 2x uint16 (after 2 bytes of padding)
+static constexpr size_t QUANTIZED16_TEXTURE_OFFSET = 12;     // 2x half
+static constexpr size_t QUANTIZED8_NORMAL_OFFSET = 6;        // 2x uint8
+static constexpr size_t QUANTIZED8_TEXTURE_OFFSET = 8;       // 2x half
+
+static uint16_t floatToHalf(float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+	uint32_t magnitude = bits & 0x7FFFFFFF;
+
+	if (magnitude >= 0x7F800000)
+	{
+		// Infinity or NaN
+		return sign | 0x7C00 | (magnitude > 0x7F800000 ? 0x200 : 0);
+	}
+	if (magnitude >= 0x477FF000)
+	{
+		// Rounds to more than 65504
+		return sign | 0x7C00;
+	}
+	if (magnitude < 0x38800000)
+	{
+		// Subnormal half, its unit is 2^-24
+		float absolute;
+		std::memcpy(&absolute, &magnitude, sizeof(absolute));
+		return sign | (uint16_t)std::lrint(absolute * 16777216.0f);
+	}
+
+	// Round to nearest even, then rebias the exponent from 127 to 15
+	uint32_t rounded = magnitude + 0xFFF + ((magnitude >> 13) & 1);
+	return sign | (uint16_t)((rounded - (112u << 23)) >> 13);
+}
+
+static float halfToFloat(uint16_t half)
+{
+	uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+	uint32_t exponent = (half >> 10) & 0x1F;
+	uint32_t mantissa = half & 0x3FF;
+
+	if (exponent == 0)
+	{
+		float value = mantissa / 16777216.0f;
+		return sign ? -value : value;
+	}
+
+	uint32_t bits = sign | (exponent == 31 ? 0x7F800000 : (exponent + 112) << 23) | (mantissa << 13);
+	float value;
+	std::memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+// Unsigned normalized values, converted the way the GPU converts them: stored / maxValue
+static uint32_t toUnorm(float value, uint32_t maxValue)
+{
+	return (uint32_t)std::lrint(glm::clamp(value, 0.0f, 1.0f) * maxValue);
+}
+
+static float fromUnorm(uint32_t stored, uint32_t maxValue)
+{
+	return stored / (float)maxValue;
+}
+
+// Must match decodeOctahedral() in the vertex shaders
+static glm::vec3 decodeOctahedral(const glm::vec2& encoded)
+{
+	glm::vec3 normal(encoded.x, encoded.y, 1.0f - std::abs(encoded.x) - std::abs(encoded.y));
+	float fold = std::max(-normal.z, 0.0f);
+	normal.x += normal.x >= 0.0f ? -fold : fold;
+	normal.y += normal.y >= 0.0f ? -fold : fold;
+	return glm::normalize(normal);
+}
+
+// Octahedral encoding in [-1, 1]^2, stored as two unorm values in [0, maxValue]. Out of the four
+// roundings of the encoded point, the one that decodes closest to the normal is kept.
+static void encodeOctahedral(const glm::vec3& normal, uint32_t maxValue, uint32_t& storedX, uint32_t& storedY)
+{
+	float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+	if (length == 0.0f)
+	{
+		storedX = storedY = toUnorm(0.5f, maxValue);
+		return;
+	}
+
+	glm::vec2 encoded(normal.x / length, normal.y / length);
+	if (normal.z < 0.0f)
+	{
+		encoded = glm::vec2(
+			(1.0f - std::abs(encoded.y)) * (encoded.x >= 0.0f ? 1.0f : -1.0f),
+			(1.0f - std::abs(encoded.x)) * (encoded.y >= 0.0f ? 1.0f : -1.0f));
+	}
+
+	glm::vec3 direction = normal / glm::length(normal);
+	float scaledX = (encoded.x * 0.5f + 0.5f) * maxValue;
+	float scaledY = (encoded.y * 0.5f + 0.5f) * maxValue;
+	uint32_t baseX = (uint32_t)std::min(std::floor(scaledX), (float)maxValue);
+	uint32_t baseY = (uint32_t)std::min(std::floor(scaledY), (float)maxValue);
+
+	float bestDot = -2.0f;
+	for (uint32_t i = 0; i < 4; i++)
+	{
+		uint32_t x = std::min(baseX + (i & 1), maxValue);
+		uint32_t y = std::min(baseY + (i >> 1), maxValue);
+		glm::vec3 decoded = decodeOctahedral(glm::vec2(fromUnorm(x, maxValue) * 2.0f - 1.0f, fromUnorm(y, maxValue) * 2.0f - 1.0f));
+		float dot = glm::dot(decoded, direction);
+		if (dot > bestDot)
+		{
+			bestDot = dot;
+			storedX = x;
+			storedY = y;
+		}
+	}
+}
+
+const char* VertexQuantizer::GetFormatName(VertexFormat format)
+{
+	switch (format)
+	{
+	case VertexFormat::Float:       return "float";
+	case VertexFormat::Quantized16: return "quantized (16 bit normals)";
+	case VertexFormat::Quantized8:  return "quantized (8 bit normals)";
+	default:                        return "auto";
+	}
+}
+
+VertexDecoding VertexQuantizer::GetDecoding(VertexFormat format, const glm::vec3& minimums, const glm::vec3& maximums)
+{
+	VertexDecoding decoding;
+	if (format == VertexFormat::Quantized16 || format == VertexFormat::Quantized8)
+	{
+		decoding.positionOffset = minimums;
+		decoding.positionScale = maximums - minimums;
+		decoding.octahedralNormals = true;
+	}
+	return decoding;
+}
+
+void VertexQuantizer::SetupAttributes(VertexFormat format)
+{
+	GLsizei stride = (GLsizei)GetVertexStride(format);
+
+	if (format == VertexFormat::Float)
+	{
+		// Vertex Positions
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (GLvoid*)0);
+		// Normals attribute
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(3 * sizeof(GLfloat)));
+		// Vertex Texture Coords
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (GLvoid*)(6 * sizeof(GLfloat)));
+	}
+	else
+	{
+		bool shortNormals = format == VertexFormat::Quantized16;
+		glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, stride, (GLvoid*)QUANTIZED_POSITION_OFFSET);
+		glVertexAttribPointer(1, 2, shortNormals ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE, GL_TRUE, stride,
+			(GLvoid*)(shortNormals ? QUANTIZED16_NORMAL_OFFSET : QUANTIZED8_NORMAL_OFFSET));
+		glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride,
+			(GLvoid*)(shortNormals ? QUANTIZED16_TEXTURE_OFFSET : QUANTIZED8_TEXTURE_OFFSET));
+	}
+
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glEnableVertexAttribArray(2);
+}
+
+void VertexQuantizer::encodeVertex(const Vertex& vertex, VertexFormat format, const VertexDecoding& decoding, uint8_t* output)
+{
+	uint16_t position[3];
+	for (int i = 0; i < 3; i++)
+	{
+		float scale = decoding.positionScale[i];
+		float relative = scale > 0.0f ? (vertex.position[i] - decoding.positionOffset[i]) / scale : 0.0f;
+		position[i] = (uint16_t)toUnorm(relative, 0xFFFF);
+	}
+	std::memcpy(output + QUANTIZED_POSITION_OFFSET, position, sizeof(position));
+
+	uint16_t textureCoords[2] = { floatToHalf(vertex.textureCoords.x), floatToHalf(vertex.textureCoords.y) };
+	uint32_t normalX, normalY;
+
+	if (format == VertexFormat::Quantized16)
+	{
+		encodeOctahedral(vertex.normal, 0xFFFF, normalX, normalY);
+		uint16_t normal[2] = { (uint16_t)normalX, (uint16_t)normalY };
+		std::memset(output + 6, 0, 2);
+		std::memcpy(output + QUANTIZED16_NORMAL_OFFSET, normal, sizeof(normal));
+		std::memcpy(output + QUANTIZED16_TEXTURE_OFFSET, textureCoords, sizeof(textureCoords));
+	}
+	else
+	{
+		encodeOctahedral(vertex.normal, 0xFF, normalX, normalY);
+		output[QUANTIZED8_NORMAL_OFFSET] = (uint8_t)normalX;
+		output[QUANTIZED8_NORMAL_OFFSET + 1] = (uint8_t)normalY;
+		std::memcpy(output + QUANTIZED8_TEXTURE_OFFSET, textureCoords, sizeof(textureCoords));
+	}
+}
+
+Vertex VertexQuantizer::decodeVertex(const uint8_t* input, VertexFormat format, const VertexDecoding& decoding)
+{
+	uint16_t position[3];
+	std::memcpy(position, input + QUANTIZED_POSITION_OFFSET, sizeof(position));
+
+	Vertex vertex;
+	for (int i = 0; i < 3; i++)
+	{
+		vertex.position[i] = decoding.positionOffset[i] + decoding.positionScale[i] * fromUnorm(position[i], 0xFFFF);
+	}
+
+	uint16_t textureCoords[2];
+	glm::vec2 normal; // In [-1, 1]^2
+
+	if (format == VertexFormat::Quantized16)
+	{
+		uint16_t stored[2];
+		std::memcpy(stored, input + QUANTIZED16_NORMAL_OFFSET, sizeof(stored));
+		normal = glm::vec2(fromUnorm(stored[0], 0xFFFF) * 2.0f - 1.0f, fromUnorm(stored[1], 0xFFFF) * 2.0f - 1.0f);
+		std::memcpy(textureCoords, input + QUANTIZED16_TEXTURE_OFFSET, sizeof(textureCoords));
+	}
+	else
+	{
+		normal = glm::vec2(fromUnorm(input[QUANTIZED8_NORMAL_OFFSET], 0xFF) * 2.0f - 1.0f, fromUnorm(input[QUANTIZED8_NORMAL_OFFSET + 1], 0xFF) * 2.0f - 1.0f);
+		std::memcpy(textureCoords, input + QUANTIZED8_TEXTURE_OFFSET, sizeof(textureCoords));
+	}
+
+	vertex.normal = decodeOctahedral(normal);
+	vertex.textureCoords = glm::vec2(halfToFloat(textureCoords[0]), halfToFloat(textureCoords[1]));
+	return vertex;
+}
+
+MeshView VertexQuantizer::Quantize(const MeshView& mesh, VertexFormat format, std::vector<uint8_t>& storage)
+{
+	if (format == VertexFormat::Float || format == VertexFormat::Auto || mesh.vertexFormat != VertexFormat::Float)
+	{
+		return mesh;
+	}
+
+	size_t stride = GetVertexStride(format);
+	VertexDecoding decoding = GetDecoding(format, mesh.minimums, mesh.maximums);
+	const Vertex* vertices = (const Vertex*)mesh.vertices;
+	storage.resize(mesh.vertexCount * stride);
+
+	size_t batchCount = (mesh.vertexCount + QUANTIZER_BATCH_SIZE - 1) / QUANTIZER_BATCH_SIZE;
+	ThreadPool::GetShared().ParallelFor(batchCount, [&](size_t batch)
+	{
+		size_t end = std::min(mesh.vertexCount, (batch + 1) * QUANTIZER_BATCH_SIZE);
+		for (size_t i = batch * QUANTIZER_BATCH_SIZE; i < end; i++)
+		{
+			encodeVertex(vertices[i], format, decoding, storage.data() + i * stride);
+		}
+	});
+
+	MeshView view = mesh;
+	view.vertices = storage.data();
+	view.vertexFormat = format;
+	return view;
+}
+
+QuantizationError VertexQuantizer::MeasureError(const MeshView& mesh, VertexFormat format)
+{
+	QuantizationError error;
+	if (format == VertexFormat::Float || format == VertexFormat::Auto || mesh.vertexFormat != VertexFormat::Float)
+	{
+		return error;
+	}
+
+	VertexDecoding decoding = GetDecoding(format, mesh.minimums, mesh.maximums);
+	const Vertex* vertices = (const Vertex*)mesh.vertices;
+	size_t batchCount = (mesh.vertexCount + QUANTIZER_BATCH_SIZE - 1) / QUANTIZER_BATCH_SIZE;
+	std::vector<QuantizationError> batchErrors(batchCount);
+
+	ThreadPool::GetShared().ParallelFor(batchCount, [&](size_t batch)
+	{
+		uint8_t encoded[sizeof(Vertex)];
+		QuantizationError& batchError = batchErrors[batch];
+		size_t end = std::min(mesh.vertexCount, (batch + 1) * QUANTIZER_BATCH_SIZE);
+
+		for (size_t i = batch * QUANTIZER_BATCH_SIZE; i < end; i++)
+		{
+			const Vertex& original = vertices[i];
+			encodeVertex(original, format, decoding, encoded);
+			Vertex decoded = decodeVertex(encoded, format, decoding);
+
+			batchError.position = std::max(batchError.position, (double)glm::length(decoded.position - original.position));
+
+			float normalLength = glm::length(original.normal);
+			if (normalLength > 0.0f)
+			{
+				// atan2 stays accurate for tiny angles, where acos of the dot product doesn't
+				glm::vec3 direction = original.normal / normalLength;
+				double angle = std::atan2((double)glm::length(glm::cross(direction, decoded.normal)), (double)glm::dot(direction, decoded.normal));
+				batchError.normalDegrees = std::max(batchError.normalDegrees, angle * 180.0 / 3.14159265358979323846);
+			}
+
+			for (int j = 0; j < 2; j++)
+			{
+				batchError.textureCoords = std::max(batchError.textureCoords, (double)std::abs(decoded.textureCoords[j] - original.textureCoords[j]));
+			}
+		}
+	});
+
+	for (const QuantizationError& batchError : batchErrors)
+	{
+		error.position = std::max(error.position, batchError.position);
+		error.normalDegrees = std::max(error.normalDegrees, batchError.normalDegrees);
+		error.textureCoords = std::max(error.textureCoords, batchError.textureCoords);
+	}
+
+	float diagonal = glm::length(mesh.maximums - mesh.minimums);
+	if (diagonal > 0.0f)
+	{
+		error.position /= diagonal;
+	}
+	return error;
+}
+
+VertexFormat VertexQuantizer::ChooseFormat(const MeshView& mesh, VertexFormat requested, QuantizationError& error)
+{
+	if (requested != VertexFormat::Auto)
+	{
+		error = MeasureError(mesh, requested);
+		return requested;
+	}
+
+	// Smallest first
+	const VertexFormat candidates[] = { VertexFormat::Quantized8, VertexFormat::Quantized16 };
+	for (VertexFormat candidate : candidates)
+	{
+		error = MeasureError(mesh, candidate);
+		if (error.IsWithinTolerance())
+		{
+			return candidate;
+		}
+	}
+
+	error = QuantizationError();
+	return VertexFormat::Float;
+}
@@ -0,0 +1,59 @@
+#include "VertexWelder.h"
+#include "Utils.h"
+#include <cstring>
+
+static constexpr uint32_t EMPTY_SLOT = 0xFFFFFFFFu;
+
+static size_t nextPowerOfTwo(size_t value)
+{
+	size_t power = 16;
+	while (power < value) power *= 2;
+	return power;
+}
+
+VertexWelder::VertexWelder(MeshData& meshData, size_t expectedCorners) :
+	meshData(meshData),
+	slots(nextPowerOfTwo(expectedCorners), EMPTY_SLOT)
+{
+	slotMask = slots.size() - 1;
+	meshData.indices.reserve(meshData.indices.size() + expectedCorners);
+}
+
+size_t VertexWelder::findSlot(const Vertex& vertex) const
+{
+	size_t slot = (size_t)Utils::HashBytes(&vertex, sizeof(Vertex)) & slotMask;
+	while (slots[slot] != EMPTY_SLOT && std::memcmp(&meshData.vertices[slots[slot]], &vertex, sizeof(Vertex)) != 0)
+	{
+		slot = (slot + 1) & slotMask;
+	}
+	return slot;
+}
+
+void VertexWelder::AddCorner(const Vertex& vertex)
+{
+	// Keep the table at most half full so the probe sequences stay short
+	if ((meshData.vertices.size() + 1) * 2 > slots.size())
+	{
+		grow();
+	}
+
+	size_t slot = findSlot(vertex);
+	if (slots[slot] == EMPTY_SLOT)
+	{
+		slots[slot] = (uint32_t)meshData.vertices.size();
+		meshData.vertices.push_back(vertex);
+	}
+
+	meshData.indices.push_back(slots[slot]);
+}
+
+void VertexWelder::grow()
+{
+	slots.assign(slots.size() * 2, EMPTY_SLOT);
+	slotMask = slots.size() - 1;
+
+	for (uint32_t i = 0; i < (uint32_t)meshData.vertices.size(); i++)
+	{
+		slots[findSlot(meshData.vertices[i])] = i;
+	}
+}
@@ -15,6 +15,14 @@
 #include "Camera.h"
 #include "ImguiMenus.h"
 #include "Fogger.h"
+#include "Benchmarks.h"
+#include "Batch.h"
+#include "Headless.h"
+#include "GLStateCache.h"
+#include "FrameCapture.h"
+#include "Profiler.h"
+#include "FrameStatistics.h"
+#include <string>
 
 // Function declarations
 static void GlfwErrorCallback(int error, const char* description);
@@ -53,6 +61,22 @@ static void HandleUserInput(ImGuiIO& io, IInputController& inputController)
 
 int main(int argc, char **argv)
 {
+	// Command line benchmarks don't need a window
+	if (argc > 1 && std::string(argv[1]) == "--benchmark")
+	{
+		return Benchmarks::Run(argc - 2, argv + 2);
+	}
+
+	// Offscreen rendering, without a window or the menus
+	if (argc > 1 && std::string(argv[1]) == "--headless")
+	{
+		return Headless::Run(argc - 2, argv + 2);
+	}
+	if (argc > 1 && std::string(argv[1]) == "--batch")
+	{
+		return Batch::Run(argc - 2, argv + 2);
+	}
+
 	// Create GLFW window
 	int windowWidth = 1920, windowHeight = 1080;
 	GLFWwindow* window = SetupGlfwWindow(windowWidth, windowHeight, "Mesh Viewer");
@@ -69,12 +93,12 @@ int main(int argc, char **argv)
 	glfwGetFramebufferSize(window, &frameBufferWidth, &frameBufferHeight);
 
 	// Create the scene
-	Scene scene = Scene();
+	Scene scene;
 	
 	// Clear the view
 	glm::vec4 clearColor = scene.GetClearColor();
 	glClearColor(clearColor.r, clearColor.g, clearColor.b, clearColor.a);
-	glEnable(GL_DEPTH_TEST);
+	GLStateCache::Get().SetDepthTest(true);
 
 	// Input Controller
 	std::vector<SceneAction> keysMapping(UCHAR_MAX,SceneAction::Nothing);
@@ -89,7 +113,7 @@ int main(int argc, char **argv)
 	IInputController& inputController = InputController(scene.GetActiveMovingObject(),scene.GetActiveDirectionalObject(),keysMapping,mouseKeysMapping);
 
 	// Create the renderer and the scene
-	Renderer renderer = Renderer(scene);
+	Renderer renderer(scene);
 
 	// Setup ImGui
 	ImGuiIO& io = SetupDearImgui(window);
@@ -100,17 +124,26 @@ int main(int argc, char **argv)
 	// This is the main game loop..
     while (!glfwWindowShouldClose(window))
     {
-        glfwPollEvents();
+		Profiler::Get().BeginFrame();
+		{
+			ProfileZone zone("Poll events");
+			glfwPollEvents();
+		}
 		StartFrame();
 
 		// Build the menus for the next frame
-		DrawMenus(io, scene);
+		{
+			ProfileZone zone("Menus");
+			DrawMenus(io, scene);
+		}
 
 		// Handle user input
 		HandleUserInput(io, inputController);
 
 		// Render the next frame
 		RenderFrame(window, scene, renderer, io);
+		Profiler::Get().EndFrame();
+		FrameStatistics::Get().EndFrame();
     }
 
 	// If we're here, then we're done. Cleanup memory.
@@ -169,31 +202,47 @@ void StartFrame()
 void RenderFrame(GLFWwindow* window, Scene& scene, Renderer& renderer, ImGuiIO& io)
 {
 	// Render the menus
-	auto start = std::chrono::high_resolution_clock::now();
-	ImGui::Render();
-	auto finish = std::chrono::high_resolution_clock::now();
-	std::chrono::duration<double> elapsed = finish - start;
-	scene.SetImGuiRenderExecutionTime(elapsed.count());
+	{
+		ProfileZone zone("ImGui::Render");
+		ImGui::Render();
+	}
 
 	// That's how you get the current width/height of the frame buffer (for example, after the window was resized)
 	int frameBufferWidth, frameBufferHeight;
 	glfwGetFramebufferSize(window, &frameBufferWidth, &frameBufferHeight);
 
-	start = std::chrono::high_resolution_clock::now();
-	renderer.ClearBuffers();
-	finish = std::chrono::high_resolution_clock::now();
-	elapsed = finish - start;
-	scene.SetColorBufferExecutionTime(elapsed.count());
+	{
+		ProfileZone zone("Clear buffers");
+		GpuProfileZone gpuZone("Clear buffers");
+		renderer.ClearBuffers();
+	}
 
 	// Render the scene
 	renderer.Render();
 
-	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+	// Recording captures the scene without the menus
+	{
+		ProfileZone zone("Frame capture");
+		FrameCapture::Get().RecordFrame(frameBufferWidth, frameBufferHeight);
+		FrameCapture::Get().Update();
+	}
+
+	{
+		ProfileZone zone("Draw menus");
+		GpuProfileZone gpuZone("Draw menus");
+		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+	}
+
+	// Includes waiting for vsync
+	ProfileZone zone("Swap buffers");
 	glfwSwapBuffers(window);
 }
 
 void Cleanup(GLFWwindow* window)
 {
+	// The recorded frames still in flight need the context
+	FrameCapture::Get().Flush();
+
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
 	ImGui::DestroyContext();